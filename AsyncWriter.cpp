@@ -0,0 +1,280 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+
+#include "AsyncWriter.h"
+#include "Instrumentation.h"
+
+
+// ****************************************************************************
+
+AsyncWriter::AsyncWriter() : out(0),
+                             ordered(false),
+                             running(false),
+                             stopping(false),
+                             busy(false),
+                             failed(false),
+                             numPushed(0),
+                             numWritten(0),
+                             releasedLevel(0),
+                             releasePending(false)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&work_cond, NULL);
+    pthread_cond_init(&written_cond, NULL);
+}
+
+// ****************************************************************************
+
+AsyncWriter::~AsyncWriter()
+{
+    Stop();
+
+    pthread_cond_destroy(&written_cond);
+    pthread_cond_destroy(&work_cond);
+    pthread_mutex_destroy(&lock);
+}
+
+// ****************************************************************************
+
+void AsyncWriter::Start(OutputFile& file, bool inOrder)
+{
+    Stop();
+
+    out = &file;
+    ordered = inOrder;
+    stopping = false;
+    busy = false;
+    failed = false;
+    numPushed = numWritten = 0;
+    releasedLevel = 0;
+    releasePending = false;
+    reorder.clear();
+
+    if (pthread_create(&thread, NULL, Run, this) != 0) throw "Unable to start the output thread.";
+
+    running = true;
+}
+
+// ****************************************************************************
+
+void AsyncWriter::Push(const Key& key, const std::string& block)
+{
+    pthread_mutex_lock(&lock);
+
+    pending.push_back(std::make_pair(key, block));
+    numPushed++;
+    unsigned long queued = numPushed - numWritten;
+
+    pthread_cond_signal(&work_cond);
+
+    pthread_mutex_unlock(&lock);
+
+    Instrumentation::Max(Instrumentation::WRITER_QUEUE_MAX, queued);
+}
+
+// ****************************************************************************
+
+void AsyncWriter::Release(unsigned int level)
+{
+    pthread_mutex_lock(&lock);
+
+    if (level > releasedLevel)
+    {
+        releasedLevel = level;
+        releasePending = true;
+        pthread_cond_signal(&work_cond);
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+// ****************************************************************************
+//
+// Once nothing is pending and the I/O thread is not busy it is idle (it takes a
+// batch only under the lock), so the file can be flushed here.
+//
+void AsyncWriter::Flush()
+{
+    pthread_mutex_lock(&lock);
+
+    while (running && (!pending.empty() || releasePending || busy))
+    {
+        pthread_cond_wait(&written_cond, &lock);
+    }
+
+    try
+    {
+        if (out != 0) out->Flush();
+    }
+    catch (const char* msg)
+    {
+        std::cerr << msg << std::endl;
+        failed = true;
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+// ****************************************************************************
+
+bool AsyncWriter::Failed()
+{
+    pthread_mutex_lock(&lock);
+    bool result = failed;
+    pthread_mutex_unlock(&lock);
+
+    return result;
+}
+
+// ****************************************************************************
+
+void AsyncWriter::Stop()
+{
+    if (!running) return;
+
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);
+    running = false;
+
+    try
+    {
+        // Levels never released (synthesis stopped early) are written in key order.
+        for (std::map<Key, std::string>::iterator it = reorder.begin(); it != reorder.end(); it++)
+        {
+            out->Write(it->second.data(), it->second.size());
+        }
+
+        out->Flush();
+    }
+    catch (const char* msg)
+    {
+        std::cerr << msg << std::endl;
+        failed = true;
+    }
+
+    reorder.clear();
+}
+
+// ****************************************************************************
+
+void AsyncWriter::GetHeld(std::vector<std::pair<Key, std::string> >& held) const
+{
+    held.assign(reorder.begin(), reorder.end());
+}
+
+// ****************************************************************************
+
+void AsyncWriter::Hold(const std::vector<std::pair<Key, std::string> >& held)
+{
+    if (held.empty()) return;
+
+    pthread_mutex_lock(&lock);
+
+    pending.insert(pending.end(), held.begin(), held.end());
+    numPushed += held.size();
+
+    pthread_cond_signal(&work_cond);
+
+    pthread_mutex_unlock(&lock);
+}
+
+// ****************************************************************************
+
+unsigned long AsyncWriter::WriteBatch(std::vector<std::pair<Key, std::string> >& batch,
+                                      unsigned int level)
+{
+    std::string buffer;
+    unsigned long written = 0;
+
+    if (!ordered)
+    {
+        for (unsigned int b = 0; b < batch.size(); b++) buffer += batch[b].second;
+        written = batch.size();
+    }
+    else
+    {
+        // Keys are unique (canonical SMILES are deduplicated) except for blocks
+        // pushed without one, which keep their order.
+        for (unsigned int b = 0; b < batch.size(); b++)
+        {
+            std::string& held = reorder[batch[b].first];
+            if (held.empty()) held.swap(batch[b].second);
+            else held += batch[b].second;
+        }
+
+        std::map<Key, std::string>::iterator it = reorder.begin();
+        while (it != reorder.end() && it->first.first <= level)
+        {
+            buffer += it->second;
+            reorder.erase(it++);
+            written++;
+        }
+    }
+
+    out->Write(buffer.data(), buffer.size());
+
+    return written;
+}
+
+// ****************************************************************************
+
+void* AsyncWriter::Run(void* args)
+{
+    AsyncWriter* This = (AsyncWriter*)args;
+
+    std::vector<std::pair<Key, std::string> > batch;
+
+    pthread_mutex_lock(&This->lock);
+
+    while (true)
+    {
+        while (This->pending.empty() && !This->releasePending && !This->stopping)
+        {
+            pthread_cond_wait(&This->work_cond, &This->lock);
+        }
+
+        if (This->pending.empty() && !This->releasePending && This->stopping) break;
+
+        batch.swap(This->pending);
+        unsigned int level = This->releasedLevel;
+        This->releasePending = false;
+        This->busy = true;
+
+        pthread_mutex_unlock(&This->lock);
+
+        unsigned long written = batch.size();
+        bool writeFailed = false;
+        try
+        {
+            written = This->WriteBatch(batch, level);
+        }
+        catch (const char* msg)
+        {
+            std::cerr << msg << std::endl;
+            writeFailed = true;
+        }
+
+        pthread_mutex_lock(&This->lock);
+
+        // The batch is counted (so Flush returns) but the output is incomplete.
+        if (writeFailed) This->failed = true;
+
+        // Blocks held back for reordering count once they reach the stream.
+        This->numWritten += written;
+        This->busy = false;
+        batch.clear();
+
+        pthread_cond_broadcast(&This->written_cond);
+    }
+
+    pthread_mutex_unlock(&This->lock);
+
+    return 0;
+}
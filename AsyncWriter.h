@@ -0,0 +1,97 @@
+#ifndef _ASYNC_WRITER_GUARD
+#define _ASYNC_WRITER_GUARD 1
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <pthread.h>
+
+
+#include "OutputFile.h"
+
+
+//
+// A dedicated I/O thread for the output file.
+//
+// Producers hand over serialized blocks (Push); the I/O thread takes everything
+// queued at once (swapping the pending batch under a short lock) and writes it with
+// one large write (compressing it, if the file is compressed, off the producers'
+// threads). In ordered mode blocks are held back until their level is released
+// and are then written by key (level, then canonical SMILES), so the file does not
+// depend on the order they are pushed.
+//
+class AsyncWriter
+{
+  public:
+    AsyncWriter();
+    ~AsyncWriter();
+
+    // Ordered mode: the synthesis level and canonical SMILES of a block.
+    typedef std::pair<unsigned int, std::string> Key;
+
+    // Start the I/O thread writing to out.
+    void Start(OutputFile& out, bool ordered);
+
+    // Queue a block (the key is used only in ordered mode).
+    void Push(const Key& key, const std::string& block);
+
+    // Ordered mode: no block of a level up to level will be pushed anymore, so the
+    // blocks of those levels are written.
+    void Release(unsigned int level);
+
+    // Wait until every block pushed so far is written (or held back for a level not
+    // yet released) and flush the file.
+    void Flush();
+
+    // Write everything pushed (blocks held back in key order) and stop the I/O thread.
+    void Stop();
+
+    // A write or flush of the file failed; the output is incomplete (sticky).
+    bool Failed();
+
+    //
+    // Checkpoint support
+    //
+    // The blocks held back for levels not yet released; call after Flush.
+    void GetHeld(std::vector<std::pair<Key, std::string> >& held) const;
+    // Hold checkpointed blocks back again; call after Start.
+    void Hold(const std::vector<std::pair<Key, std::string> >& held);
+
+  private:
+    OutputFile* out;
+    bool ordered;
+    bool running;
+    bool stopping;
+    // The I/O thread has taken a batch (or release) it has not finished writing.
+    bool busy;
+    bool failed;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t written_cond;
+
+    std::vector<std::pair<Key, std::string> > pending;
+    unsigned long numPushed;
+    unsigned long numWritten;
+
+    // Ordered mode: the highest level released, and whether the I/O thread has yet
+    // to write the blocks it released.
+    unsigned int releasedLevel;
+    bool releasePending;
+
+    // Ordered mode: blocks of levels not yet released (I/O thread only).
+    std::map<Key, std::string> reorder;
+
+    static void* Run(void* args);
+    // Write (or hold back) a batch; returns the number of blocks written.
+    unsigned long WriteBatch(std::vector<std::pair<Key, std::string> >& batch,
+                             unsigned int level);
+
+    AsyncWriter(const AsyncWriter&);
+    AsyncWriter& operator=(const AsyncWriter&);
+};
+
+#endif
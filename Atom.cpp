@@ -10,22 +10,18 @@
 #include "Utilities.h"
 
 
-/**********************************************************************************/
-
-Atom::~Atom()
-{
-    // delete &atomType;
-}
 
 /**********************************************************************************/
 
 Atom::Atom(int id, AtomT& aType)
 {
     this->atomID = id;
-    this->atomType = aType;
+    this->atomType = AtomT::Intern(aType);
     this->maxConnect = 0;
     this->canConnectToAnyAtom = false;
     this->numExternalConnections = 0;
+    this->connectionID = -1;
+    this->setGraphNodeIndex(std::make_pair(0, 0));
 }
 
 /**********************************************************************************/
@@ -33,7 +29,7 @@ Atom::Atom(int id, AtomT& aType)
 Atom::Atom(int id, Molecule* owner, AtomT& aType)
 {
     this->atomID = id;
-    this->atomType = aType;
+    this->atomType = AtomT::Intern(aType);
     this->maxConnect = 0;
     this->canConnectToAnyAtom = false;
     this->numExternalConnections = 0;
@@ -47,10 +43,12 @@ Atom::Atom(int id, Molecule* owner, AtomT& aType)
 Atom::Atom(int id, bool canConnectToAnyAtom)
 {
     this->atomID = id;
+    this->atomType = AtomT::UNKNOWN_TYPE_ID;
     this->maxConnect = 0;
     this->numExternalConnections = 0;
     this->canConnectToAnyAtom = canConnectToAnyAtom;
-
+    this->connectionID = -1;
+    this->setGraphNodeIndex(std::make_pair(0, 0));
 }
 
 /**********************************************************************************/
@@ -58,6 +56,7 @@ Atom::Atom(int id, bool canConnectToAnyAtom)
 Atom::Atom(int id, int maxConn, std::string connType, bool canConnectToAnyAtom)
 {
     this->atomID = id;
+    this->atomType = AtomT::UNKNOWN_TYPE_ID;
     this->maxConnect = maxConn;
     this->numExternalConnections = 0;
     this->canConnectToAnyAtom = canConnectToAnyAtom;
@@ -75,10 +74,7 @@ void Atom::SetBasedOn(const Atom& that)
     this->connectionID = that.connectionID;
     this->graphNodeIndex = that.graphNodeIndex;
 
-    for (int a = 0; a < that.allowableTypes.size(); a++)
-    {
-        this->allowableTypes.push_back(that.allowableTypes[a]);
-    }
+    this->allowableTypes |= that.allowableTypes;
 
     this->numExternalConnections += that.numExternalConnections;
 }
@@ -88,7 +84,7 @@ void Atom::SetBasedOn(const Atom& that)
 
 void Atom::UpdateIndices(std::pair<unsigned int, unsigned int> index)
 {
-    this->graphNodeIndex = index;
+    this->setGraphNodeIndex(index);
 /*
 std::cout << "Set (index): (" << this->graphNodeIndex.first
           << ", " << this->graphNodeIndex.second << ")" << std::endl;
@@ -116,13 +112,20 @@ void Atom::addExternalConnection(int atomIndex)
 
 void Atom::addConnectionType(const AtomT& aType)
 {
-   if (std::find(allowableTypes.begin(), allowableTypes.end(), aType) == allowableTypes.end())
+    addConnectionTypeId(AtomT::Intern(aType));
+}
+
+/**********************************************************************************/
+
+void Atom::addConnectionTypeId(unsigned int id)
+{
+   if (!allowableTypes.test(id))
    {
-       allowableTypes.push_back(aType);
+       allowableTypes.set(id);
    }
    else
    {
-       std::cerr << "Duplicate allowable bond-type: " << aType << std::endl;
+       std::cerr << "Duplicate allowable bond-type: " << AtomT::Interned(id) << std::endl;
    }
 }
 
@@ -145,41 +148,14 @@ bool Atom::CanConnectTo(const Atom& that) const
 //std::cerr << "\tSpace avail" << std::endl;
 
     //
-    // Does this atom allow the connection to that?
+    // Does this atom allow the connection to that (or accept all connections)?
     //
-    bool canConnect = false;
-    for (int t = 0; t < this->allowableTypes.size(); t++)
-    {
-        if (this->allowableTypes[t] == that.getAtomType())
-        {
-            canConnect = true;
-            break;
-        }
-    }
-
-    // If there are no allowable connections, check to see if it accepts all connections.
-    if (!canConnect)
-    {
-        if (!this->CanConnectToAny()) return false;
-    }
+    if (!this->allowableTypes.test(that.atomType) && !this->CanConnectToAny()) return false;
 
     //
     // Does that atom allow the connection to this?
     //
-    canConnect = false;
-    for (int t = 0; t < that.allowableTypes.size(); t++)
-    {
-        if (that.allowableTypes[t] == this->atomType)
-        {
-            canConnect = true;
-            break;
-        }
-    }
-
-    // If there are no allowable connections, check to see if it accepts all connections.    
-    if (canConnect) return true;
-
-    return that.CanConnectToAny();
+    return that.allowableTypes.test(this->atomType) || that.CanConnectToAny();
 }
 
 /****************************************************************************************/
@@ -205,24 +181,10 @@ bool Atom::operator==(const Atom& that) const
     //
     // Check the allowable connection types, connections, and external connections
     //
-    if (this->allowableTypes.size() != that.allowableTypes.size()) return false;
-
-    // if (this->connections.size() != that.connections.size()) return false;
+    if (this->allowableTypes != that.allowableTypes) return false;
 
     if (this->numExternalConnections != that.numExternalConnections) return false;
 
-    //if (this->extConnections.size() != that.extConnections.size()) return false;
-
-//std::cerr << "(d)" << std::endl;
-    for (int t = 0; t < this->allowableTypes.size(); t++)
-    {
-        if (std::find(that.allowableTypes.begin(),
-                      that.allowableTypes.end(), this->allowableTypes[t]) == that.allowableTypes.end())
-        {
-            return false;
-        }
-    }
-
 //std::cerr << "(e)" << std::endl;
 /*
     for (int c = 0; c < this->connections.size(); c++)
@@ -259,7 +221,7 @@ std::string Atom::toString() const
 {
     std::ostringstream oss;
 
-    oss << atomID << ": " << atomType.toString();
+    oss << atomID << ": " << AtomT::Interned(atomType).toString();
     oss << " Connections{ Max: " << maxConnect;
 
     oss << " Allow: ";
@@ -267,9 +229,9 @@ std::string Atom::toString() const
     if (CanConnectToAny()) oss << " All Conn";
     else
     {
-        for (int a = 0; a < allowableTypes.size(); a++)
+        for (unsigned int t = 0; t < AtomT::MAX_INTERNED; t++)
         {
-            oss << allowableTypes[a].toString() << " ";
+            if (allowableTypes.test(t)) oss << AtomT::Interned(t).toString() << " ";
         }
     }   
 /*
@@ -22,13 +22,17 @@ typedef enum
 class Molecule;
 
 
+//
+// Atoms are plain records (trivially copyable) so atom arrays copy as raw memory;
+// atom types are interned ids (see AtomT::Intern).
+//
 class Atom
 {
   private:
     int atomID;
 
-    // This atom's type
-    AtomT atomType;
+    // This atom's type (interned id)
+    unsigned int atomType;
 
     // The classification of the original linker / rigid that contained this atom
     MoleculeT ownerType;    
@@ -39,8 +43,9 @@ class Atom
     // Unique connection identifier for graph sub-node connecting
     unsigned int connectionID;
 
-    // A reference to the node in the fragment graph which owns this atom.
-    std::pair<unsigned int, unsigned int> graphNodeIndex;
+    // A reference to the node in the fragment graph which owns this atom
+    // (a plain pair so the atom stays trivially copyable).
+    struct { unsigned int first; unsigned int second; } graphNodeIndex;
 
     // In the case of a linker atom, we can connect to anything
     bool canConnectToAnyAtom;
@@ -48,8 +53,8 @@ class Atom
     // The maximum number of connections to this atom allowable.
     int maxConnect;
 
-    // Allowable atom types for connections
-    std::vector<AtomT> allowableTypes;
+    // Allowable atom types for connections (interned ids)
+    AtomTSet allowableTypes;
 
     // The actual (index) connections within the existent linker or rigid.
     // std::vector<int> connections;
@@ -63,7 +68,8 @@ class Atom
     // Get functions
     //
     int getAtomID() const { return this->atomID; }
-    AtomT getAtomType() const { return this->atomType; }
+    AtomT getAtomType() const { return AtomT::Interned(this->atomType); }
+    unsigned int getAtomTypeId() const { return this->atomType; }
     int getMaxConnect() const { return this->maxConnect; }
 
     bool CanConnectToAny() const { return canConnectToAnyAtom; }
@@ -75,8 +81,15 @@ class Atom
     }
     bool CanConnectTo(const Atom& that) const;
 
-    void setGraphNodeIndex(std::pair<unsigned int, unsigned int> index) { graphNodeIndex = index; }
-    std::pair<unsigned int, unsigned int> getGraphNodeIndex() const { return graphNodeIndex; }
+    void setGraphNodeIndex(std::pair<unsigned int, unsigned int> index)
+    {
+        graphNodeIndex.first = index.first;
+        graphNodeIndex.second = index.second;
+    }
+    std::pair<unsigned int, unsigned int> getGraphNodeIndex() const
+    {
+        return std::make_pair(graphNodeIndex.first, graphNodeIndex.second);
+    }
 
     void setConnectionID(unsigned int id) { connectionID = id; }
     unsigned int getConnectionID() const { return connectionID; }
@@ -85,7 +98,8 @@ class Atom
     // Set Functions
     //
     void setAtomID(int x) { this->atomID = x; }
-    void setAtomType(AtomT x) { this->atomType = x; }
+    void setAtomType(const AtomT& x) { this->atomType = AtomT::Intern(x); }
+    void setAtomTypeId(unsigned int id) { this->atomType = id; }
 
     void setCanConnectToAnyAtom() { this->canConnectToAnyAtom = true; }
     void setMaxConnect(int x) { this->maxConnect = x; }
@@ -100,15 +114,17 @@ class Atom
     Atom(int id, Molecule*, AtomT& atomType);
     Atom(int id, bool canConnectToAnyAtom);
     Atom(int id, int maxConn, std::string connType, bool canConnectToAnyAtom);
-    ~Atom();
 
     void addConnectionType(const AtomT& aType);
+    void addConnectionTypeId(unsigned int typeId);
     //    void addConnection(int);
     void addExternalConnection(int);
 
     std::string toString() const;
     friend std::ostream& operator<< (std::ostream& os, Atom& atom);
     bool operator==(const Atom& that) const;
+
+    friend class MoleculeIO;
 };
 
 #endif
@@ -3,9 +3,19 @@
 #include <cctype>
 #include <cstdlib>
 #include <iostream>
+#include <pthread.h>
 
 #include "AtomT.h"
 
+
+// Entry UNKNOWN_TYPE_ID is the default-constructed type.
+AtomT AtomT::internTable[AtomT::MAX_INTERNED];
+unsigned int AtomT::numInterned = 1;
+std::map<std::string, unsigned int> AtomT::internedStrings;
+
+// Fragment libraries are parsed in parallel.
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
 AtomT::AtomT(AtomEnumT type, int val, SpecialEnumT spec) : atomType(type),
                                                            specificNum(val),
                                                            specialT(spec)
@@ -102,6 +112,82 @@ bool AtomT::operator==(const AtomT& that) const
 }
 
 
+// **************************************************************************************
+//
+// Only a handful of distinct types occur, so a linear search suffices.
+// The caller holds intern_lock.
+//
+unsigned int AtomT::InternLocked(const AtomT& type)
+{
+    for (unsigned int id = 0; id < numInterned; id++)
+    {
+        if (internTable[id] == type) return id;
+    }
+
+    if (numInterned == MAX_INTERNED)
+    {
+        throw std::string("Too many distinct atom types to intern: ") + type.toString();
+    }
+
+    internTable[numInterned] = type;
+
+    return numInterned++;
+}
+
+// **************************************************************************************
+
+unsigned int AtomT::Intern(const AtomT& type)
+{
+    pthread_mutex_lock(&intern_lock);
+
+    unsigned int id;
+    try
+    {
+        id = InternLocked(type);
+    }
+    catch (const std::string&)
+    {
+        pthread_mutex_unlock(&intern_lock);
+        throw;
+    }
+
+    pthread_mutex_unlock(&intern_lock);
+
+    return id;
+}
+
+// **************************************************************************************
+
+unsigned int AtomT::Intern(const std::string& typeString)
+{
+    pthread_mutex_lock(&intern_lock);
+
+    std::map<std::string, unsigned int>::const_iterator it = internedStrings.find(typeString);
+    if (it != internedStrings.end())
+    {
+        unsigned int id = it->second;
+        pthread_mutex_unlock(&intern_lock);
+        return id;
+    }
+
+    unsigned int id;
+    try
+    {
+        id = InternLocked(AtomT(typeString));
+    }
+    catch (const std::string&)
+    {
+        pthread_mutex_unlock(&intern_lock);
+        throw;
+    }
+
+    internedStrings[typeString] = id;
+
+    pthread_mutex_unlock(&intern_lock);
+
+    return id;
+}
+
 // **************************************************************************************
 
 std::string AtomT::toString() const
@@ -4,6 +4,8 @@
 #include <string>
 #include <cctype>
 #include <cstdlib>
+#include <bitset>
+#include <map>
 
 typedef enum
 {
@@ -43,9 +45,32 @@ class AtomT
     bool operator==(const AtomT& that) const;
     bool operator!=(const AtomT& that) const { return !(*this == that); }
 
+    //
+    // The distinct atom types of the fragment libraries are interned to small ids
+    // so sets of types are bitsets (AtomTSet). Ids are per-process; the id of the
+    // unknown (default) type is fixed.
+    //
+    static const unsigned int MAX_INTERNED = 128;
+    static const unsigned int UNKNOWN_TYPE_ID = 0;
+
+    // The id of the given type (interning it on first use); thread-safe.
+    static unsigned int Intern(const AtomT& type);
+    // The id of the type spelled <element>.<type>; each distinct spelling is parsed once.
+    static unsigned int Intern(const std::string& typeString);
+    static const AtomT& Interned(unsigned int id) { return internTable[id]; }
+
   private:
+    static AtomT internTable[MAX_INTERNED];
+    static unsigned int numInterned;
+    static std::map<std::string, unsigned int> internedStrings;
+
+    static unsigned int InternLocked(const AtomT& type);
+
     static AtomEnumT convertToAtomEnum(std::string&);
     static SpecialEnumT convertToSpecialEnum(std::string& s);
 };
 
+// A set of interned atom types.
+typedef std::bitset<AtomT::MAX_INTERNED> AtomTSet;
+
 #endif
@@ -0,0 +1,82 @@
+#include <string>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#include "BinaryIO.h"
+
+
+// ****************************************************************************
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping remains valid after the descriptor is closed.
+    close(fd);
+
+    if (mapped == MAP_FAILED) return false;
+
+    data = static_cast<const char*>(mapped);
+    size = info.st_size;
+
+    return true;
+}
+
+// ****************************************************************************
+
+void MappedFile::Close()
+{
+    if (data) munmap(const_cast<char*>(data), size);
+
+    data = 0;
+    size = 0;
+}
+
+// ****************************************************************************
+
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    for (size_t b = 0; b < size; b++)
+    {
+        hash ^= bytes[b];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// ****************************************************************************
+
+bool HashFile(const std::string& fileName, unsigned long long& hash)
+{
+    std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (in.fail()) return false;
+
+    hash = HashBytes(fileName.data(), fileName.size(), hash);
+
+    char buffer[1 << 16];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
+    {
+        hash = HashBytes(buffer, in.gcount(), hash);
+    }
+
+    return true;
+}
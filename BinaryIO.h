@@ -0,0 +1,124 @@
+#ifndef _BINARY_IO_GUARD
+#define _BINARY_IO_GUARD 1
+
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+
+
+//
+// Light-weight, native-endian binary serialization used by the on-disk
+// formats of this project (fragment cache, ...).
+//
+class BinaryWriter
+{
+  public:
+    BinaryWriter(std::ostream& os) : out(os) {}
+
+    template<class T>
+    void Write(const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        out.write(static_cast<const char*>(data), size);
+    }
+
+    void WriteString(const std::string& s)
+    {
+        Write<unsigned int>(s.size());
+        out.write(s.data(), s.size());
+    }
+
+    bool good() const { return out.good(); }
+
+  private:
+    std::ostream& out;
+};
+
+//
+// Reads from a contiguous (typically memory-mapped) buffer.
+// Reading beyond the end of the buffer throws a string.
+//
+class BinaryReader
+{
+  public:
+    BinaryReader(const char* data, size_t size) : begin(data), current(data), end(data + size) {}
+
+    template<class T>
+    T Read()
+    {
+        T value;
+        ReadBytes(&value, sizeof(T));
+        return value;
+    }
+
+    void ReadBytes(void* dest, size_t size)
+    {
+        if (size > (size_t)(end - current)) throw std::string("BinaryReader: unexpected end of data");
+
+        memcpy(dest, current, size);
+        current += size;
+    }
+
+    std::string ReadString()
+    {
+        unsigned int size = Read<unsigned int>();
+
+        if (size > (size_t)(end - current)) throw std::string("BinaryReader: unexpected end of data");
+
+        std::string s(current, size);
+        current += size;
+
+        return s;
+    }
+
+    size_t offset() const { return current - begin; }
+    bool atEnd() const { return current == end; }
+
+  private:
+    const char* begin;
+    const char* current;
+    const char* end;
+};
+
+//
+// A read-only memory mapping of an entire file.
+//
+class MappedFile
+{
+  public:
+    MappedFile() : data(0), size(0) {}
+    ~MappedFile() { Close(); }
+
+    bool Open(const std::string& fileName);
+    void Close();
+
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+  private:
+    const char* data;
+    size_t size;
+
+    // Non-copyable
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+//
+// 64-bit FNV-1a hashing for content keys.
+//
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+unsigned long long HashBytes(const void* data, size_t size,
+                             unsigned long long hash = FNV_OFFSET_BASIS);
+
+// Hash of the file contents (and its name); returns false if the file cannot be read.
+bool HashFile(const std::string& fileName, unsigned long long& hash);
+
+#endif
@@ -0,0 +1,97 @@
+#include <set>
+#include <string>
+
+
+#include "CanonicalSmilesSet.h"
+#include "BinaryIO.h"
+
+
+// ****************************************************************************
+
+CanonicalSmilesSet::CanonicalSmilesSet()
+{
+    for (unsigned int s = 0; s < NUM_SHARDS; s++)
+    {
+        shards[s].numDuplicates = 0;
+        pthread_mutex_init(&shards[s].lock, NULL);
+    }
+}
+
+// ****************************************************************************
+
+CanonicalSmilesSet::~CanonicalSmilesSet()
+{
+    for (unsigned int s = 0; s < NUM_SHARDS; s++) pthread_mutex_destroy(&shards[s].lock);
+}
+
+// ****************************************************************************
+
+bool CanonicalSmilesSet::Insert(const std::string& smiles)
+{
+    Shard& shard = shards[HashBytes(smiles.data(), smiles.size()) % NUM_SHARDS];
+
+    pthread_mutex_lock(&shard.lock);
+
+    bool inserted = shard.smiles.insert(smiles).second;
+    if (!inserted) shard.numDuplicates++;
+
+    pthread_mutex_unlock(&shard.lock);
+
+    return inserted;
+}
+
+// ****************************************************************************
+
+unsigned long CanonicalSmilesSet::NumDuplicates()
+{
+    unsigned long total = 0;
+
+    for (unsigned int s = 0; s < NUM_SHARDS; s++)
+    {
+        pthread_mutex_lock(&shards[s].lock);
+        total += shards[s].numDuplicates;
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+
+    return total;
+}
+
+// ****************************************************************************
+
+void CanonicalSmilesSet::Write(BinaryWriter& out)
+{
+    unsigned long size = 0;
+    for (unsigned int s = 0; s < NUM_SHARDS; s++) size += shards[s].smiles.size();
+
+    out.Write<unsigned long>(size);
+    out.Write<unsigned long>(NumDuplicates());
+
+    for (unsigned int s = 0; s < NUM_SHARDS; s++)
+    {
+        for (std::set<std::string>::const_iterator it = shards[s].smiles.begin();
+             it != shards[s].smiles.end(); it++)
+        {
+            out.WriteString(*it);
+        }
+    }
+}
+
+// ****************************************************************************
+
+void CanonicalSmilesSet::Read(BinaryReader& in)
+{
+    for (unsigned int s = 0; s < NUM_SHARDS; s++)
+    {
+        shards[s].smiles.clear();
+        shards[s].numDuplicates = 0;
+    }
+
+    unsigned long size = in.Read<unsigned long>();
+    shards[0].numDuplicates = in.Read<unsigned long>();
+
+    for (unsigned long i = 0; i < size; i++)
+    {
+        std::string smiles = in.ReadString();
+        shards[HashBytes(smiles.data(), smiles.size()) % NUM_SHARDS].smiles.insert(smiles);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef _CANONICAL_SMILES_SET_GUARD
+#define _CANONICAL_SMILES_SET_GUARD 1
+
+
+#include <set>
+#include <string>
+#include <pthread.h>
+
+
+class BinaryWriter;
+class BinaryReader;
+
+
+//
+// The canonical SMILES of the molecules handed to obgen. Different fragment
+// graphs can yield the same chemical structure (e.g., symmetric rigids attached
+// at equivalent anchors); only the first is written.
+//
+// The set is split into NUM_SHARDS independently locked shards (by hash) so the
+// level threads rarely contend.
+//
+class CanonicalSmilesSet
+{
+  public:
+    CanonicalSmilesSet();
+    ~CanonicalSmilesSet();
+
+    // True if smiles was not in the set (and is now); false for a duplicate.
+    bool Insert(const std::string& smiles);
+
+    // Number of duplicates Insert has rejected.
+    unsigned long NumDuplicates();
+
+    // Checkpoint support; no Insert may run concurrently.
+    void Write(BinaryWriter& out);
+    void Read(BinaryReader& in);
+
+  private:
+    static const unsigned int NUM_SHARDS = 64;
+
+    struct Shard
+    {
+        std::set<std::string> smiles;
+        unsigned long numDuplicates;
+        pthread_mutex_t lock;
+    };
+
+    Shard shards[NUM_SHARDS];
+
+    CanonicalSmilesSet(const CanonicalSmilesSet&);
+    CanonicalSmilesSet& operator=(const CanonicalSmilesSet&);
+};
+
+#endif
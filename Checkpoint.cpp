@@ -0,0 +1,365 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+
+#include "Checkpoint.h"
+#include "Instantiator.h"
+#include "OBWriter.h"
+#include "Validator.h"
+#include "BinaryIO.h"
+#include "MoleculeIO.h"
+#include "Molecule.h"
+#include "HyperGraph.h"
+#include "EdgeAnnotation.h"
+#include "Constants.h"
+
+
+const char Checkpoint::MAGIC[8] = { 'S', 'Y', 'N', 'C', 'K', 'P', 'T', '1' };
+
+// Detects checkpoints written on a machine with a different byte order.
+static const unsigned int ENDIAN_CHECK = 0x01020304;
+
+// ****************************************************************************
+//
+// Parameters that determine the synthesized hypergraph; a checkpoint only applies
+// to a run with identical values.
+//
+static void WriteParameters(BinaryWriter& out, unsigned long long inputKey, unsigned int numBase)
+{
+    out.Write<unsigned long long>(inputKey);
+    out.Write<unsigned int>(HIERARCHICAL_LEVEL_BOUND);
+    out.Write<double>(MOLWT_UPPERBOUND);
+    out.Write<double>(HBD_UPPERBOUND);
+    out.Write<double>(HBA1_UPPERBOUND);
+    out.Write<double>(LOGP_UPPERBOUND);
+    out.Write<unsigned int>(numBase);
+}
+
+static void CheckParameters(BinaryReader& in, unsigned long long inputKey, unsigned int numBase)
+{
+    if (in.Read<unsigned long long>() != inputKey)
+    {
+        throw std::string("input fragment files differ from the checkpointed run");
+    }
+    if (in.Read<unsigned int>() != HIERARCHICAL_LEVEL_BOUND)
+    {
+        throw std::string("hierarchical level bound (-hl) differs from the checkpointed run");
+    }
+    if (in.Read<double>() != MOLWT_UPPERBOUND || in.Read<double>() != HBD_UPPERBOUND ||
+        in.Read<double>() != HBA1_UPPERBOUND || in.Read<double>() != LOGP_UPPERBOUND)
+    {
+        throw std::string("Lipinski bounds differ from the checkpointed run");
+    }
+    if (in.Read<unsigned int>() != numBase)
+    {
+        throw std::string("number of linkers / rigids differs from the checkpointed run");
+    }
+}
+
+// ****************************************************************************
+
+bool Checkpoint::Save(Instantiator& inst, const std::string& fileName, unsigned long long inputKey)
+{
+    // The output must be complete up to the checkpointed offset.
+    long long offset = OBWriter::OutputOffset();
+    if (OBWriter::OutputFailed())
+    {
+        std::cerr << "Writing the output failed; no checkpoint is written." << std::endl;
+        return false;
+    }
+
+    std::ostringstream tempName;
+    tempName << fileName << ".tmp." << getpid();
+
+    std::ofstream os(tempName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (os.fail())
+    {
+        std::cerr << "Unable to create checkpoint " << tempName.str() << std::endl;
+        return false;
+    }
+
+    BinaryWriter out(os);
+    HyperGraph<Molecule, EdgeAnnotationT>* graph = inst.graph;
+
+    out.WriteBytes(MAGIC, sizeof(MAGIC));
+    out.Write<unsigned int>(VERSION);
+    out.Write<unsigned int>(ENDIAN_CHECK);
+    WriteParameters(out, inputKey, inst.baseMolecules.size());
+
+    //
+    // Output state
+    //
+    out.Write<long long>(offset);
+    out.Write<unsigned int>(OBWriter::molIDmaker.peekNextId());
+    inst.writer->written.Write(out);
+
+    // With -ordered: the output held back for levels not yet complete.
+    std::vector<std::pair<AsyncWriter::Key, std::string> > held;
+    OBWriter::sdfWriter.GetHeld(held);
+
+    out.Write<unsigned long>(held.size());
+    for (unsigned long h = 0; h < held.size(); h++)
+    {
+        out.Write<unsigned int>(held[h].first.first);
+        out.WriteString(held[h].first.second);
+        out.WriteString(held[h].second);
+    }
+
+    //
+    // Validation: the first match above -tc of each validation molecule and the time
+    // since the validator was created (the output is drained, so nothing is observed).
+    //
+    Validator* validator = OBWriter::validator;
+    unsigned int numTargets = validator == 0 ? 0 : validator->titles.size();
+
+    out.Write<unsigned int>(numTargets);
+    if (numTargets > 0) out.Write<double>(Validator::Now() - validator->startTime);
+    for (unsigned int q = 0; q < numTargets; q++)
+    {
+        out.Write<unsigned int>(validator->firstHitLevel[q]);
+        out.Write<double>(validator->firstHitTime[q]);
+    }
+
+    //
+    // Levels
+    //
+    for (unsigned int m = 0; m <= HIERARCHICAL_LEVEL_BOUND; m++)
+    {
+        out.Write<unsigned char>(inst.completed_level[m]);
+        out.Write<int>(inst.moleculeLevelCount[m]);
+    }
+
+    //
+    // Hypergraph nodes (beyond the base molecules) and edges
+    //
+    out.Write<unsigned int>(graph->vertices.size());
+    for (unsigned int v = inst.baseMolecules.size(); v < graph->vertices.size(); v++)
+    {
+        MoleculeIO::WriteNode(out, graph->vertices[v].data);
+    }
+
+    for (unsigned int v = 0; v < graph->vertices.size(); v++)
+    {
+        const std::vector<HyperEdge<EdgeAnnotationT> >& edges = graph->vertices[v].edges;
+
+        out.Write<unsigned int>(edges.size());
+        for (unsigned int e = 0; e < edges.size(); e++)
+        {
+            out.Write<int>(edges[e].targetNode);
+
+            out.Write<unsigned int>(edges[e].sourceNodes.size());
+            for (unsigned int s = 0; s < edges[e].sourceNodes.size(); s++)
+            {
+                out.Write<int>(edges[e].sourceNodes[s]);
+            }
+
+            out.WriteString(edges[e].annotation.justification);
+            out.Write<unsigned char>(edges[e].annotation.active);
+        }
+    }
+
+    //
+    // Pending molecules; each queue is rotated once, preserving its order.
+    // Nothing consumes the last level, so its queue is not saved.
+    //
+    // A spill file error leaves a queue incomplete, so synthesis cannot continue
+    // either; the level threads stop once they resume.
+    //
+    try
+    {
+        for (unsigned int m = 2; m < HIERARCHICAL_LEVEL_BOUND; m++)
+        {
+            LevelQueue& queue = inst.level_queues[m];
+            unsigned long pending = queue.size();
+
+            out.Write<unsigned long>(pending);
+            for (unsigned long p = 0; p < pending; p++)
+            {
+                Molecule* mol = queue.pop();
+                MoleculeIO::WriteComplex(out, *mol);
+                queue.push(mol);
+            }
+        }
+    }
+    catch (const char* msg)
+    {
+        std::cerr << "Checkpoint: " << msg << std::endl;
+        inst.failed = true;
+
+        os.close();
+        unlink(tempName.str().c_str());
+        return false;
+    }
+
+    // End marker: the snapshot is complete.
+    out.WriteBytes(MAGIC, sizeof(MAGIC));
+
+    os.close();
+
+    if (os.fail() || rename(tempName.str().c_str(), fileName.c_str()) != 0)
+    {
+        std::cerr << "Failed writing checkpoint " << fileName << std::endl;
+        unlink(tempName.str().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************
+
+bool Checkpoint::Load(Instantiator& inst, const std::string& fileName, unsigned long long inputKey)
+{
+    MappedFile file;
+    if (!file.Open(fileName))
+    {
+        std::cerr << "Unable to open checkpoint " << fileName << std::endl;
+        return false;
+    }
+
+    HyperGraph<Molecule, EdgeAnnotationT>* graph = inst.graph;
+
+    try
+    {
+        BinaryReader in(file.Data(), file.Size());
+
+        char magic[sizeof(MAGIC)];
+        in.ReadBytes(magic, sizeof(magic));
+        if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) throw std::string("not a checkpoint file");
+        if (in.Read<unsigned int>() != VERSION) throw std::string("version mismatch");
+        if (in.Read<unsigned int>() != ENDIAN_CHECK) throw std::string("byte order mismatch");
+        CheckParameters(in, inputKey, inst.baseMolecules.size());
+
+        if (graph->vertices.size() != inst.baseMolecules.size())
+        {
+            throw std::string("the hypergraph must hold only the base molecules");
+        }
+
+        long long offset = in.Read<long long>();
+        OBWriter::molIDmaker.setNextId(in.Read<unsigned int>());
+        inst.writer->written.Read(in);
+
+        std::vector<std::pair<AsyncWriter::Key, std::string> > held(in.Read<unsigned long>());
+        for (unsigned long h = 0; h < held.size(); h++)
+        {
+            held[h].first.first = in.Read<unsigned int>();
+            held[h].first.second = in.ReadString();
+            held[h].second = in.ReadString();
+        }
+
+        unsigned int numTargets = in.Read<unsigned int>();
+        double validationElapsed = numTargets > 0 ? in.Read<double>() : 0.0;
+        std::vector<unsigned int> firstHitLevel(numTargets);
+        std::vector<double> firstHitTime(numTargets);
+        for (unsigned int q = 0; q < numTargets; q++)
+        {
+            firstHitLevel[q] = in.Read<unsigned int>();
+            firstHitTime[q] = in.Read<double>();
+        }
+
+        for (unsigned int m = 0; m <= HIERARCHICAL_LEVEL_BOUND; m++)
+        {
+            inst.completed_level[m] = in.Read<unsigned char>() != 0;
+            inst.moleculeLevelCount[m] = in.Read<int>();
+        }
+
+        unsigned int numVertices = in.Read<unsigned int>();
+        for (unsigned int v = inst.baseMolecules.size(); v < numVertices; v++)
+        {
+            Molecule node;
+            MoleculeIO::ReadNode(in, node);
+
+            if (node.getUniqueIndexID() != v) throw std::string("unexpected hypergraph node index");
+
+            graph->AppendNode(node);
+        }
+
+        for (unsigned int v = 0; v < numVertices; v++)
+        {
+            unsigned int numEdges = in.Read<unsigned int>();
+            for (unsigned int e = 0; e < numEdges; e++)
+            {
+                int target = in.Read<int>();
+
+                std::vector<int> sources(in.Read<unsigned int>());
+                for (unsigned int s = 0; s < sources.size(); s++)
+                {
+                    sources[s] = in.Read<int>();
+                }
+
+                EdgeAnnotationT annotation;
+                annotation.justification = in.ReadString();
+                annotation.active = in.Read<unsigned char>() != 0;
+
+                graph->vertices[v].AddEdge(HyperEdge<EdgeAnnotationT>(sources, target, annotation));
+            }
+        }
+
+        for (unsigned int m = 2; m < HIERARCHICAL_LEVEL_BOUND; m++)
+        {
+            unsigned long pending = in.Read<unsigned long>();
+            for (unsigned long p = 0; p < pending; p++)
+            {
+                Molecule* mol = MoleculeIO::ReadComplex(in);
+
+                if (mol->getUniqueIndexID() >= numVertices ||
+                    graph->GetNode(mol->getUniqueIndexID()).getFingerprint() == 0)
+                {
+                    mol->ReleaseOpenBabelMol();
+                    delete mol;
+                    throw std::string("pending molecule without a hypergraph node");
+                }
+
+                inst.RestoreIdentity(*mol);
+                inst.level_queues[m].push(mol);
+            }
+        }
+
+        in.ReadBytes(magic, sizeof(magic));
+        if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) throw std::string("incomplete checkpoint");
+
+        //
+        // Restore the first matches before the written molecules are observed again,
+        // so those keep the level and time at which they were first matched.
+        //
+        Validator* validator = OBWriter::validator;
+        if (validator != 0 && numTargets > 0)
+        {
+            if (validator->titles.size() != numTargets)
+            {
+                throw std::string("validation molecules (-v) differ from the checkpointed run");
+            }
+
+            validator->startTime = Validator::Now() - validationElapsed;
+            for (unsigned int q = 0; q < numTargets; q++)
+            {
+                validator->firstHitLevel[q] = firstHitLevel[q];
+                validator->firstHitTime[q] = firstHitTime[q];
+                if (firstHitTime[q] >= 0) validator->numRecovered++;
+            }
+        }
+
+        if (!OBWriter::ResumeFile(offset, held)) return false;
+    }
+    catch (const std::string& err)
+    {
+        std::cerr << "Unable to resume from checkpoint " << fileName << ": " << err << std::endl;
+        return false;
+    }
+    catch (const char* err)
+    {
+        std::cerr << "Unable to resume from checkpoint " << fileName << ": " << err << std::endl;
+        return false;
+    }
+
+    std::cerr << "Resumed from checkpoint " << fileName << " with " << graph->size()
+              << " molecules in the hypergraph." << std::endl;
+
+    return true;
+}
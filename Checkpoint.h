@@ -0,0 +1,45 @@
+#ifndef _CHECKPOINT_GUARD
+#define _CHECKPOINT_GUARD 1
+
+
+#include <string>
+
+
+class Instantiator;
+class OBWriter;
+
+
+//
+// A consistent snapshot of a synthesis run, taken while every level thread is paused
+// between molecules and the output pool has been drained:
+//
+//   - the synthesis parameters and a content key of the input fragment files
+//   - the output file offset and the OBWriter temporary file id counter
+//   - the canonical SMILES of the molecules written (duplicates are still skipped)
+//   - with -ordered, the output held back for levels not yet complete
+//   - the first match above -tc (level and time) of each validation molecule
+//   - completed levels and the per-level molecule counts
+//   - the hypergraph: compact nodes (fragment counts, fingerprint unless the level
+//     was retired) and hyperedges
+//   - the pending molecules of each level queue (except the last level, which
+//     nothing consumes)
+//
+// The snapshot is written to a temporary file and renamed, so the checkpoint file is
+// always the last complete snapshot.
+//
+class Checkpoint
+{
+  public:
+    static bool Save(Instantiator& instantiator, const std::string& fileName,
+                     unsigned long long inputKey);
+
+    // Restore a snapshot into an instantiator holding only the base molecules.
+    static bool Load(Instantiator& instantiator, const std::string& fileName,
+                     unsigned long long inputKey);
+
+  private:
+    static const char MAGIC[8];
+    static const unsigned int VERSION = 5;
+};
+
+#endif
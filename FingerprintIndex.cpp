@@ -0,0 +1,91 @@
+#include <vector>
+#include <string>
+
+
+#include <openbabel/mol.h>
+#include <openbabel/fingerprint.h>
+
+
+#include "FingerprintIndex.h"
+
+
+// ****************************************************************************
+
+FingerprintIndex::FingerprintIndex() : words(0), stride(0)
+{
+    pthread_mutex_init(&lock, NULL);
+}
+
+// ****************************************************************************
+
+FingerprintIndex::~FingerprintIndex()
+{
+    pthread_mutex_destroy(&lock);
+}
+
+// ****************************************************************************
+
+void FingerprintIndex::Compute(OpenBabel::OBMol& mol, std::vector<unsigned int>& fp)
+{
+    static OpenBabel::OBFingerprint* fpType = OpenBabel::OBFingerprint::FindFingerprint("");
+
+    fp.clear();
+    fpType->GetFingerprint(&mol, fp);
+}
+
+// ****************************************************************************
+
+unsigned int FingerprintIndex::StrideFor(unsigned int words)
+{
+    unsigned int words64 = (words + 1) / 2;
+
+    return (words64 + BLOCK_WORDS - 1) / BLOCK_WORDS * BLOCK_WORDS;
+}
+
+// ****************************************************************************
+
+void FingerprintIndex::Pack(const std::vector<unsigned int>& fp, unsigned int stride,
+                            unsigned long long* dest)
+{
+    for (unsigned int w = 0; w < stride; w++) dest[w] = 0;
+
+    for (unsigned int w = 0; w < fp.size() && w / 2 < stride; w++)
+    {
+        dest[w / 2] |= (unsigned long long)fp[w] << (32 * (w % 2));
+    }
+}
+
+// ****************************************************************************
+
+unsigned int FingerprintIndex::Add(const std::vector<unsigned int>& fp, const std::string& title)
+{
+    pthread_mutex_lock(&lock);
+
+    if (words == 0)
+    {
+        words = fp.size();
+        stride = StrideFor(words);
+    }
+
+    if (fp.size() != words)
+    {
+        pthread_mutex_unlock(&lock);
+        throw "Fingerprint width differs from the fingerprint index.";
+    }
+
+    unsigned long offset = bits.size();
+    bits.resize(offset + stride);
+    Pack(fp, stride, &bits[offset]);
+
+    unsigned int count = 0;
+    for (unsigned int w = 0; w < words; w++) count += __builtin_popcount(fp[w]);
+
+    popcounts.push_back(count);
+    titles.push_back(title);
+
+    unsigned int position = titles.size() - 1;
+
+    pthread_mutex_unlock(&lock);
+
+    return position;
+}
@@ -0,0 +1,75 @@
+#ifndef _FINGERPRINT_INDEX_GUARD
+#define _FINGERPRINT_INDEX_GUARD 1
+
+
+#include <vector>
+#include <string>
+#include <pthread.h>
+
+
+#include <openbabel/mol.h>
+
+
+//
+// The fingerprints of the synthesized molecules, computed once as each molecule
+// is written and stored back to back in a single bit-packed array so validation
+// is a Tanimoto scan (see TanimotoSearch).
+//
+// Each fingerprint occupies Stride() 64-bit words, a multiple of BLOCK_WORDS
+// (one 512-bit block); the padding is zero. The popcount of each fingerprint
+// is kept alongside so only |A & B| has to be computed during a search.
+//
+// Add is synchronized; lookups assume writing has finished.
+//
+class FingerprintIndex
+{
+  public:
+    FingerprintIndex();
+    ~FingerprintIndex();
+
+    // 64-bit words per 512-bit block.
+    static const unsigned int BLOCK_WORDS = 8;
+
+    // Compute the default Open Babel fingerprint of mol.
+    // The caller holds Molecule::openbabel_lock.
+    static void Compute(OpenBabel::OBMol& mol, std::vector<unsigned int>& fp);
+
+    // Number of 64-bit words (a multiple of BLOCK_WORDS) holding a fingerprint
+    // of the given number of 32-bit words.
+    static unsigned int StrideFor(unsigned int words);
+
+    // Pack a fingerprint into stride zero-padded 64-bit words at dest.
+    static void Pack(const std::vector<unsigned int>& fp, unsigned int stride,
+                     unsigned long long* dest);
+
+    // Append a fingerprint and return its position; all fingerprints in the
+    // index must be the same width.
+    unsigned int Add(const std::vector<unsigned int>& fp, const std::string& title);
+
+    unsigned int size() const { return titles.size(); }
+    unsigned int WordsPerFingerprint() const { return words; }
+    unsigned int Stride() const { return stride; }
+
+    const unsigned long long* Fingerprint(unsigned int index) const
+    {
+        return &bits[(unsigned long)index * stride];
+    }
+    unsigned int PopCount(unsigned int index) const { return popcounts[index]; }
+    const std::string& Title(unsigned int index) const { return titles[index]; }
+
+  private:
+    // Width of the fingerprints in 32-bit words (as produced by Open Babel).
+    unsigned int words;
+    unsigned int stride;
+
+    std::vector<unsigned long long> bits;
+    std::vector<unsigned int> popcounts;
+    std::vector<std::string> titles;
+
+    pthread_mutex_t lock;
+
+    FingerprintIndex(const FingerprintIndex&);
+    FingerprintIndex& operator=(const FingerprintIndex&);
+};
+
+#endif
@@ -0,0 +1,305 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+
+
+#include "FragmentCache.h"
+#include "BinaryIO.h"
+#include "MoleculeIO.h"
+#include "Molecule.h"
+#include "Linker.h"
+#include "Rigid.h"
+#include "Utilities.h"
+#include "OBWriter.h"
+#include "Instrumentation.h"
+
+
+const char FragmentCache::MAGIC[8] = { 'S', 'Y', 'N', 'F', 'R', 'A', 'G', 'C' };
+
+// Detects caches written on a machine with a different byte order.
+static const unsigned int ENDIAN_CHECK = 0x01020304;
+
+// ****************************************************************************
+
+FragmentCache::FragmentCache(const std::string& dir) : directory(dir)
+{
+    if (directory.empty()) directory = ".";
+}
+
+// ****************************************************************************
+
+std::string FragmentCache::CacheFileName(unsigned long long key) const
+{
+    std::ostringstream oss;
+
+    oss << directory << "/synth_fragments_" << std::hex << std::setw(16)
+        << std::setfill('0') << key << ".cache";
+
+    return oss.str();
+}
+
+// ****************************************************************************
+
+bool FragmentCache::HashInputs(const std::vector<std::string>& fileNames, unsigned long long& key)
+{
+    key = FNV_OFFSET_BASIS;
+
+    // The format version participates in the key.
+    unsigned int version = VERSION;
+    key = HashBytes(&version, sizeof(version), key);
+
+    for (std::vector<std::string>::const_iterator it = fileNames.begin();
+         it != fileNames.end(); it++)
+    {
+        if (!HashFile(*it, key)) return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************
+//
+// False if the cache file does not exist; throws if it is not a valid cache for key.
+// On error no fragments are returned.
+//
+bool FragmentCache::Read(const std::string& cacheFile,
+                         unsigned long long key,
+                         std::vector<Linker*>& cachedLinkers,
+                         std::vector<Rigid*>& cachedRigids,
+                         std::string& descriptorLog)
+{
+    MappedFile file;
+    if (!file.Open(cacheFile)) return false;
+
+    try
+    {
+        BinaryReader in(file.Data(), file.Size());
+
+        char magic[sizeof(MAGIC)];
+        in.ReadBytes(magic, sizeof(magic));
+        if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) throw std::string("bad magic");
+        if (in.Read<unsigned int>() != VERSION) throw std::string("version mismatch");
+        if (in.Read<unsigned int>() != ENDIAN_CHECK) throw std::string("byte order mismatch");
+        if (in.Read<unsigned long long>() != key) throw std::string("key mismatch");
+
+        unsigned int numLinkers = in.Read<unsigned int>();
+        unsigned int numRigids = in.Read<unsigned int>();
+
+        for (unsigned int ell = 0; ell < numLinkers; ell++)
+        {
+            Molecule* fragment = MoleculeIO::ReadFragment(in);
+            if (!fragment->IsLinker())
+            {
+                fragment->ReleaseOpenBabelMol();
+                delete fragment;
+                throw std::string("expected a linker");
+            }
+            cachedLinkers.push_back(static_cast<Linker*>(fragment));
+        }
+
+        for (unsigned int r = 0; r < numRigids; r++)
+        {
+            Molecule* fragment = MoleculeIO::ReadFragment(in);
+            if (!fragment->IsRigid())
+            {
+                fragment->ReleaseOpenBabelMol();
+                delete fragment;
+                throw std::string("expected a rigid");
+            }
+            cachedRigids.push_back(static_cast<Rigid*>(fragment));
+        }
+
+        descriptorLog = in.ReadString();
+    }
+    catch (const std::string&)
+    {
+        Delete(cachedLinkers, cachedRigids);
+        throw;
+    }
+
+    return true;
+}
+
+// ****************************************************************************
+
+bool FragmentCache::Load(const std::vector<std::string>& fileNames,
+                         std::vector<Linker*>& linkers,
+                         std::vector<Rigid*>& rigids,
+                         std::string& descriptorLog)
+{
+    unsigned long long key;
+    if (!HashInputs(fileNames, key)) return false;
+
+    std::vector<Linker*> cachedLinkers;
+    std::vector<Rigid*> cachedRigids;
+
+    try
+    {
+        if (!Read(CacheFileName(key), key, cachedLinkers, cachedRigids, descriptorLog)) return false;
+    }
+    catch (const std::string& err)
+    {
+        std::cerr << "Ignoring fragment cache " << CacheFileName(key) << ": " << err << std::endl;
+        return false;
+    }
+
+    linkers.insert(linkers.end(), cachedLinkers.begin(), cachedLinkers.end());
+    rigids.insert(rigids.end(), cachedRigids.begin(), cachedRigids.end());
+
+    std::cerr << "Loaded " << cachedLinkers.size() << " linkers and " << cachedRigids.size()
+              << " rigids from fragment cache " << CacheFileName(key) << std::endl;
+
+    return true;
+}
+
+// ****************************************************************************
+
+void FragmentCache::Delete(std::vector<Linker*>& linkers, std::vector<Rigid*>& rigids)
+{
+    for (unsigned int ell = 0; ell < linkers.size(); ell++)
+    {
+        linkers[ell]->ReleaseOpenBabelMol();
+        delete linkers[ell];
+    }
+
+    for (unsigned int r = 0; r < rigids.size(); r++)
+    {
+        rigids[r]->ReleaseOpenBabelMol();
+        delete rigids[r];
+    }
+
+    linkers.clear();
+    rigids.clear();
+}
+
+// ****************************************************************************
+//
+// The canonical SMILES of each fragment read back from cacheFile must equal that of
+// the freshly parsed fragment; otherwise a run from the cache could differ from one
+// that parses the libraries.
+//
+bool FragmentCache::Verify(const std::string& cacheFile,
+                           unsigned long long key,
+                           const std::vector<Linker*>& linkers,
+                           const std::vector<Rigid*>& rigids)
+{
+    std::vector<Linker*> cachedLinkers;
+    std::vector<Rigid*> cachedRigids;
+    std::string descriptorLog;
+
+    try
+    {
+        if (!Read(cacheFile, key, cachedLinkers, cachedRigids, descriptorLog))
+        {
+            throw std::string("unable to read the cache back");
+        }
+
+        if (cachedLinkers.size() != linkers.size() || cachedRigids.size() != rigids.size())
+        {
+            throw std::string("fragment counts differ");
+        }
+
+        std::vector<const Molecule*> parsed(linkers.begin(), linkers.end());
+        parsed.insert(parsed.end(), rigids.begin(), rigids.end());
+
+        std::vector<const Molecule*> cached(cachedLinkers.begin(), cachedLinkers.end());
+        cached.insert(cached.end(), cachedRigids.begin(), cachedRigids.end());
+
+        for (unsigned int f = 0; f < parsed.size(); f++)
+        {
+            Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+            std::string parsedSMI = OBWriter::CanonicalSMI(*parsed[f]->getOpenBabelMol());
+            std::string cachedSMI = OBWriter::CanonicalSMI(*cached[f]->getOpenBabelMol());
+
+            pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+            if (parsedSMI != cachedSMI)
+            {
+                throw std::string("canonical SMILES of ") + parsed[f]->getName() +
+                      " differ: " + parsedSMI + " (parsed), " + cachedSMI + " (cached)";
+            }
+        }
+    }
+    catch (const std::string& err)
+    {
+        std::cerr << "Discarding fragment cache " << cacheFile << ": " << err << std::endl;
+
+        Delete(cachedLinkers, cachedRigids);
+        return false;
+    }
+
+    Delete(cachedLinkers, cachedRigids);
+    return true;
+}
+
+// ****************************************************************************
+//
+// The cache is written to a temporary file and renamed so a partially written
+// cache is never observed.
+//
+bool FragmentCache::Save(const std::vector<std::string>& fileNames,
+                         const std::vector<Linker*>& linkers,
+                         const std::vector<Rigid*>& rigids,
+                         const std::string& descriptorLog)
+{
+    unsigned long long key;
+    if (!HashInputs(fileNames, key)) return false;
+
+    std::string cacheFile = CacheFileName(key);
+    std::ostringstream tempName;
+    tempName << cacheFile << ".tmp." << getpid();
+
+    std::ofstream os(tempName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (os.fail())
+    {
+        std::cerr << "Unable to create fragment cache " << cacheFile << std::endl;
+        return false;
+    }
+
+    BinaryWriter out(os);
+
+    out.WriteBytes(MAGIC, sizeof(MAGIC));
+    out.Write<unsigned int>(VERSION);
+    out.Write<unsigned int>(ENDIAN_CHECK);
+    out.Write<unsigned long long>(key);
+
+    out.Write<unsigned int>(linkers.size());
+    out.Write<unsigned int>(rigids.size());
+
+    foreach_linkers(l_it, linkers)
+    {
+        MoleculeIO::WriteFragment(out, **l_it);
+    }
+
+    foreach_rigids(r_it, rigids)
+    {
+        MoleculeIO::WriteFragment(out, **r_it);
+    }
+
+    out.WriteString(descriptorLog);
+
+    os.close();
+
+    if (os.fail() || rename(tempName.str().c_str(), cacheFile.c_str()) != 0)
+    {
+        std::cerr << "Failed writing fragment cache " << cacheFile << std::endl;
+        unlink(tempName.str().c_str());
+        return false;
+    }
+
+    if (!Verify(cacheFile, key, linkers, rigids))
+    {
+        unlink(cacheFile.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef _FRAGMENT_CACHE_GUARD
+#define _FRAGMENT_CACHE_GUARD 1
+
+
+#include <vector>
+#include <string>
+
+
+class Linker;
+class Rigid;
+
+
+//
+// A versioned binary cache of the parsed fragment libraries.
+//
+// The cache file is keyed by a content hash of the input files (names and contents,
+// in command-line order) and stores, for each linker / rigid, the Open Babel structure,
+// the local atoms (types, max-connect, allowable types) and bonds, and the Lipinski
+// descriptors. Loading memory-maps the file and bypasses SDF parsing and descriptor
+// prediction entirely. A new cache is read back once and kept only if every fragment
+// has the same canonical SMILES as when parsed.
+//
+class FragmentCache
+{
+  public:
+    FragmentCache(const std::string& directory);
+
+    // Compute the content key of the input files; false if a file cannot be read.
+    static bool HashInputs(const std::vector<std::string>& fileNames, unsigned long long& key);
+
+    // False if there is no (valid) cache for the given input files.
+    bool Load(const std::vector<std::string>& fileNames,
+              std::vector<Linker*>& linkers,
+              std::vector<Rigid*>& rigids,
+              std::string& descriptorLog);
+
+    bool Save(const std::vector<std::string>& fileNames,
+              const std::vector<Linker*>& linkers,
+              const std::vector<Rigid*>& rigids,
+              const std::string& descriptorLog);
+
+  private:
+    std::string directory;
+
+    std::string CacheFileName(unsigned long long key) const;
+
+    static bool Read(const std::string& cacheFile,
+                     unsigned long long key,
+                     std::vector<Linker*>& cachedLinkers,
+                     std::vector<Rigid*>& cachedRigids,
+                     std::string& descriptorLog);
+
+    // Compare the canonical SMILES of the cached and the parsed fragments.
+    static bool Verify(const std::string& cacheFile,
+                       unsigned long long key,
+                       const std::vector<Linker*>& linkers,
+                       const std::vector<Rigid*>& rigids);
+
+    static void Delete(std::vector<Linker*>& linkers, std::vector<Rigid*>& rigids);
+
+    static const char MAGIC[8];
+    static const unsigned int VERSION = 2;
+};
+
+#endif
@@ -16,15 +16,43 @@ FragmentGraph::FragmentGraph() : numFragments(0)
 
 // ***********************************************************************
 
+FragmentGraph::~FragmentGraph()
+{
+    for (int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        foreach_nodes(n_it, this->orderedNodes[f])
+        {
+            delete *n_it;
+        }
+    }
+
+    delete[] orderedNodes;
+}
+
+// ***********************************************************************
+//
+// Subnode connections are redirected to the copied subnodes so that the copy does not
+// reference (and outlive) the graph it was copied from.
+//
 FragmentGraph* FragmentGraph::copy() const
 {
     FragmentGraph* newGraph = new FragmentGraph();
 
+    std::map<const FragmentSubNode*, FragmentSubNode*> remap;
+
     for (int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
     {
         foreach_nodes(n_it, this->orderedNodes[f])
         {
-            newGraph->orderedNodes[f].push_back((*n_it)->copy());
+            newGraph->orderedNodes[f].push_back((*n_it)->copy(remap));
+        }
+    }
+
+    for (int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        foreach_nodes(n_it, newGraph->orderedNodes[f])
+        {
+            (*n_it)->remapConnections(remap);
         }
     }
 
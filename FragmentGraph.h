@@ -18,6 +18,9 @@ class FragmentGraph
 {
   public:
     FragmentGraph();
+    ~FragmentGraph();
+
+    // A deep copy: connections in the copy refer only to nodes of the copy.
     FragmentGraph* copy() const;
 
     // Returns the index of the new node
@@ -33,6 +36,10 @@ class FragmentGraph
     std::string toString() const;
     friend std::ostream& operator<< (std::ostream& os, const FragmentGraph& fg);
 
+    // Binary (de)serialization (checkpoints, hypergraph export).
+    friend class MoleculeIO;
+    friend class HyperGraphFile;
+
   private:
     // We order the nodes by the particular fragment used;
     // one list for each fragment 
@@ -40,6 +47,10 @@ class FragmentGraph
     unsigned int numFragments;
 
     void printMolecules() const;
+
+    // Graphs own their nodes; copy through copy().
+    FragmentGraph(const FragmentGraph&);
+    FragmentGraph& operator=(const FragmentGraph&);
 };
 	
 #endif
@@ -57,11 +57,24 @@ FragmentGraphNode::FragmentGraphNode(const Molecule* const mol, unsigned int id)
 }
 
 
+// ***********************************************************************
+
+FragmentGraphNode::~FragmentGraphNode()
+{
+    foreach_subnodes(s_it, this->subnodes)
+    {
+        delete *s_it;
+    }
+}
+
 // ***********************************************************************
 //
 // For copying (as part of copying of the entire graph).
+// The subnode copies still point to the original connections; once every node of the
+// graph is copied, remapConnections() redirects them into the copy.
 //
-FragmentGraphNode* FragmentGraphNode::copy() const
+FragmentGraphNode* FragmentGraphNode::copy(std::map<const FragmentSubNode*,
+                                                    FragmentSubNode*>& remap) const
 {
     FragmentGraphNode* theCopy = new FragmentGraphNode();
 
@@ -70,12 +83,27 @@ FragmentGraphNode* FragmentGraphNode::copy() const
     
     foreach_subnodes(s_it, this->subnodes)
     {
-        theCopy->subnodes.push_back((*s_it)->copy());
+        FragmentSubNode* subCopy = (*s_it)->copy();
+        subCopy->setParentNode(theCopy);
+
+        theCopy->subnodes.push_back(subCopy);
+        remap[*s_it] = subCopy;
     }
 
     return theCopy;
 }
 
+// ***********************************************************************
+
+void FragmentGraphNode::remapConnections(const std::map<const FragmentSubNode*,
+                                                        FragmentSubNode*>& remap)
+{
+    foreach_subnodes(s_it, this->subnodes)
+    {
+        (*s_it)->remapConnections(remap);
+    }
+}
+
 
 // ***********************************************************************
 //
@@ -89,6 +117,8 @@ FragmentSubNode* FragmentGraphNode::getSubNode(unsigned int id) const
     {
         if ((*it)->getSubNodeID() == id) return *it;
     }
+
+    return 0;
 }
 
 // ***********************************************************************
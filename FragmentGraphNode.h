@@ -5,6 +5,7 @@
 #include <vector>
 #include <iostream>
 #include <string>
+#include <map>
 
 
 #include "FragmentSubNode.h"
@@ -18,14 +19,18 @@ class FragmentGraphNode
   public:
     FragmentGraphNode();
     FragmentGraphNode(const Molecule* const mol, unsigned int id);
+    ~FragmentGraphNode();
 
-    FragmentGraphNode* copy() const;
+    // Copies the subnodes; each (original, copy) subnode pair is recorded in remap.
+    FragmentGraphNode* copy(std::map<const FragmentSubNode*, FragmentSubNode*>& remap) const;
+    void remapConnections(const std::map<const FragmentSubNode*, FragmentSubNode*>& remap);
 
     // The degree of this node (cardinality of the connections)
     unsigned int degree();
 
     const Molecule* getMolecule() const { return theMolecule; } 
     FragmentSubNode* getSubNode(unsigned int id) const;
+    const std::vector<FragmentSubNode*>& getSubNodes() const { return subnodes; }
     unsigned int getNodeID() const { return graphID; }
 
     bool IsIsomorphicTo(FragmentGraphNode* that) const;
@@ -38,6 +43,10 @@ class FragmentGraphNode
     unsigned int graphID;
     int theDegree;
     std::vector<FragmentSubNode*> subnodes;
+
+    // Nodes own their subnodes; copy through copy().
+    FragmentGraphNode(const FragmentGraphNode&);
+    FragmentGraphNode& operator=(const FragmentGraphNode&);
 };
 
 #endif
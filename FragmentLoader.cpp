@@ -0,0 +1,432 @@
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <pthread.h>
+
+
+#include <openbabel/obconversion.h>
+#include <openbabel/mol.h>
+#include <openbabel/generic.h>
+
+
+#include "FragmentLoader.h"
+#include "Molecule.h"
+#include "Linker.h"
+#include "Rigid.h"
+#include "Utilities.h"
+#include "Constants.h"
+#include "Instrumentation.h"
+
+
+// ****************************************************************************
+
+FragmentLoader::FragmentLoader(unsigned int threads) : numThreads(threads == 0 ? 1 : threads),
+                                                       inFiles(0),
+                                                       nextJob(0),
+                                                       numJobs(0),
+                                                       failed(false)
+{
+    pthread_mutex_init(&cursor_lock, NULL);
+}
+
+// ****************************************************************************
+//
+// Linkers are prefixed with 'l' and rigids with 'r'; the prefix is taken from
+// the file name itself (not any leading directories).
+//
+bool FragmentLoader::FragmentTypeFromFileName(const std::string& fileName, MoleculeT& type)
+{
+    std::string::size_type slash = fileName.find_last_of('/');
+    std::string base = slash == std::string::npos ? fileName : fileName.substr(slash + 1);
+
+    if (base.empty()) return false;
+
+    if (base[0] == 'l') type = LINKER;
+    else if (base[0] == 'r') type = RIGID;
+    else return false;
+
+    return true;
+}
+
+// ****************************************************************************
+
+bool FragmentLoader::splitMolecule(std::istream& infile, std::string& name,
+                                   std::string& prefix, std::string& suffix)
+{
+    prefix = "";
+    suffix = "";
+
+    std::string line = "";
+
+    // Eat #### in large files (if it exists)
+    eatWhiteLines(infile);
+    if (infile.peek() == '#')
+    {
+        getline(infile, line);
+        name = line;
+        eatWhiteLines(infile);
+    }
+
+    getline(infile, line);
+    prefix += line + '\n';
+
+    // Nothing left to read...
+    if (infile.eof() || infile.fail()) return false;
+
+    // Read the prefix (end indicated by END)
+    while(line.find("END") == std::string::npos && infile.good())
+    {
+        getline(infile, line);
+        prefix += line + '\n';
+    }
+
+    // Set suffix equal to remainder of the record
+    while (line.find("$$$$") == std::string::npos && infile.good())
+    {
+        getline(infile, line);
+        suffix += line + '\n';
+    }
+
+    return true;
+}
+
+// ****************************************************************************
+//
+// Phase (1): split a single file into its records.
+//
+void FragmentLoader::SplitFile(unsigned int fileIndex)
+{
+    const std::string& fileName = (*inFiles)[fileIndex];
+    std::vector<FragmentRecord>& records = fileRecords[fileIndex];
+
+    MoleculeT type;
+    FragmentTypeFromFileName(fileName, type);
+
+    std::ifstream infile;
+    infile.open(fileName.c_str());
+
+    if (infile.fail())
+    {
+        Fail("Unable to open fragment file " + fileName);
+        return;
+    }
+
+    FragmentRecord record;
+    record.fileName = fileName;
+    record.type = type;
+    record.molecule = 0;
+    record.name = "UNKNOWN";
+
+    while(splitMolecule(infile, record.name, record.prefix, record.suffix))
+    {
+        //
+        // If the name of molecule is not given, overwrite it with the name of the file.
+        //
+        if (record.name == "UNKNOWN")
+        {
+           record.name = "####   ";
+           record.name += fileName;
+           record.name += "    ####";
+        }
+
+        records.push_back(record);
+    }
+}
+
+// ****************************************************************************
+//
+// Phase (2): create the local linker / rigid from a single record.
+//
+void FragmentLoader::ParseRecord(FragmentRecord& record, OpenBabel::OBConversion& obConversion)
+{
+    if (g_debug_output) std::cerr << "Name: " << std::endl << record.name << std::endl;
+    if (g_debug_output) std::cerr << "Prefix: " << std::endl << record.prefix << std::endl;
+    if (g_debug_output) std::cerr << "Suffix: " << std::endl << record.suffix << std::endl;
+
+    //
+    // Create and parse using Open Babel; the format plugins keep per-format
+    // state so all Open Babel calls remain under the global lock.
+    //
+    OpenBabel::OBMol* mol = new OpenBabel::OBMol();
+
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    obConversion.ReadString(mol, record.prefix);
+
+    //
+    // Add the suffix as comment data to the actual OBMol object.
+    //
+    OpenBabel::OBCommentData* cData = new OpenBabel::OBCommentData();
+    cData->SetAttribute("Comment");
+    cData->SetData(record.suffix);
+    mol->SetData(cData);
+
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+    //
+    // Create this particular molecule type based on the name of the file.
+    // The appendix is parsed by the constructor; an atom type that cannot be
+    // interned (or a malformed appendix) fails the load.
+    //
+    Molecule* local = 0;
+    try
+    {
+        if (record.type == LINKER) local = new Linker(mol, record.name);
+        else local = new Rigid(mol, record.name);
+    }
+    catch (const std::string& error)
+    {
+        Fail(record.fileName + ": " + record.name + ": " + error);
+    }
+    catch (const char* error)
+    {
+        Fail(record.fileName + ": " + record.name + ": " + error);
+    }
+
+    if (local == 0)
+    {
+        Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+        delete mol;
+        pthread_mutex_unlock(&Molecule::openbabel_lock);
+        return;
+    }
+
+    // calculate the molecular weight, H donors and acceptors and the plogp
+    local->openBabelPredictLipinski();
+
+    // Buffer the logfile entry; all entries are written once, in order.
+    if (local->islipinskiPredicted())
+    {
+        std::ostringstream log;
+        log << record.fileName << "\nMolWt = " << local->getMolWt() << "\n";
+        log << "HBD = " << local->getHBD() << "\n";
+        log << "HBA1 = " << local->getHBA1() << "\n";
+        log << "logP = " << local->getlogP() << "\n";
+        log << "\n";
+        record.descriptorLog = log.str();
+    }
+    else std::cerr << "FragmentLoader: predictLipinski failed somehow!" << std::endl;
+
+    if (g_debug_output) std::cout << "Local: " << *local << "|" << std::endl;
+
+    record.molecule = local;
+
+    // The raw text is no longer needed.
+    std::string().swap(record.prefix);
+    std::string().swap(record.suffix);
+}
+
+// ****************************************************************************
+
+bool FragmentLoader::AcquireJob(unsigned int& job)
+{
+    bool acquired = false;
+
+    pthread_mutex_lock(&cursor_lock);
+    if (nextJob < numJobs)
+    {
+        job = nextJob++;
+        acquired = true;
+    }
+    pthread_mutex_unlock(&cursor_lock);
+
+    return acquired;
+}
+
+// ****************************************************************************
+
+void FragmentLoader::Fail(const std::string& message)
+{
+    pthread_mutex_lock(&cursor_lock);
+    if (!failed)
+    {
+        failed = true;
+        failure = message;
+    }
+    pthread_mutex_unlock(&cursor_lock);
+}
+
+// ****************************************************************************
+
+void* SplitFragmentFiles(void* args)
+{
+    FragmentLoader* This = (FragmentLoader*)args;
+
+    unsigned int job;
+    while (This->AcquireJob(job))
+    {
+        This->SplitFile(job);
+    }
+
+    return 0;
+}
+
+// ****************************************************************************
+
+void* ParseFragmentRecords(void* args)
+{
+    FragmentLoader* This = (FragmentLoader*)args;
+
+    // Each loader thread uses its own conversion object.
+    OpenBabel::OBConversion obConversion;
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+    obConversion.SetInFormat("SDF");
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+    unsigned int job;
+    while (This->AcquireJob(job))
+    {
+        std::pair<unsigned int, unsigned int> batch = This->recordBatches[job];
+        std::vector<FragmentLoader::FragmentRecord>& records = This->fileRecords[batch.first];
+
+        unsigned int end = std::min(batch.second + FragmentLoader::RECORD_BATCH_SIZE,
+                                    (unsigned int)records.size());
+
+        for (unsigned int r = batch.second; r < end; r++)
+        {
+            This->ParseRecord(records[r], obConversion);
+        }
+    }
+
+    return 0;
+}
+
+// ****************************************************************************
+//
+// Run a phase over the given number of jobs with the loader threads.
+//
+void FragmentLoader::RunPhase(unsigned int jobs, void* (*worker)(void*))
+{
+    nextJob = 0;
+    numJobs = jobs;
+
+    unsigned int threadCount = std::min(numThreads, jobs);
+    if (threadCount <= 1)
+    {
+        worker(this);
+        return;
+    }
+
+    std::vector<pthread_t> threads(threadCount);
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        if (pthread_create(&threads[t], NULL, worker, this) != 0)
+        {
+            std::cerr << "Loader thread " << t << " creation failed" << std::endl;
+            threads.resize(t);
+            break;
+        }
+    }
+
+    // Ensure all jobs complete even if thread creation failed.
+    if (threads.empty()) worker(this);
+
+    for (unsigned int t = 0; t < threads.size(); t++)
+    {
+        (void) pthread_join(threads[t], NULL);
+    }
+}
+
+// ****************************************************************************
+
+void FragmentLoader::WriteDescriptorLog(const std::string& log)
+{
+    std::ofstream logfile("synth_log_initial_fragments_logfile.txt",
+                          std::ofstream::out | std::ofstream::app); // append
+
+    logfile << log;
+    logfile.close();
+}
+
+// ****************************************************************************
+//
+// Parse each input data file; linkers and rigids are appended in command-line order.
+//
+bool FragmentLoader::Load(const std::vector<std::string>& fileNames,
+                          std::vector<Linker*>& linkers,
+                          std::vector<Rigid*>& rigids)
+{
+    MoleculeT type;
+    for (std::vector<std::string>::const_iterator it = fileNames.begin();
+         it != fileNames.end(); it++)
+    {
+        if (!FragmentTypeFromFileName(*it, type))
+        {
+            std::cerr << "Unexpected file prefix with file " << *it << std::endl;
+            return false;
+        }
+    }
+
+    inFiles = &fileNames;
+    failed = false;
+    failure = "";
+    descriptorLog = "";
+    fileRecords.clear();
+    fileRecords.resize(fileNames.size());
+
+    // (1) Split each file into its records.
+    RunPhase(fileNames.size(), SplitFragmentFiles);
+
+    if (failed)
+    {
+        std::cerr << failure << std::endl;
+        fileRecords.clear();
+        return false;
+    }
+
+    // (2) Parse batches of records.
+    recordBatches.clear();
+    for (unsigned int f = 0; f < fileRecords.size(); f++)
+    {
+        for (unsigned int r = 0; r < fileRecords[f].size(); r += RECORD_BATCH_SIZE)
+        {
+            recordBatches.push_back(std::make_pair(f, r));
+        }
+    }
+
+    RunPhase(recordBatches.size(), ParseFragmentRecords);
+
+    if (failed)
+    {
+        std::cerr << "Unable to parse fragment " << failure << std::endl;
+
+        for (unsigned int f = 0; f < fileRecords.size(); f++)
+        {
+            for (unsigned int r = 0; r < fileRecords[f].size(); r++)
+            {
+                Molecule* local = fileRecords[f][r].molecule;
+                if (local == 0) continue;
+
+                local->ReleaseOpenBabelMol();
+                delete local;
+            }
+        }
+
+        fileRecords.clear();
+        return false;
+    }
+
+    //
+    // Merge deterministically: file order, then record order within each file.
+    //
+    for (unsigned int f = 0; f < fileRecords.size(); f++)
+    {
+        for (unsigned int r = 0; r < fileRecords[f].size(); r++)
+        {
+            Molecule* local = fileRecords[f][r].molecule;
+            descriptorLog += fileRecords[f][r].descriptorLog;
+
+            if (fileRecords[f][r].type == LINKER) linkers.push_back(static_cast<Linker*>(local));
+            else rigids.push_back(static_cast<Rigid*>(local));
+        }
+    }
+
+    WriteDescriptorLog(descriptorLog);
+
+    fileRecords.clear();
+
+    return true;
+}
@@ -0,0 +1,98 @@
+#ifndef _FRAGMENT_LOADER_GUARD
+#define _FRAGMENT_LOADER_GUARD 1
+
+
+#include <vector>
+#include <string>
+#include <pthread.h>
+
+
+#include <openbabel/obconversion.h>
+
+
+#include "Atom.h"
+
+
+class Molecule;
+class Linker;
+class Rigid;
+
+
+//
+// Parses the linker and rigid library files given on the command-line.
+//
+// Loading is done in two parallel phases:
+//    (1) each file is split into its SDF records (prefix / suffix) by a loader thread;
+//    (2) batches of records are parsed (Open Babel, appendix, Lipinski descriptors)
+//        by the loader threads.
+// Records are then merged in command-line / file order so the resulting linker and
+// rigid lists (and therefore uniqueIndexID assignment) match a serial load exactly.
+//
+class FragmentLoader
+{
+  public:
+    FragmentLoader(unsigned int numThreads);
+
+    bool Load(const std::vector<std::string>& fileNames,
+              std::vector<Linker*>& linkers,
+              std::vector<Rigid*>& rigids);
+
+    // The fragment type is dictated by the first character of the file (base) name.
+    static bool FragmentTypeFromFileName(const std::string& fileName, MoleculeT& type);
+
+    // Lipinski descriptors of the loaded fragments, in load order.
+    const std::string& DescriptorLog() const { return descriptorLog; }
+    static void WriteDescriptorLog(const std::string& log);
+
+  private:
+    //
+    // A single SDF record and the result of parsing it (molecule is 0 if parsing failed).
+    //
+    struct FragmentRecord
+    {
+        std::string fileName;
+        std::string name;
+        std::string prefix;
+        std::string suffix;
+        MoleculeT type;
+
+        Molecule* molecule;
+        std::string descriptorLog;
+    };
+
+    unsigned int numThreads;
+
+    // Records, per input file, in file order.
+    std::vector<std::vector<FragmentRecord> > fileRecords;
+    const std::vector<std::string>* inFiles;
+
+    // Shared work cursor for the loader threads (also guards the failure below).
+    pthread_mutex_t cursor_lock;
+    unsigned int nextJob;
+    unsigned int numJobs;
+    std::vector<std::pair<unsigned int, unsigned int> > recordBatches;
+
+    void RunPhase(unsigned int jobs, void* (*worker)(void*));
+    bool AcquireJob(unsigned int& job);
+
+    // The first input file that could not be read or record that could not be parsed.
+    bool failed;
+    std::string failure;
+    void Fail(const std::string& message);
+
+    void SplitFile(unsigned int fileIndex);
+    void ParseRecord(FragmentRecord& record, OpenBabel::OBConversion& obConversion);
+
+    static bool splitMolecule(std::istream& infile, std::string& name,
+                              std::string& prefix, std::string& suffix);
+
+    std::string descriptorLog;
+
+    friend void* SplitFragmentFiles(void* args);
+    friend void* ParseFragmentRecords(void* args);
+
+    // Number of records parsed per work unit.
+    static const unsigned int RECORD_BATCH_SIZE = 8;
+};
+
+#endif
@@ -2,6 +2,10 @@
 #define _FRAGMENT_SUB_NODE_GUARD 1
 
 
+#include <map>
+#include <vector>
+
+
 class FragmentGraphNode;
 
 
@@ -10,10 +14,16 @@ class FragmentSubNode
   public:
     FragmentSubNode();
     FragmentSubNode(unsigned int id, FragmentGraphNode* parent);
+    virtual ~FragmentSubNode() {}
 
     virtual unsigned int degree() = 0;
     virtual FragmentSubNode* copy() const = 0;
     virtual void addConnection(FragmentSubNode* connector) = 0;
+
+    // Redirect connections from the subnodes of a copied graph to their copies.
+    virtual void remapConnections(const std::map<const FragmentSubNode*, FragmentSubNode*>& remap) = 0;
+
+    virtual void getConnections(std::vector<FragmentSubNode*>& conns) const = 0;
     virtual bool IsIsomorphicTo(FragmentSubNode* that) = 0;
 
     inline unsigned int getSubNodeID() const { return uniqueSubnodeID; }
@@ -22,6 +32,7 @@ class FragmentSubNode
     friend std::ostream& operator<< (std::ostream& os, const FragmentSubNode& node);
 
     FragmentGraphNode* getParentNode() const { return parentFragmentNode; }
+    void setParentNode(FragmentGraphNode* parent) { parentFragmentNode = parent; }
 
   protected:
     unsigned int uniqueSubnodeID;
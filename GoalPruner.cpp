@@ -0,0 +1,276 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+
+#include <openbabel/mol.h>
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/parsmart.h>
+
+
+#include "GoalPruner.h"
+#include "Molecule.h"
+#include "Utilities.h"
+#include "Instrumentation.h"
+
+
+// ****************************************************************************
+
+GoalPruner::GoalPruner()
+{
+}
+
+// ****************************************************************************
+
+GoalPruner::~GoalPruner()
+{
+    for (unsigned int t = 0; t < targets.size(); t++) delete targets[t];
+}
+
+// ****************************************************************************
+
+bool GoalPruner::Load(const std::string& fileName)
+{
+    std::ifstream in(fileName.c_str());
+    if (!in.is_open()) return false;
+
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    OpenBabel::OBConversion obConversion;
+    obConversion.SetInFormat("MOL2");
+
+    OpenBabel::OBMol* mol = new OpenBabel::OBMol();
+    while (obConversion.Read(mol, &in))
+    {
+        targets.push_back(mol);
+        titles.push_back(mol->GetTitle());
+        mol = new OpenBabel::OBMol();
+    }
+    delete mol;
+
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+    return !targets.empty();
+}
+
+// ****************************************************************************
+
+// Ring-closure bond (of any order) with the given number.
+static std::string RingClosure(unsigned int number)
+{
+    std::ostringstream oss;
+
+    oss << "~";
+    if (number < 10) oss << number;
+    else oss << "%" << number;
+
+    return oss.str();
+}
+
+// ****************************************************************************
+//
+// A SMARTS pattern for the heavy-atom graph of mol: atoms by element only,
+// bonds of any order. Written depth first with ring closures for the non-tree bonds.
+//
+std::string GoalPruner::HeavyAtomSmarts(OpenBabel::OBMol& mol)
+{
+    unsigned int numAtoms = mol.NumAtoms();
+
+    // Heavy-atom adjacency (Open Babel atom indices start at 1).
+    std::vector<std::vector<unsigned int> > adjacent(numAtoms + 1);
+    for (unsigned int b = 0; b < mol.NumBonds(); b++)
+    {
+        OpenBabel::OBBond* bond = mol.GetBond(b);
+        unsigned int u = bond->GetBeginAtomIdx();
+        unsigned int v = bond->GetEndAtomIdx();
+
+        if (mol.GetAtom(u)->IsHydrogen() || mol.GetAtom(v)->IsHydrogen()) continue;
+
+        adjacent[u].push_back(v);
+        adjacent[v].push_back(u);
+    }
+
+    //
+    // (1) Depth-first spanning forest; each non-tree bond becomes a ring closure
+    //     recorded on both of its atoms.
+    //
+    std::vector<int> parent(numAtoms + 1, -1);
+    std::vector<bool> visited(numAtoms + 1, false);
+    std::vector<std::vector<unsigned int> > children(numAtoms + 1);
+    std::vector<std::vector<unsigned int> > closures(numAtoms + 1);
+    std::vector<unsigned int> roots;
+    unsigned int numClosures = 0;
+
+    for (unsigned int a = 1; a <= numAtoms; a++)
+    {
+        if (visited[a] || mol.GetAtom(a)->IsHydrogen()) continue;
+
+        roots.push_back(a);
+
+        std::vector<unsigned int> stack(1, a);
+        visited[a] = true;
+
+        std::vector<unsigned int> next(numAtoms + 1, 0);
+        while (!stack.empty())
+        {
+            unsigned int u = stack.back();
+
+            if (next[u] == adjacent[u].size())
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            unsigned int v = adjacent[u][next[u]++];
+
+            if (!visited[v])
+            {
+                visited[v] = true;
+                parent[v] = u;
+                children[u].push_back(v);
+                stack.push_back(v);
+            }
+            // A bond back to an atom on the stack (other than the tree bond) closes a ring.
+            else if ((int)v != parent[u] && std::find(stack.begin(), stack.end(), v) != stack.end())
+            {
+                numClosures++;
+                closures[v].push_back(numClosures);
+                closures[u].push_back(numClosures);
+            }
+        }
+    }
+
+    //
+    // (2) Emit each tree: atom, its ring closures, then its children
+    //     (all but the last in parentheses).
+    //
+    std::ostringstream smarts;
+
+    for (unsigned int r = 0; r < roots.size(); r++)
+    {
+        if (r > 0) smarts << ".";
+
+        // (atom, child position) pairs; position == children.size() means the atom is done.
+        std::vector<std::pair<unsigned int, unsigned int> > stack;
+        stack.push_back(std::make_pair(roots[r], 0));
+
+        smarts << "[#" << mol.GetAtom(roots[r])->GetAtomicNum() << "]";
+        for (unsigned int c = 0; c < closures[roots[r]].size(); c++)
+        {
+            smarts << RingClosure(closures[roots[r]][c]);
+        }
+
+        while (!stack.empty())
+        {
+            unsigned int u = stack.back().first;
+            unsigned int pos = stack.back().second;
+
+            if (pos == children[u].size())
+            {
+                stack.pop_back();
+                if (!stack.empty() && stack.back().second < children[stack.back().first].size())
+                {
+                    smarts << ")";
+                }
+                continue;
+            }
+
+            stack.back().second++;
+
+            unsigned int v = children[u][pos];
+            bool last = pos + 1 == children[u].size();
+
+            if (!last) smarts << "(";
+            smarts << "~[#" << mol.GetAtom(v)->GetAtomicNum() << "]";
+            for (unsigned int c = 0; c < closures[v].size(); c++)
+            {
+                smarts << RingClosure(closures[v][c]);
+            }
+
+            stack.push_back(std::make_pair(v, 0));
+        }
+    }
+
+    return smarts.str();
+}
+
+// ****************************************************************************
+
+void GoalPruner::Prepare(const std::vector<Molecule*>& baseMolecules)
+{
+    maxCounts.assign(targets.size(), std::vector<unsigned int>(Molecule::NUM_UNIQUE_FRAGMENTS, 0));
+    heavyAtoms.assign(targets.size(), 0);
+
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    for (unsigned int t = 0; t < targets.size(); t++) heavyAtoms[t] = targets[t]->NumHvyAtoms();
+
+    foreach_molecules(m_it, baseMolecules)
+    {
+        OpenBabel::OBSmartsPattern pattern;
+        if (!pattern.Init(HeavyAtomSmarts(*(*m_it)->getOpenBabelMol())))
+        {
+            // Without a pattern the fragment cannot be bounded.
+            for (unsigned int t = 0; t < targets.size(); t++)
+            {
+                maxCounts[t][(*m_it)->getUniqueIndexID()] = heavyAtoms[t];
+            }
+            continue;
+        }
+
+        for (unsigned int t = 0; t < targets.size(); t++)
+        {
+            unsigned int count = 0;
+            if (pattern.Match(*targets[t])) count = pattern.GetUMapList().size();
+
+            maxCounts[t][(*m_it)->getUniqueIndexID()] = count;
+        }
+    }
+
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+    //
+    // Report the targets no fragment combination can produce.
+    //
+    for (unsigned int t = 0; t < targets.size(); t++)
+    {
+        unsigned int total = 0;
+        for (unsigned int f = 0; f < maxCounts[t].size(); f++) total += maxCounts[t][f];
+
+        if (total == 0)
+        {
+            std::cerr << "Goal pruning: no fragment occurs in target " << titles[t] << std::endl;
+        }
+
+        delete targets[t];
+    }
+    targets.clear();
+}
+
+// ****************************************************************************
+
+bool GoalPruner::CanExtend(const Molecule& mol) const
+{
+    // Level threads call this concurrently; the local atoms need no Open Babel lock.
+    unsigned int molHeavyAtoms = mol.getNumberOfHeavyAtoms();
+
+    for (unsigned int t = 0; t < maxCounts.size(); t++)
+    {
+        if (molHeavyAtoms > heavyAtoms[t]) continue;
+
+        bool within = true;
+        for (unsigned int f = 0; within && f < maxCounts[t].size(); f++)
+        {
+            within = mol.FragmentCount(f) <= maxCounts[t][f];
+        }
+
+        if (within) return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,59 @@
+#ifndef _GOAL_PRUNER_GUARD
+#define _GOAL_PRUNER_GUARD 1
+
+
+#include <vector>
+#include <string>
+
+
+#include <openbabel/mol.h>
+
+
+class Molecule;
+
+
+//
+// Goal-directed pruning (-prune): only molecules that can still grow into one of
+// the validation targets are extended.
+//
+// For every target the number of occurrences of each base fragment is bounded by
+// substructure matching: the heavy-atom graph of the fragment (elements only, any
+// bond) is matched against the target and the unique matches are counted. Since
+// composition only adds bonds between fragments, a molecule built toward the target
+// contains each fragment at most that many times and has no more heavy atoms than
+// the target. A molecule whose fragment counts are not within the composition bound
+// of any target is never extended.
+//
+class GoalPruner
+{
+  public:
+    GoalPruner();
+    ~GoalPruner();
+
+    // Read the targets (MOL2); false if none could be read.
+    bool Load(const std::string& fileName);
+
+    // Derive the composition bounds of each target against the base fragments
+    // (indexed by their unique index id); the targets are released afterward.
+    void Prepare(const std::vector<Molecule*>& baseMolecules);
+
+    // Could mol be (part of) some target?
+    bool CanExtend(const Molecule& mol) const;
+
+    unsigned int NumTargets() const { return heavyAtoms.size(); }
+
+  private:
+    std::vector<OpenBabel::OBMol*> targets;
+    std::vector<std::string> titles;
+
+    // maxCounts[t][f]: upper bound of fragment f occurrences in target t.
+    std::vector<std::vector<unsigned int> > maxCounts;
+    std::vector<unsigned int> heavyAtoms;
+
+    static std::string HeavyAtomSmarts(OpenBabel::OBMol& mol);
+
+    GoalPruner(const GoalPruner&);
+    GoalPruner& operator=(const GoalPruner&);
+};
+
+#endif
@@ -4,112 +4,241 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <sstream>
 
-#include "Molecule.h"
-
-#include "HyperGraph.h"
 #include "PebblerHyperEdge.h"
 #include "EdgeAnnotation.h"
 #include "Utilities.h"
 
+//
+// A set of hyperedges indexed by target (goal) node and by source node.
+//
+// Edges are stored once, in insertion order. Each index is an open-addressing hash
+// table (linear probing, power-of-two capacity, at most half full; it doubles as it
+// fills) from a node to the head of a chain of links; a link names an edge and the
+// next link of the same node. Chains are walked in place:
+//
+//     for (int l = map.FirstByGoal(goal); l != -1; l = map.Next(l)) use(map.GetEdge(l));
+//
 template<class A>
 class HyperEdgeMultiMap
 {
   public:
-    int getSize() { return size; }
+    int getSize() const { return edges.size(); }
     HyperEdgeMultiMap();
-    HyperEdgeMultiMap(int sz);
-    ~HyperEdgeMultiMap();
-    void Put(const PebblerHyperEdge<A>& edge);
-    std::vector<PebblerHyperEdge<A> > GetBasedOnGoal(int goalNodeIndex);
+    // Capacity for the given number of nodes without resizing.
+    HyperEdgeMultiMap(int expectedNodes);
+    ~HyperEdgeMultiMap() {}
+
+    // Adds the edge unless an equal edge is present; returns whether it was added.
+    bool Put(const PebblerHyperEdge<A>& edge);
+    void Clear();
+
+    // Chains of links (-1 ends a chain).
+    int FirstByGoal(int goalNodeIndex) const { return Find(goalIndex, goalNodeIndex); }
+    int FirstBySource(int sourceNodeIndex) const { return Find(sourceIndex, sourceNodeIndex); }
+    int Next(int link) const { return links[link].next; }
+    const PebblerHyperEdge<A>& GetEdge(int link) const { return edges[links[link].edge]; }
+
+    std::vector<PebblerHyperEdge<A> > GetBasedOnGoal(int goalNodeIndex) const;
+    std::vector<PebblerHyperEdge<A> > GetBasedOnSource(int sourceNodeIndex) const;
+
     std::string toString() const;
 
   private:
-    const int TABLE_SIZE;
-    std::vector<PebblerHyperEdge<A> >* table;
-    int size; // Number of total hyper-edges
+    struct Slot
+    {
+        int node;   // -1 if empty
+        int head;   // first link
+    };
+
+    struct ChainLink
+    {
+        int edge;
+        int next;
+    };
+
+    struct Index
+    {
+        std::vector<Slot> slots;
+        unsigned int used;
+    };
+
+    std::vector<PebblerHyperEdge<A> > edges;
+    std::vector<ChainLink> links;
+
+    Index goalIndex;
+    Index sourceIndex;
+
+    static const unsigned int MIN_CAPACITY = 16;
+
+    static unsigned int Hash(int node) { return (unsigned int)node * 2654435761U; }
+
+    static void Reset(Index& index, unsigned int capacity);
+    static unsigned int Probe(const Index& index, int node);
+    int Find(const Index& index, int node) const;
+    void AddLink(Index& index, int node, int edge);
 };
 
-// If the user specifies the size, we will never have to rehash
 template<class A>
-HyperEdgeMultiMap<A>::HyperEdgeMultiMap() : TABLE_SIZE(1000)
+HyperEdgeMultiMap<A>::HyperEdgeMultiMap()
 {
-    size = 0;            
-    table = new std::vector<PebblerHyperEdge<A> >[TABLE_SIZE];
+    Reset(goalIndex, MIN_CAPACITY);
+    Reset(sourceIndex, MIN_CAPACITY);
 }
 
-// If the user specifies the size, we will never have to rehash
 template<class A>
-HyperEdgeMultiMap<A>::HyperEdgeMultiMap(int sz) : TABLE_SIZE(sz) 
+HyperEdgeMultiMap<A>::HyperEdgeMultiMap(int expectedNodes)
 {
-    size = 0;
-    table = new std::vector<PebblerHyperEdge<A> >[TABLE_SIZE];
+    unsigned int capacity = MIN_CAPACITY;
+    while (capacity < 2 * (unsigned int)expectedNodes) capacity *= 2;
+
+    Reset(goalIndex, capacity);
+    Reset(sourceIndex, capacity);
 }
 
 template<class A>
-HyperEdgeMultiMap<A>::~HyperEdgeMultiMap()
+void HyperEdgeMultiMap<A>::Reset(Index& index, unsigned int capacity)
 {
-    //    delete table;
+    Slot empty = { -1, -1 };
+
+    index.slots.assign(capacity, empty);
+    index.used = 0;
 }
 
 //
-// Add the PebblerHyperEdge to all source node hash values
+// The slot holding node, or the empty slot where it belongs.
 //
 template<class A>
-void HyperEdgeMultiMap<A>::Put(const PebblerHyperEdge<A>& edge)
+unsigned int HyperEdgeMultiMap<A>::Probe(const Index& index, int node)
+{
+    unsigned int mask = index.slots.size() - 1;
+
+    unsigned int s = Hash(node) & mask;
+    while (index.slots[s].node != -1 && index.slots[s].node != node) s = (s + 1) & mask;
+
+    return s;
+}
+
+template<class A>
+int HyperEdgeMultiMap<A>::Find(const Index& index, int node) const
 {
-    //
-    // Analyze the edge to determine if it is a mixed edge; all edges are
-    // such that the target is greater than or less than all source nodes
-    // Find the minimum non-intrinsic node (if it exists)
-    //
-    std::sort(edge.sourceNodes.begin(), edge.sourceNodes.end());
-
-    if (edge.sourceNodes.size() >= 2)
+    return index.slots[Probe(index, node)].head;
+}
+
+//
+// Prepend a link to edge to the chain of node, growing the table past half full.
+//
+template<class A>
+void HyperEdgeMultiMap<A>::AddLink(Index& index, int node, int edge)
+{
+    if (2 * (index.used + 1) > index.slots.size())
     {
-        if (edge.sourceNodes[0] < edge.targetNode && edge.targetNode < edge.sourceNodes[edge.sourceNodes.size()-1])
+        std::vector<Slot> old;
+        old.swap(index.slots);
+
+        Reset(index, 2 * old.size());
+
+        for (unsigned int s = 0; s < old.size(); s++)
         {
-            throw MakeString("A mixed edge was pebbled as valid: ", edge.toString());
-        }       
+            if (old[s].node == -1) continue;
+
+            index.slots[Probe(index, old[s].node)] = old[s];
+            index.used++;
+        }
+    }
+
+    Slot& slot = index.slots[Probe(index, node)];
+    if (slot.node == -1)
+    {
+        slot.node = node;
+        index.used++;
+    }
+
+    ChainLink link = { edge, slot.head };
+    slot.head = links.size();
+    links.push_back(link);
+}
+
+//
+// Add the PebblerHyperEdge (once) under its target node and each distinct source node
+//
+template<class A>
+bool HyperEdgeMultiMap<A>::Put(const PebblerHyperEdge<A>& edge)
+{
+    if (edge.targetNode < 0) throw MakeString("HyperEdgeMultimap::Put::key", edge.targetNode);
+
+    for (int l = FirstByGoal(edge.targetNode); l != -1; l = Next(l))
+    {
+        if (GetEdge(l).Equals(edge)) return false;
     }
 
-    long hashVal = (edge.targetNode % TABLE_SIZE);
+    int e = edges.size();
+    edges.push_back(edge);
+
+    AddLink(goalIndex, edge.targetNode, e);
 
-    if (Contains(table[hashVal], edge)) table[hashVal].push_back(edge);
+    std::vector<int> sources = edge.sourceNodes;
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
 
-    size++;
+    for (int s = 0; s < sources.size(); s++)
+    {
+        AddLink(sourceIndex, sources[s], e);
+    }
+
+    return true;
+}
+
+template<class A>
+void HyperEdgeMultiMap<A>::Clear()
+{
+    edges.clear();
+    links.clear();
+
+    // Keep the capacity reached so far.
+    Reset(goalIndex, goalIndex.slots.size());
+    Reset(sourceIndex, sourceIndex.slots.size());
 }
 
 // Acquire pertinent problems based on target nodes
 template<class A>
-std::vector<PebblerHyperEdge<A> > HyperEdgeMultiMap<A>::GetBasedOnGoal(int goalNodeIndex)
+std::vector<PebblerHyperEdge<A> > HyperEdgeMultiMap<A>::GetBasedOnGoal(int goalNodeIndex) const
 {
-    if (goalNodeIndex < 0 || goalNodeIndex >= TABLE_SIZE)
+    std::vector<PebblerHyperEdge<A> > goalEdges;
+
+    for (int l = FirstByGoal(goalNodeIndex); l != -1; l = Next(l))
     {
-        throw MakeString("HyperEdgeMultimap::Get::key", goalNodeIndex);
+        goalEdges.push_back(GetEdge(l));
     }
 
-    return table[goalNodeIndex];
+    return goalEdges;
+}
+
+template<class A>
+std::vector<PebblerHyperEdge<A> > HyperEdgeMultiMap<A>::GetBasedOnSource(int sourceNodeIndex) const
+{
+    std::vector<PebblerHyperEdge<A> > sourceEdges;
+
+    for (int l = FirstBySource(sourceNodeIndex); l != -1; l = Next(l))
+    {
+        sourceEdges.push_back(GetEdge(l));
+    }
+
+    return sourceEdges;
 }
 
 template<class A>
 std::string HyperEdgeMultiMap<A>::toString() const
 {
-    std::string retS = "";
+    std::ostringstream oss;
 
-    for (int ell = 0; ell < TABLE_SIZE; ell++)
+    for (int e = 0; e < edges.size(); e++)
     {
-        if (!table[ell].empty())
-        {
-            retS += ell + ":\n";
-            for (int e = 0; e < table[ell].size(); e++)
-            {
-                retS += table[ell][e].toString() + "\n";
-            }
-        }
+        oss << edges[e].toString() << "\n";
     }
 
-    return retS;
+    return oss.str();
 }
 
 #endif
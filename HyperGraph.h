@@ -13,6 +13,7 @@
 #include "HyperEdge.h"
 #include "Utilities.h"
 #include "Constants.h"
+#include "Instrumentation.h"
 
 //
 // The goal is three-fold in this class.
@@ -46,6 +47,8 @@ class HyperGraph
     bool HasNode(const T& inputData);
     T GetNode(const T& inputData);
     bool AddNode(const T& inputData);
+    // Add a node known to be distinct from all others (restoring a saved graph).
+    void AppendNode(const T& inputData);
     // Check if the graph contains an edge defined by a many to one clause mapping
     bool HasEdge(const std::vector<T>& antecedent, const T& consequent);
     void AddEdge(const std::vector<T>& antecedent, const T& consequent, const A& annotation);
@@ -57,6 +60,9 @@ class HyperGraph
     PebblerHyperGraph<T, A> GetPebblerHyperGraph() const;
     std::vector<T> CollectData() const;
 
+    // Indices of the nodes of the given size.
+    const std::vector<int>& GetBucket(unsigned int sz) const { return buckets[sz]; }
+
 
   private:
     // Check if the graph contains this specific grounded clause
@@ -69,6 +75,14 @@ class HyperGraph
     // A 'database' of nodes based on the size; the class T must implement a method called size
     // These are buckets to expedite searching for equivalent molecules.
     std::vector<int>* buckets;
+
+    // Record a linear scan of the bucket for size sz.
+    void CountBucketScan(int sz) const
+    {
+        Instrumentation::Add(Instrumentation::BUCKET_SCANS);
+        Instrumentation::Add(Instrumentation::BUCKET_NODES_SCANNED, buckets[sz].size());
+        Instrumentation::Max(Instrumentation::BUCKET_SIZE_MAX, buckets[sz].size());
+    }
 };
 
 
@@ -80,31 +94,36 @@ template<class T, class A>
 PebblerHyperGraph<T, A> HyperGraph<T, A>::GetPebblerHyperGraph() const
 {
     //
-    // Strictly create the nodes
+    // Strictly create the nodes (index and level; the data is not copied)
     //
     std::vector<PebblerHyperNode<T, A> > pebblerNodes;
+    pebblerNodes.reserve(vertices.size());
     for (int v = 0; v < vertices.size(); v++)
     {
-        pebblerNodes.push_back(PebblerHyperNode<T, A>(vertices[v].data, vertices[v].id));
+        pebblerNodes.push_back(PebblerHyperNode<T, A>(vertices[v].id, vertices[v].data.size()));
     }
 
     //
-    // Create all hyperedges
+    // Create all hyperedges; an edge is stored at each of its (distinct) source nodes,
+    // so it is taken from its smallest source only.
     //
+    std::vector<PebblerHyperEdge<A> > pebblerEdges;
     for (int v = 0; v < vertices.size(); v++)
     {
-        HyperNode<T, A> node = vertices[v];
-
-        for (int e = 0; e < node.edges.size(); e++)
+        for (int e = 0; e < vertices[v].edges.size(); e++)
         {
-            std::sort(node.edges[e].sourceNodes.begin(), node.edges[e].sourceNodes.end());
+            const HyperEdge<A>& edge = vertices[v].edges[e];
+
+            std::vector<int> sources = edge.sourceNodes;
+            std::sort(sources.begin(), sources.end());
 
-            pebblerNodes[v].edges.push_back(PebblerHyperEdge<A>(node.edges[e].sourceNodes,
-                                            node.edges[e].targetNode, node.edges[e].annotation));
+            if (sources.empty() || sources[0] != v) continue;
+
+            pebblerEdges.push_back(PebblerHyperEdge<A>(sources, edge.targetNode, edge.annotation));
         }
     }
 
-    return PebblerHyperGraph<T, A>(pebblerNodes);
+    return PebblerHyperGraph<T, A>(pebblerNodes, pebblerEdges);
 }
 
 
@@ -114,6 +133,7 @@ template<class T, class A>
 int HyperGraph<T, A>::ConvertToLocalIntegerIndex(const T& inputData)
 {
     int sz = inputData.size();
+    CountBucketScan(sz);
 
     for (std::vector<int>::const_iterator it = buckets[sz].begin();
          it != buckets[sz].end();
@@ -157,6 +177,7 @@ bool HyperGraph<T, A>::HasNode(const T& inputData)
     // Only check the exact set of nodes that have the same 'size'.
     // The particular bucket contains indices.
     int sz = inputData.size();
+    CountBucketScan(sz);
 
     for (std::vector<int>::const_iterator it = buckets[sz].begin(); it != buckets[sz].end(); it++)
     {
@@ -175,6 +196,7 @@ T HyperGraph<T, A>::GetNode(const T& inputData)
     // Only check the exact set of nodes that have the same 'size'.
     // The particular bucket contains indices.
     int sz = inputData.size();
+    CountBucketScan(sz);
 
     for (std::vector<int>::const_iterator it = buckets[sz].begin(); it != buckets[sz].end(); it++)
     {
@@ -202,17 +224,30 @@ bool HyperGraph<T, A>::AddNode(const T& inputData)
 }
 
 //
-// Is this edge in the graph (using local, integer-based information)
+// Add a node without the isomorphism check
+//
+template<class T, class A>
+void HyperGraph<T, A>::AppendNode(const T& inputData)
+{
+    vertices.push_back(HyperNode<T, A>(inputData, vertices.size()));
+
+    buckets[inputData.size()].push_back(vertices.size() - 1);
+}
+
+//
+// Is this edge in the graph (using local, integer-based information); an edge is
+// stored at each of its source nodes, so only the first source is searched.
 //
 template<class T, class A>
 bool HyperGraph<T, A>::HasLocalEdge(const std::vector<int>& antecedent, int consequent)
 {
-    for (int v = 0; v < vertices.size(); v++) 
+    if (antecedent.empty()) return false;
+
+    const std::vector<HyperEdge<A> >& edges = vertices[antecedent[0]].edges;
+
+    for (int e = 0; e < edges.size(); e++) 
     {
-        for (int e = 0; e < vertices[v].edges.size(); e++) 
-        {
-            if (vertices[v].edges[e].DefinesEdge(antecedent, consequent)) return true;
-        }
+        if (edges[e].DefinesEdge(antecedent, consequent)) return true;
     }
 
     return false;
@@ -282,9 +317,14 @@ void HyperGraph<T, A>::AddEdge(const std::vector<T>& antecedent, const T& conseq
 
 //System.Diagnostics.Debug.WriteLine("Adding edge: " + edge.ToString());
 
-    for (int s = 0; s < local.first.size(); s++) 
+    // Once per distinct source node (a molecule may combine two copies of a node).
+    std::vector<int> sources = local.first;
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+    for (int s = 0; s < sources.size(); s++) 
     {
-        vertices[s].AddEdge(edge);
+        vertices[sources[s]].AddEdge(edge);
     }
 }
 template<class T, class A>
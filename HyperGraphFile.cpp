@@ -0,0 +1,375 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+
+#include "HyperGraphFile.h"
+#include "HyperGraph.h"
+#include "EdgeAnnotation.h"
+#include "BinaryIO.h"
+#include "Molecule.h"
+#include "FragmentGraph.h"
+#include "FragmentGraphNode.h"
+#include "FragmentSubNode.h"
+
+
+const char HyperGraphFile::MAGIC[8] = { 'S', 'Y', 'N', 'H', 'G', 'R', 'P', 'H' };
+
+// Detects files written on a machine with a different byte order.
+static const unsigned int ENDIAN_CHECK = 0x01020304;
+
+// ****************************************************************************
+
+static unsigned long long Align(unsigned long long offset)
+{
+    return (offset + 7) & ~7ULL;
+}
+
+// ****************************************************************************
+//
+// Strings are stored once; returns the offset of s in the pool.
+//
+static unsigned int AddString(std::string& pool, std::map<std::string, unsigned int>& offsets,
+                              const std::string& s)
+{
+    std::map<std::string, unsigned int>::const_iterator it = offsets.find(s);
+    if (it != offsets.end()) return it->second;
+
+    unsigned int offset = pool.size();
+    pool.append(s);
+    pool.push_back('\0');
+
+    offsets[s] = offset;
+
+    return offset;
+}
+
+// ****************************************************************************
+
+template<class R>
+static void WriteSection(BinaryWriter& out, unsigned long long& position,
+                         unsigned long long offset, const std::vector<R>& records)
+{
+    static const char zeros[8] = { 0 };
+
+    out.WriteBytes(zeros, offset - position);
+    if (!records.empty()) out.WriteBytes(&records[0], records.size() * sizeof(R));
+
+    position = offset + records.size() * sizeof(R);
+}
+
+// ****************************************************************************
+//
+// Instances of a node are numbered by fragment index, then occurrence; each bond
+// between subnodes is listed once.
+//
+void HyperGraphFile::CollectConnections(const FragmentGraph& graph,
+                                        std::vector<Connection>& connections)
+{
+    std::map<const FragmentGraphNode*, unsigned int> instances;
+
+    unsigned int numInstances = 0;
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        for (unsigned int n = 0; n < graph.orderedNodes[f].size(); n++)
+        {
+            instances[graph.orderedNodes[f][n]] = numInstances++;
+        }
+    }
+
+    std::vector<FragmentSubNode*> conns;
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        for (unsigned int n = 0; n < graph.orderedNodes[f].size(); n++)
+        {
+            unsigned int from = instances[graph.orderedNodes[f][n]];
+            const std::vector<FragmentSubNode*>& subnodes = graph.orderedNodes[f][n]->getSubNodes();
+
+            for (unsigned int s = 0; s < subnodes.size(); s++)
+            {
+                subnodes[s]->getConnections(conns);
+
+                for (unsigned int c = 0; c < conns.size(); c++)
+                {
+                    std::map<const FragmentGraphNode*, unsigned int>::const_iterator to;
+                    to = instances.find(conns[c]->getParentNode());
+
+                    if (to == instances.end()) throw std::string("connection outside the fragment graph");
+
+                    Connection conn;
+                    conn.fromInstance = from;
+                    conn.fromSubNode = subnodes[s]->getSubNodeID();
+                    conn.toInstance = to->second;
+                    conn.toSubNode = conns[c]->getSubNodeID();
+
+                    if (std::make_pair(conn.fromInstance, conn.fromSubNode) <
+                        std::make_pair(conn.toInstance, conn.toSubNode))
+                    {
+                        connections.push_back(conn);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ****************************************************************************
+
+bool HyperGraphFile::Save(const HyperGraph<Molecule, EdgeAnnotationT>& graph, const std::string& fileName)
+{
+    std::string strings;
+    std::map<std::string, unsigned int> stringOffsets;
+
+    //
+    // Fragments
+    //
+    std::vector<Fragment> fragmentRecords(Molecule::NUM_UNIQUE_FRAGMENTS);
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        fragmentRecords[f].name = AddString(strings, stringOffsets, Molecule::baseMolecules[f]->getName());
+        fragmentRecords[f].isRigid = Molecule::baseMolecules[f]->IsRigid();
+    }
+
+    //
+    // Edges: a hyperedge may be recorded at several of its nodes; keyed (and so
+    // ordered) by target, then sorted sources.
+    //
+    typedef std::pair<int, std::vector<int> > EdgeKey;
+    std::map<EdgeKey, std::string> uniqueEdges;
+
+    for (unsigned int v = 0; v < graph.vertices.size(); v++)
+    {
+        const std::vector<HyperEdge<EdgeAnnotationT> >& nodeEdges = graph.vertices[v].edges;
+
+        for (unsigned int e = 0; e < nodeEdges.size(); e++)
+        {
+            EdgeKey key(nodeEdges[e].targetNode, nodeEdges[e].sourceNodes);
+            std::sort(key.second.begin(), key.second.end());
+
+            uniqueEdges.insert(std::make_pair(key, nodeEdges[e].annotation.justification));
+        }
+    }
+
+    std::vector<Edge> edgeRecords;
+    std::vector<unsigned int> sourceRecords;
+    std::vector<unsigned int> edgesStart(graph.vertices.size() + 1, 0);
+
+    for (std::map<EdgeKey, std::string>::const_iterator it = uniqueEdges.begin();
+         it != uniqueEdges.end(); it++)
+    {
+        Edge edge;
+        edge.target = it->first.first;
+        edge.sourcesStart = sourceRecords.size();
+        edge.numSources = it->first.second.size();
+        edge.justification = AddString(strings, stringOffsets, it->second);
+
+        sourceRecords.insert(sourceRecords.end(), it->first.second.begin(), it->first.second.end());
+        edgeRecords.push_back(edge);
+
+        edgesStart[edge.target + 1]++;
+    }
+    for (unsigned int v = 0; v < graph.vertices.size(); v++) edgesStart[v + 1] += edgesStart[v];
+
+    //
+    // Nodes
+    //
+    std::vector<Node> nodeRecords(graph.vertices.size());
+    std::vector<FragmentCount> countRecords;
+    std::vector<Connection> connectionRecords;
+
+    try
+    {
+        for (unsigned int v = 0; v < graph.vertices.size(); v++)
+        {
+            const Molecule& mol = graph.vertices[v].data;
+            Node& node = nodeRecords[v];
+
+            node.level = mol.size();
+            node.flags = 0;
+
+            node.countsStart = countRecords.size();
+            for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+            {
+                if (mol.FragmentCount(f) == 0) continue;
+
+                FragmentCount count;
+                count.fragment = f;
+                count.count = mol.FragmentCount(f);
+                countRecords.push_back(count);
+            }
+            node.numCounts = countRecords.size() - node.countsStart;
+
+            node.connectionsStart = connectionRecords.size();
+            if (mol.getFingerprint() != 0)
+            {
+                CollectConnections(*mol.getFingerprint(), connectionRecords);
+                node.flags |= HAS_CONNECTIVITY;
+            }
+            node.numConnections = connectionRecords.size() - node.connectionsStart;
+
+            node.edgesStart = edgesStart[v];
+            node.numEdges = edgesStart[v + 1] - edgesStart[v];
+
+            node.molWt = mol.getMolWt();
+            node.hbd = mol.getHBD();
+            node.hba1 = mol.getHBA1();
+            node.logP = mol.getlogP();
+        }
+    }
+    catch (const std::string& msg)
+    {
+        std::cerr << "Hypergraph export: " << msg << std::endl;
+        return false;
+    }
+
+    //
+    // Layout
+    //
+    Header head;
+    memset(&head, 0, sizeof(head));
+
+    memcpy(head.magic, MAGIC, sizeof(MAGIC));
+    head.version = VERSION;
+    head.endianCheck = ENDIAN_CHECK;
+    head.numFragments = fragmentRecords.size();
+    head.numNodes = nodeRecords.size();
+    head.numEdges = edgeRecords.size();
+
+    head.fragmentsOffset = Align(sizeof(Header));
+    head.nodesOffset = Align(head.fragmentsOffset + fragmentRecords.size() * sizeof(Fragment));
+    head.countsOffset = Align(head.nodesOffset + nodeRecords.size() * sizeof(Node));
+    head.connectionsOffset = Align(head.countsOffset + countRecords.size() * sizeof(FragmentCount));
+    head.edgesOffset = Align(head.connectionsOffset + connectionRecords.size() * sizeof(Connection));
+    head.sourcesOffset = Align(head.edgesOffset + edgeRecords.size() * sizeof(Edge));
+    head.stringsOffset = Align(head.sourcesOffset + sourceRecords.size() * sizeof(unsigned int));
+    head.stringsSize = strings.size();
+
+    std::ofstream os(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (os.fail())
+    {
+        std::cerr << "Unable to create hypergraph file " << fileName << std::endl;
+        return false;
+    }
+
+    BinaryWriter out(os);
+    unsigned long long position = sizeof(Header);
+
+    out.Write<Header>(head);
+    WriteSection(out, position, head.fragmentsOffset, fragmentRecords);
+    WriteSection(out, position, head.nodesOffset, nodeRecords);
+    WriteSection(out, position, head.countsOffset, countRecords);
+    WriteSection(out, position, head.connectionsOffset, connectionRecords);
+    WriteSection(out, position, head.edgesOffset, edgeRecords);
+    WriteSection(out, position, head.sourcesOffset, sourceRecords);
+    WriteSection(out, position, head.stringsOffset, std::vector<char>(strings.begin(), strings.end()));
+
+    if (!out.good())
+    {
+        std::cerr << "Writing hypergraph file " << fileName << " failed." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************
+//
+// A section of num records at offset, or 0 if it does not fit the file.
+//
+template<class R>
+const R* HyperGraphFile::Section(unsigned long long offset, unsigned long long num) const
+{
+    if (offset % 8 != 0 || offset > file.Size()) return 0;
+    if (num > (file.Size() - offset) / sizeof(R)) return 0;
+
+    return reinterpret_cast<const R*>(file.Data() + offset);
+}
+
+// ****************************************************************************
+
+bool HyperGraphFile::Open(const std::string& fileName)
+{
+    header = 0;
+
+    if (!file.Open(fileName))
+    {
+        std::cerr << "Unable to map hypergraph file " << fileName << std::endl;
+        return false;
+    }
+
+    const Header* head = Section<Header>(0, 1);
+
+    if (head == 0 || memcmp(head->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        head->version != VERSION || head->endianCheck != ENDIAN_CHECK)
+    {
+        std::cerr << fileName << " is not a hypergraph file of this version / byte order." << std::endl;
+        return false;
+    }
+
+    fragments = Section<Fragment>(head->fragmentsOffset, head->numFragments);
+    nodes = Section<Node>(head->nodesOffset, head->numNodes);
+    edges = Section<Edge>(head->edgesOffset, head->numEdges);
+    strings = Section<char>(head->stringsOffset, head->stringsSize);
+
+    if (fragments == 0 || nodes == 0 || edges == 0 || strings == 0 ||
+        (head->stringsSize > 0 && strings[head->stringsSize - 1] != '\0'))
+    {
+        std::cerr << fileName << " is truncated." << std::endl;
+        return false;
+    }
+
+    //
+    // The slice sections are sized by the largest slice end.
+    //
+    unsigned long long numCounts = 0, numConnections = 0, numSources = 0;
+    for (unsigned int n = 0; n < head->numNodes; n++)
+    {
+        numCounts = std::max(numCounts, (unsigned long long)nodes[n].countsStart + nodes[n].numCounts);
+        numConnections = std::max(numConnections,
+                                  (unsigned long long)nodes[n].connectionsStart + nodes[n].numConnections);
+
+        if ((unsigned long long)nodes[n].edgesStart + nodes[n].numEdges > head->numEdges)
+        {
+            std::cerr << fileName << " is corrupt (node edges)." << std::endl;
+            return false;
+        }
+    }
+    for (unsigned int e = 0; e < head->numEdges; e++)
+    {
+        numSources = std::max(numSources, (unsigned long long)edges[e].sourcesStart + edges[e].numSources);
+
+        if (edges[e].target >= head->numNodes || edges[e].justification >= head->stringsSize)
+        {
+            std::cerr << fileName << " is corrupt (edges)." << std::endl;
+            return false;
+        }
+    }
+
+    counts = Section<FragmentCount>(head->countsOffset, numCounts);
+    connections = Section<Connection>(head->connectionsOffset, numConnections);
+    sources = Section<unsigned int>(head->sourcesOffset, numSources);
+
+    if (counts == 0 || connections == 0 || sources == 0)
+    {
+        std::cerr << fileName << " is truncated." << std::endl;
+        return false;
+    }
+
+    for (unsigned long long s = 0; s < numSources; s++)
+    {
+        if (sources[s] >= head->numNodes)
+        {
+            std::cerr << fileName << " is corrupt (edge sources)." << std::endl;
+            return false;
+        }
+    }
+
+    header = head;
+
+    return true;
+}
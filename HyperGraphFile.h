@@ -0,0 +1,154 @@
+#ifndef _HYPER_GRAPH_FILE_GUARD
+#define _HYPER_GRAPH_FILE_GUARD 1
+
+
+#include <string>
+#include <vector>
+
+
+#include "BinaryIO.h"
+#include "HyperGraph.h"
+#include "EdgeAnnotation.h"
+
+
+class Molecule;
+class FragmentGraph;
+
+
+//
+// Compact binary export of the synthesized hypergraph (-hg <file>), laid out so it
+// can be used in place through a memory mapping:
+//
+//   header | fragments | nodes | fragment counts | connections | edges | edge sources | strings
+//
+// Every section is an array of the fixed-size records below (native byte order),
+// starting at the offset given in the header (8-byte aligned). Variable-length
+// data of a node or edge is a contiguous slice [start, start + num) of a section.
+//
+//   - fragments: the linkers / rigids, in fragment index order
+//   - nodes: fragment multiset (sparse counts, increasing fragment index), fragment-graph
+//     connectivity, Lipinski descriptors and the edges producing the node
+//   - connections: bonds between fragment instances of a node; the instances of a node
+//     are numbered by fragment index, then by occurrence (as the counts list them)
+//   - edges: sorted by target node; sources are node indices
+//   - strings: NUL-terminated names and edge justifications
+//
+class HyperGraphFile
+{
+  public:
+    struct Header
+    {
+        char magic[8];
+        unsigned int version;
+        unsigned int endianCheck;
+
+        unsigned int numFragments;
+        unsigned int numNodes;
+        unsigned int numEdges;
+        unsigned int reserved;
+
+        unsigned long long fragmentsOffset;
+        unsigned long long nodesOffset;
+        unsigned long long countsOffset;
+        unsigned long long connectionsOffset;
+        unsigned long long edgesOffset;
+        unsigned long long sourcesOffset;
+        unsigned long long stringsOffset;
+        unsigned long long stringsSize;
+    };
+
+    struct Fragment
+    {
+        unsigned int name;      // strings offset
+        unsigned int isRigid;
+    };
+
+    // Node flags
+    static const unsigned int HAS_CONNECTIVITY = 1;  // fingerprint still available at export
+
+    struct Node
+    {
+        unsigned int level;     // number of fragments
+        unsigned int flags;
+
+        unsigned int countsStart;
+        unsigned int numCounts;
+        unsigned int connectionsStart;
+        unsigned int numConnections;
+        unsigned int edgesStart;
+        unsigned int numEdges;
+
+        double molWt;
+        double hbd;
+        double hba1;
+        double logP;
+    };
+
+    struct FragmentCount
+    {
+        unsigned int fragment;
+        unsigned int count;
+    };
+
+    struct Connection
+    {
+        unsigned int fromInstance;
+        unsigned int fromSubNode;
+        unsigned int toInstance;
+        unsigned int toSubNode;
+    };
+
+    struct Edge
+    {
+        unsigned int target;
+        unsigned int sourcesStart;
+        unsigned int numSources;
+        unsigned int justification;  // strings offset
+    };
+
+    // Write graph to fileName; returns false (with a message) on failure.
+    static bool Save(const HyperGraph<Molecule, EdgeAnnotationT>& graph, const std::string& fileName);
+
+    //
+    // Reading: Open maps the file and validates the header and section bounds.
+    //
+    HyperGraphFile() : header(0) {}
+
+    bool Open(const std::string& fileName);
+
+    unsigned int NumFragments() const { return header->numFragments; }
+    unsigned int NumNodes() const { return header->numNodes; }
+    unsigned int NumEdges() const { return header->numEdges; }
+
+    const Fragment& GetFragment(unsigned int f) const { return fragments[f]; }
+    const Node& GetNode(unsigned int n) const { return nodes[n]; }
+    const Edge& GetEdge(unsigned int e) const { return edges[e]; }
+
+    const FragmentCount* Counts(const Node& node) const { return counts + node.countsStart; }
+    const Connection* Connections(const Node& node) const { return connections + node.connectionsStart; }
+    const unsigned int* Sources(const Edge& edge) const { return sources + edge.sourcesStart; }
+
+    const char* String(unsigned int offset) const { return strings + offset; }
+
+  private:
+    static const char MAGIC[8];
+    static const unsigned int VERSION = 1;
+
+    MappedFile file;
+
+    const Header* header;
+    const Fragment* fragments;
+    const Node* nodes;
+    const FragmentCount* counts;
+    const Connection* connections;
+    const Edge* edges;
+    const unsigned int* sources;
+    const char* strings;
+
+    static void CollectConnections(const FragmentGraph& graph, std::vector<Connection>& connections);
+
+    template<class R>
+    const R* Section(unsigned long long offset, unsigned long long num) const;
+};
+
+#endif
@@ -11,6 +11,10 @@ class IdFactory
     unsigned int min() const { return minId; } 
     void reset() { current = minId; }
 
+    // The id the next call to getNextId() returns (checkpoint / resume).
+    unsigned int peekNextId() const { return current; }
+    void setNextId(unsigned int id) { current = id; }
+
   private:
     unsigned int minId;
     unsigned int current;
@@ -2,7 +2,9 @@
 #include <queue>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <time.h>
+#include <unistd.h>
 #include <pthread.h>
 
 
@@ -22,26 +24,46 @@
 #include "IdFactory.h"
 #include "Constants.h"
 #include "OBWriter.h"
+#include "Options.h"
+#include "Checkpoint.h"
 
 
 // Remove as debug
 #include "FragmentGraph.h"
+#include "Instrumentation.h"
 
 
 Instantiator::Instantiator(OBWriter*const obWriter, std::ostream& out) : writer(obWriter), ds(out)
 {
+    boundedMemory = Options::MEMORY_CAP_MB > 0 || Options::SPILL_THRESHOLD > 0;
+    memoryCap = (unsigned long)Options::MEMORY_CAP_MB * 1024 * 1024;
+
     graph = new HyperGraph<Molecule, EdgeAnnotationT>(HIERARCHICAL_LEVEL_BOUND + 1);
 
     // The hypergraph lock
     pthread_mutex_init(&graph_lock, NULL);
 
+    // No goal-directed pruning unless a pruner is set.
+    pruner = 0;
+
+    // Checkpoint pausing of the level threads
+    checkpointKey = 0;
+    pauseRequested = false;
+    runningThreads = 0;
+    pausedThreads = 0;
+    pthread_mutex_init(&pause_lock, NULL);
+    pthread_cond_init(&pause_cond, NULL);
+
+    failed = false;
+
     // The threads and locks for the producer-consumer containers.
     queue_locks = new pthread_mutex_t[HIERARCHICAL_LEVEL_BOUND+1]; 
     queue_threads = new pthread_t[HIERARCHICAL_LEVEL_BOUND+1];
     completed_level = new bool[HIERARCHICAL_LEVEL_BOUND+1];
-    level_queues = new std::queue<Molecule*>[HIERARCHICAL_LEVEL_BOUND+1];
+    level_queues = new LevelQueue[HIERARCHICAL_LEVEL_BOUND+1];
     arg_pointer = new Instantiator_ProcessLevel_Thread_Args[HIERARCHICAL_LEVEL_BOUND+1];
     moleculeLevelCount = new int[HIERARCHICAL_LEVEL_BOUND + 1];
+    prunedLevelCount = new unsigned int[HIERARCHICAL_LEVEL_BOUND + 1];
 
     for (int m = 1; m <= HIERARCHICAL_LEVEL_BOUND; m++)
     {
@@ -54,14 +76,22 @@ Instantiator::Instantiator(OBWriter*const obWriter, std::ostream& out) : writer(
         // Initialize the fact that we have not computed this level. 
         completed_level[m] = false;
 
-        // Initialize the level queues?
-        // level_queues[m].clear();
+        // Level queues spill to disk past the -spill high-water mark.
+        if (Options::SPILL_THRESHOLD > 0)
+        {
+            std::ostringstream spillFile;
+            spillFile << Options::SPILL_DIRECTORY << "/synth_spill_" << getpid()
+                      << "_level_" << m << ".bin";
+
+            level_queues[m].SetSpill(Options::SPILL_THRESHOLD, spillFile.str());
+        }
 
         // set up arg structs
         arg_pointer[m].m=m;
         arg_pointer[m].this_pointer=this;
 
         moleculeLevelCount[m] = 0;
+        prunedLevelCount[m] = 0;
     }
 }
 
@@ -74,7 +104,7 @@ void Instantiator::AddEdge(const std::vector<Molecule>& antecedent,
                            const Molecule& consequent,
                            const EdgeAnnotationT& annotation)
 {
-    pthread_mutex_lock(&graph_lock);
+    Instrumentation::Lock(&graph_lock, Instrumentation::GRAPH_LOCK);
 
     graph->AddEdge(antecedent, consequent, annotation);
 
@@ -91,12 +121,15 @@ bool Instantiator::AddNode(Molecule& mol)
 //std::cout << "edding: " << mol << std::endl;
 //std::cout << "Adding: " << mol.getFingerprint()->toString() << std::endl;
 
-    pthread_mutex_lock(&graph_lock);
+    Instrumentation::Lock(&graph_lock, Instrumentation::GRAPH_LOCK);
 
     if (graph->AddNode(mol))
     {
         mol.setUniqueIndexID(graph->size() - 1);
         added = true;
+
+        // The hypergraph only needs the identity of the molecule.
+        if (boundedMemory) graph->GetNode(graph->size() - 1).Compact();
     }
 
     pthread_mutex_unlock(&graph_lock);
@@ -104,6 +137,142 @@ bool Instantiator::AddNode(Molecule& mol)
     return added;
 }
 
+//
+// Is the resident memory of the process over the -memcap bound?
+//
+bool Instantiator::OverMemoryCap() const
+{
+    return memoryCap > 0 && residentMemory() > memoryCap;
+}
+
+//
+// The hypergraph node of a queued molecule is indexed by its unique id.
+//
+void Instantiator::RestoreIdentity(Molecule& mol)
+{
+    Instrumentation::Lock(&graph_lock, Instrumentation::GRAPH_LOCK);
+
+    mol.ShareIdentity(graph->GetNode(mol.getUniqueIndexID()));
+
+    pthread_mutex_unlock(&graph_lock);
+}
+
+//
+// Retire a completed level from the hypergraph
+//
+void Instantiator::RetireLevel(int m)
+{
+    Instrumentation::Lock(&graph_lock, Instrumentation::GRAPH_LOCK);
+
+    const std::vector<int>& bucket = graph->GetBucket(m);
+    for (std::vector<int>::const_iterator it = bucket.begin(); it != bucket.end(); it++)
+    {
+        graph->GetNode(*it).ReleaseFingerprint();
+    }
+
+    pthread_mutex_unlock(&graph_lock);
+
+    if (g_debug_output) std::cerr << "Level " << m << " retired." << std::endl;
+}
+
+void Instantiator::SetCheckpoint(const std::string& fileName, unsigned long long inputKey)
+{
+    checkpointFile = fileName;
+    checkpointKey = inputKey;
+}
+
+//
+// Called by a level thread when it holds no molecule; blocks while a checkpoint is taken.
+//
+void Instantiator::CheckpointSafePoint()
+{
+    if (!pauseRequested) return;
+
+    pthread_mutex_lock(&pause_lock);
+
+    if (pauseRequested)
+    {
+        pausedThreads++;
+        pthread_cond_broadcast(&pause_cond);
+
+        while (pauseRequested) pthread_cond_wait(&pause_cond, &pause_lock);
+
+        pausedThreads--;
+    }
+
+    pthread_mutex_unlock(&pause_lock);
+}
+
+void Instantiator::LevelThreadExit()
+{
+    pthread_mutex_lock(&pause_lock);
+
+    runningThreads--;
+    pthread_cond_broadcast(&pause_cond);
+
+    pthread_mutex_unlock(&pause_lock);
+}
+
+//
+// Pause all level threads, wait for pending output and snapshot the synthesis state.
+//
+void Instantiator::TakeCheckpoint()
+{
+    pthread_mutex_lock(&pause_lock);
+
+    pauseRequested = true;
+    while (pausedThreads < runningThreads) pthread_cond_wait(&pause_cond, &pause_lock);
+
+    pthread_mutex_unlock(&pause_lock);
+
+    //
+    // A checkpoint must not cover output that was never written; synthesis stops
+    // and main reports the failure.
+    //
+    if (!writer->DrainOutput())
+    {
+        std::cerr << "Writing the output failed; no checkpoint is written." << std::endl;
+        failed = true;
+    }
+    else if (Checkpoint::Save(*this, checkpointFile, checkpointKey))
+    {
+        std::cerr << "Checkpoint written to " << checkpointFile << " ("
+                  << graph->size() << " molecules)." << std::endl;
+    }
+
+    pthread_mutex_lock(&pause_lock);
+
+    pauseRequested = false;
+    pthread_cond_broadcast(&pause_cond);
+
+    pthread_mutex_unlock(&pause_lock);
+}
+
+void Instantiator::MonitorLevelThreads()
+{
+    if (Options::CHECKPOINT_INTERVAL == 0) return;
+
+    time_t lastCheckpoint = time(0);
+
+    while (true)
+    {
+        sleep(1);
+
+        pthread_mutex_lock(&pause_lock);
+        bool running = runningThreads > 0;
+        pthread_mutex_unlock(&pause_lock);
+
+        // After a failure the last checkpoint is kept: the current state is incomplete.
+        if (!running || failed) return;
+
+        if (time(0) - lastCheckpoint >= Options::CHECKPOINT_INTERVAL)
+        {
+            TakeCheckpoint();
+            lastCheckpoint = time(0);
+        }
+    }
+}
+
 //void Instantiator::ProcessLevel(std::vector<Molecule*>& baseMols,
 //                                std::queue<Molecule*>& inSet,
 //                                std::queue<Molecule*>& outSet,
@@ -123,8 +292,8 @@ void *ProcessLevel(void *ptr_void)
     //  recast variables for local use (from the spawned thread record we were passed)
     //
     std::vector<Molecule*> *baseMols = &(This->baseMolecules);
-    std::queue<Molecule*> *inSet = &(This->level_queues[m-1]);
-    std::queue<Molecule*> *outSet = &(This->level_queues[m]);
+    LevelQueue *inSet = &(This->level_queues[m-1]);
+    LevelQueue *outSet = &(This->level_queues[m]);
     pthread_mutex_t *in_lock = &(This->queue_locks[m-1]);
     pthread_mutex_t *out_lock = &(This->queue_locks[m]);
     bool* previousLevelComplete = &(This->completed_level[m-1]);
@@ -140,16 +309,29 @@ void *ProcessLevel(void *ptr_void)
 
     //
     // Keep consuming molecules as long as the previous level is incomplete or this
-    // level queue contains molecules to process.
+    // level queue contains molecules to process (and, with -goal, some validation
+    // molecule is still unmatched).
     //
-    while (!(*previousLevelComplete) || !inSet->empty())
+    while ((!(*previousLevelComplete) || !inSet->empty()) && !OBWriter::GoalReached() &&
+           !This->failed)
     {
+        This->CheckpointSafePoint();
+
         // Nothing to process, currently, but the level is incomplete.
         if (inSet->empty())
         {
             nanosleep(&sleepTime, &remTime);
         }
 
+        //
+        // Bounded memory: hold off while over the cap and the next level has molecules
+        // of ours to consume (the last level never queues, so it always proceeds).
+        //
+        else if (This->OverMemoryCap() && !outSet->empty())
+        {
+            nanosleep(&sleepTime, &remTime);
+        }
+
         //
         // Process a molecule in the queue
         //
@@ -158,40 +340,84 @@ void *ProcessLevel(void *ptr_void)
             //
             // Acquire a molecule to process.
             //
-            pthread_mutex_lock(in_lock);
-            Molecule* molToProcess = inSet->front();
-            inSet->pop();
-            pthread_mutex_unlock(in_lock);
-            This->moleculeLevelCount[m-1]++;
-//std::cout << "Took molecule off level " << m-1 << " queue" << std::endl;
-
-            //
-            // Process the molecule by composing it with all the base molecules.
-            //
-            for (std::vector<Molecule*>::iterator baseMol = baseMols->begin();
-                 baseMol != baseMols->end(); baseMol++)
+            Molecule* molToProcess = 0;
+            try
             {
-                std::vector<EdgeAggregator*>* newEdges = molToProcess->Compose(**baseMol);
+                pthread_mutex_lock(in_lock);
+                try
+                {
+                    molToProcess = inSet->pop();
+                }
+                catch (const char*)
+                {
+                    pthread_mutex_unlock(in_lock);
+                    throw;
+                }
+                pthread_mutex_unlock(in_lock);
+                This->moleculeLevelCount[m-1]++;
 
-                This->HandleNewMolecules(*outSet, out_lock, *newEdges);
+                // Spilled molecules share the fingerprint of their hypergraph node.
+                if (molToProcess->getFingerprint() == 0) This->RestoreIdentity(*molToProcess);
 
-                for (int i = 0; i < newEdges->size(); i++)
+                //
+                // Process the molecule by composing it with all the base molecules.
+                //
+                for (std::vector<Molecule*>::iterator baseMol = baseMols->begin();
+                     baseMol != baseMols->end(); baseMol++)
                 {
-                    delete (*newEdges)[i];
+                    std::vector<EdgeAggregator*>* newEdges = molToProcess->Compose(**baseMol);
+
+                    This->HandleNewMolecules(*outSet, out_lock, *newEdges);
+
+                    for (int i = 0; i < newEdges->size(); i++)
+                    {
+                        delete (*newEdges)[i];
+                    }
+
+                    delete newEdges;
                 }
+            }
 
-                delete newEdges;
+            //
+            // A level queue spill file could not be written or read (e.g., a full disk);
+            // every level stops and main reports the failure.
+            //
+            catch (const char* msg)
+            {
+                std::cerr << "Level " << m << ": " << msg << std::endl;
+                This->failed = true;
+                break;
+            }
+
+            // The hypergraph holds its own (compact) copy of this molecule.
+            if (This->boundedMemory)
+            {
+                molToProcess->ReleaseOpenBabelMol();
+                delete molToProcess;
             }
         }
     }
     
     // Indicate this level is complete.
     *thisLevelComplete = true;
+    This->writer->LevelComplete(m);
 
     std::cerr << "Level " << (m-1) << " created "
               << This->moleculeLevelCount[m-1] << " molecules." << std::endl; 
 
-    std::cerr << "Level " << m << " complete." << std::endl; 
+    if (This->failed) std::cerr << "Level " << m << " stopped." << std::endl;
+    else std::cerr << "Level " << m << " complete." << std::endl; 
+
+    if (inSet->NumSpilled() > 0)
+    {
+        std::cerr << "Level " << (m-1) << " spilled "
+                  << inSet->NumSpilled() << " molecules to disk." << std::endl;
+    }
+
+    // Level m-1 is complete and fully consumed; the base molecules (level 1) are kept.
+    if (This->boundedMemory && m - 1 > 1) This->RetireLevel(m - 1);
+
+    This->LevelThreadExit();
 }
 
 //
@@ -205,63 +431,118 @@ HyperGraph<Molecule, EdgeAnnotationT>* Instantiator::ThreadedInstantiate(
 {
     InitializeBaseMolecules(rigids, linkers, baseMolecules);
 
+    // Composition bounds of the validation targets in terms of the base fragments.
+    if (pruner != 0) pruner->Prepare(baseMolecules);
+
     // Add  all the base molecules to the hypergraph
     foreach_molecules(m_it, baseMolecules)
     {
         graph->AddNode(**m_it);
     }
 
+    //
+    // Continue a previous run from its checkpoint: the hypergraph, pending queues
+    // and completed levels are restored instead of regenerated.
+    //
+    if (Options::RESUME)
+    {
+        if (!Checkpoint::Load(*this, checkpointFile, checkpointKey)) return 0;
+    }
+
     //
     // Construct the set of 2-Molecules from the rigids and linkers.
     //
-    for (int m1 = 0; m1 < baseMolecules.size(); m1++)
+    else try
     {
-        for (int m2 = m1; m2 < baseMolecules.size(); m2++)
+        for (int m1 = 0; m1 < baseMolecules.size(); m1++)
         {
-            std::vector<EdgeAggregator*>* newEdges =
-                                          baseMolecules[m1]->Compose(*baseMolecules[m2]);
+            for (int m2 = m1; m2 < baseMolecules.size(); m2++)
+            {
+                std::vector<EdgeAggregator*>* newEdges =
+                                              baseMolecules[m1]->Compose(*baseMolecules[m2]);
 
-            HandleNewMolecules(level_queues[2], &queue_locks[2], *newEdges);
+                HandleNewMolecules(level_queues[2], &queue_locks[2], *newEdges);
 
-            for (int i = 0; i < newEdges->size(); i++)
-            {
-                delete (*newEdges)[i];
-            }
+                for (int i = 0; i < newEdges->size(); i++)
+                {
+                    delete (*newEdges)[i];
+                }
 
-            delete newEdges;
+                delete newEdges;
+            }
         }
     }
+    catch (const char* msg)
+    {
+        // The level threads see the failure and stop at once.
+        std::cerr << "Level 2: " << msg << std::endl;
+        failed = true;
+    }
 
     // 1-Molecules and 2-Molecules have been processed.
     completed_level[0] = true;
     completed_level[1] = true;
     completed_level[2] = true;
 
+    // The output of the complete levels (and, with -ordered, its order) can be settled.
+    for (int m = 0; m <= HIERARCHICAL_LEVEL_BOUND; m++)
+    {
+        if (completed_level[m]) writer->LevelComplete(m);
+    }
+
     // Indicate size of 1-M and 2-M lists
     moleculeLevelCount[1] = baseMolecules.size();
 
     //
     // For each level, start a thread and compose the elements with the base set of molecules.
+    // (Levels completed before a checkpoint are not restarted.)
     //
+    std::vector<bool> started(HIERARCHICAL_LEVEL_BOUND + 1, false);
+    runningThreads = 0;
     for (int m = 3; m <= HIERARCHICAL_LEVEL_BOUND; m++)
     {
+        if (completed_level[m]) continue;
+
+        started[m] = true;
+        pthread_mutex_lock(&pause_lock);
+        runningThreads++;
+        pthread_mutex_unlock(&pause_lock);
         if (~pthread_create(&queue_threads[m], NULL, ProcessLevel, (void*)&arg_pointer[m]))
 	    {if (g_debug_output) {std::cout << "Level " << m << " thread created" << std::endl;}}
 	else
             {if (g_debug_output) {std::cout << "Level " << m << " creation failed" << std::endl;}}
     }
+
+    // Periodic checkpoints while the levels are processed.
+    if (!checkpointFile.empty()) MonitorLevelThreads();
+
     for (int m = 3; m <= HIERARCHICAL_LEVEL_BOUND; m++)
     {
+        if (!started[m]) continue;
 	(void) pthread_join(queue_threads[m], NULL);
 	if (g_debug_output) std::cout << "Level " << m << " thread removed" << std::endl;
     }
 
+    if (boundedMemory && HIERARCHICAL_LEVEL_BOUND > 1) RetireLevel(HIERARCHICAL_LEVEL_BOUND);
+
     std::cout << "Level\t" << "# Molecules" << std::endl; 
     for (int m = 1; m <= HIERARCHICAL_LEVEL_BOUND; m++)
     {
        std::cout << m << "\t" << moleculeLevelCount[m] << std::endl; 
     }
 
+    if (pruner != 0)
+    {
+        unsigned int numPruned = 0;
+        for (int m = 1; m <= HIERARCHICAL_LEVEL_BOUND; m++) numPruned += prunedLevelCount[m];
+
+        std::cout << "Goal pruning: " << numPruned
+                  << " molecules cannot grow into a validation target" << std::endl;
+    }
+
+    std::cout << "Peak resident memory: " << peakResidentMemory() / (1024 * 1024)
+              << " MB" << std::endl;
+
     // Tell the output engine we have completed synthesis.
     // This function then spins until the thread pool is complete. 
     this->writer->IndicateSynthesisComplete();
@@ -347,10 +628,12 @@ HyperGraph<Molecule, EdgeAnnotationT>* Instantiator::Instantiate(std::vector<Lin
 //
 // Forward Instantiation does not permit any cycles in the resultant graph.
 //
-void Instantiator::HandleNewMolecules(std::queue<Molecule*>& worklist,
+void Instantiator::HandleNewMolecules(LevelQueue& worklist,
                                       pthread_mutex_t* worklist_lock,
                                       std::vector<EdgeAggregator*>& newEdges)
 {
+    std::vector<Molecule*> queued;
+
     for (int e = 0; e < newEdges.size(); e++)
     {
 /*
@@ -370,6 +653,11 @@ void Instantiator::HandleNewMolecules(std::queue<Molecule*>& worklist,
 
             // Molecule is in the graph
             AddEdge(newEdges[e]->antecedent, graphNode, *newEdges[e]->annotation);
+
+            // The duplicate is not referenced by the graph or a queue.
+            newEdges[e]->consequent->Release();
+            delete newEdges[e]->consequent;
+            newEdges[e]->consequent = 0;
         }
 
         // The new consequent Molecule is not in the graph
@@ -378,6 +666,24 @@ void Instantiator::HandleNewMolecules(std::queue<Molecule*>& worklist,
             // Add a node to the graph and set its id
             AddNode(*newEdges[e]->consequent);
 
+            //
+            // Goal-directed pruning: a molecule that cannot grow into a validation target
+            // stays in the hypergraph (so it is recognized again) but is neither output
+            // nor extended. Only the thread of this level queue counts into it.
+            //
+            if (pruner != 0 && !pruner->CanExtend(*newEdges[e]->consequent))
+            {
+                AddEdge(newEdges[e]->antecedent, *newEdges[e]->consequent, *newEdges[e]->annotation);
+
+                prunedLevelCount[newEdges[e]->consequent->size()]++;
+
+                if (boundedMemory) newEdges[e]->consequent->ReleaseOpenBabelMol();
+                delete newEdges[e]->consequent;
+                newEdges[e]->consequent = 0;
+
+                continue;
+            }
+
 /*
             std::cout << "Added: "
                       << *newEdges[e]->consequent->getFingerprint() << std::endl;
@@ -387,21 +693,35 @@ void Instantiator::HandleNewMolecules(std::queue<Molecule*>& worklist,
             // we have a threaded version (which we always do now).
             if (worklist_lock) this->writer->OutputMolecule(*newEdges[e]->consequent);
 
+            // Add the actual edge; before queueing, as a consumer may free the molecule.
+            AddEdge(newEdges[e]->antecedent, *newEdges[e]->consequent, *newEdges[e]->annotation);
+
             //
-            // Also add to the worklist; threaded for safety (if the lock is a valid pointer)
+            // Bounded memory: nothing consumes the last level, so do not queue it.
             //
-            if (worklist_lock) pthread_mutex_lock(worklist_lock);
+            if (boundedMemory && &worklist == &level_queues[HIERARCHICAL_LEVEL_BOUND])
+            {
+                moleculeLevelCount[HIERARCHICAL_LEVEL_BOUND]++;
 
-            worklist.push(newEdges[e]->consequent);
+                newEdges[e]->consequent->ReleaseOpenBabelMol();
+                delete newEdges[e]->consequent;
+                newEdges[e]->consequent = 0;
 
-            if (worklist_lock) pthread_mutex_unlock(worklist_lock);
+                continue;
+            }
 
-            //std::cout << "Added molecule to a queue" << std:: endl;
+            // Also add to the worklist (below, as one batch).
+            queued.push_back(newEdges[e]->consequent);
 
-            // Add the actual edge
-            AddEdge(newEdges[e]->antecedent, *newEdges[e]->consequent, *newEdges[e]->annotation);
+            //std::cout << "Added molecule to a queue" << std:: endl;
         }
     }
+
+    //
+    // Threaded for safety (if the lock is a valid pointer); push serializes and writes
+    // spilled molecules without holding the lock.
+    //
+    worklist.push(queued, worklist_lock);
 }
 
 
@@ -6,6 +6,7 @@
 #include <queue>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <pthread.h>
 
 
@@ -16,6 +17,8 @@
 #include "EdgeAnnotation.h"
 #include "IdFactory.h"
 #include "OBWriter.h"
+#include "LevelQueue.h"
+#include "GoalPruner.h"
 
 
 // threads require a struct to pass multiple arguments
@@ -43,7 +46,7 @@ class Instantiator
     // debug stream
     std::ostream& ds;
 
-    void HandleNewMolecules(std::queue<Molecule*>& worklist,
+    void HandleNewMolecules(LevelQueue& worklist,
                             pthread_mutex_t* wl_lock,
                             std::vector<EdgeAggregator*>& newEdges);
 
@@ -74,7 +77,7 @@ class Instantiator
     bool* completed_level;
 
     // The actual producer-consumer queue for each level.
-    std::queue<Molecule*>* level_queues;
+    LevelQueue* level_queues;
 
     // array of args for each level thread
     Instantiator_ProcessLevel_Thread_Args *arg_pointer;
@@ -88,6 +91,54 @@ class Instantiator
     // For output of molecules on the fly.
     OBWriter* const writer;
 
+    //
+    // Bounded memory synthesis (-memcap or -spill): hypergraph nodes are compact and
+    // processed molecules are freed; with -memcap, producers wait while resident memory
+    // exceeds the cap.
+    //
+    bool boundedMemory;
+    unsigned long memoryCap;
+
+    bool OverMemoryCap() const;
+
+    // Reattach the identity of a molecule read back from a spill file.
+    void RestoreIdentity(Molecule& mol);
+
+    // Release the fingerprints of the level-m hypergraph nodes; no molecule of
+    // size m is compared against after level m is complete.
+    void RetireLevel(int m);
+
+    //
+    // Checkpointing (-ckpt / -resume); see Checkpoint.
+    //
+    std::string checkpointFile;
+    unsigned long long checkpointKey;
+
+    // Level threads pause at a safe point (between molecules) while a checkpoint is taken.
+    volatile bool pauseRequested;
+    int runningThreads;
+    int pausedThreads;
+    pthread_mutex_t pause_lock;
+    pthread_cond_t pause_cond;
+
+    // Set by a level thread that cannot continue (a level queue spill file error);
+    // all level threads then stop.
+    volatile bool failed;
+
+    void CheckpointSafePoint();
+    void LevelThreadExit();
+    void TakeCheckpoint();
+
+    // Wait for the level threads, checkpointing every Options::CHECKPOINT_INTERVAL seconds.
+    void MonitorLevelThreads();
+
+    //
+    // Goal-directed pruning (-prune); molecules that cannot grow into a validation
+    // target are neither output nor extended (counted per level).
+    //
+    GoalPruner* pruner;
+    unsigned int* prunedLevelCount;
+
   public:
     Instantiator(OBWriter*const obWriter, std::ostream& out = std::cout);
 
@@ -102,6 +153,17 @@ class Instantiator
     HyperGraph<Molecule, EdgeAnnotationT>* ThreadedInstantiate(std::vector<Linker*>& linkers,
                                                               std::vector<Rigid*>& rigids);
 
+    // Checkpoint file and content key of the inputs; used for -ckpt and -resume.
+    void SetCheckpoint(const std::string& fileName, unsigned long long inputKey);
+
+    // Synthesis stopped early after an error; the hypergraph and output are incomplete.
+    bool Failed() const { return failed; }
+
+    // Restrict synthesis to molecules that can grow into one of the pruner's targets.
+    void SetGoalPruner(GoalPruner* goalPruner) { pruner = goalPruner; }
+
+    friend class Checkpoint;
+
     // thread must be implemented as friend class
     friend void *ProcessLevel(void * args); // worker thread
 };
@@ -0,0 +1,241 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+#include <pthread.h>
+
+
+#include "Instrumentation.h"
+
+
+bool Instrumentation::enabled = false;
+__thread unsigned long long* Instrumentation::local = 0;
+pthread_mutex_t Instrumentation::registry_lock = PTHREAD_MUTEX_INITIALIZER;
+std::vector<unsigned long long*> Instrumentation::threadCounters;
+std::string Instrumentation::statsFile;
+unsigned int Instrumentation::interval = 0;
+unsigned long long Instrumentation::startTime = 0;
+volatile bool Instrumentation::stopping = false;
+bool Instrumentation::dumping = false;
+pthread_t Instrumentation::dumpThread;
+
+const char* const Instrumentation::NAMES[NUM_COUNTERS] =
+{
+    "compose_calls",
+    "compose_ns",
+    "compose_products",
+    "connect_checks",
+    "connect_hits",
+    "node_comparisons",
+    "isomorphism_checks",
+    "isomorphism_matches",
+    "bucket_scans",
+    "bucket_nodes_scanned",
+    "bucket_size_max",
+    "graph_lock_acquisitions",
+    "graph_lock_contended",
+    "graph_lock_wait_ns",
+    "openbabel_lock_acquisitions",
+    "openbabel_lock_contended",
+    "openbabel_lock_wait_ns",
+    "output_queue_max",
+    "writer_queue_max",
+    "obgen_calls",
+    "obgen_ns",
+    "obgen_ns_max"
+};
+
+// ****************************************************************************
+
+bool Instrumentation::IsMax(unsigned int c)
+{
+    return c == BUCKET_SIZE_MAX || c == OUTPUT_QUEUE_MAX || c == WRITER_QUEUE_MAX || c == OBGEN_NS_MAX;
+}
+
+// ****************************************************************************
+
+unsigned long long Instrumentation::Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// ****************************************************************************
+
+unsigned long long* Instrumentation::Register()
+{
+    unsigned long long* counters = new unsigned long long[NUM_COUNTERS]();
+
+    pthread_mutex_lock(&registry_lock);
+    threadCounters.push_back(counters);
+    pthread_mutex_unlock(&registry_lock);
+
+    return counters;
+}
+
+// ****************************************************************************
+//
+// An uncontended lock costs one trylock; only a contended one is timed.
+//
+void Instrumentation::Lock(pthread_mutex_t* mutex, Counter lock)
+{
+    if (!enabled)
+    {
+        pthread_mutex_lock(mutex);
+        return;
+    }
+
+    Add(lock);
+
+    if (pthread_mutex_trylock(mutex) == 0) return;
+
+    unsigned long long start = Now();
+    pthread_mutex_lock(mutex);
+
+    Add((Counter)(lock + 1));
+    Add((Counter)(lock + 2), Now() - start);
+}
+
+// ****************************************************************************
+
+unsigned int Instrumentation::Totals(std::vector<unsigned long long>& totals)
+{
+    totals.assign(NUM_COUNTERS, 0);
+
+    pthread_mutex_lock(&registry_lock);
+
+    for (unsigned int t = 0; t < threadCounters.size(); t++)
+    {
+        for (unsigned int c = 0; c < NUM_COUNTERS; c++)
+        {
+            unsigned long long value = __atomic_load_n(&threadCounters[t][c], __ATOMIC_RELAXED);
+
+            if (IsMax(c)) totals[c] = value > totals[c] ? value : totals[c];
+            else totals[c] += value;
+        }
+    }
+
+    unsigned int numThreads = threadCounters.size();
+
+    pthread_mutex_unlock(&registry_lock);
+
+    return numThreads;
+}
+
+// ****************************************************************************
+
+static double Ratio(unsigned long long part, unsigned long long whole)
+{
+    return whole == 0 ? 0.0 : (double)part / whole;
+}
+
+// ****************************************************************************
+//
+// Written to a temporary file and renamed so readers never see a partial dump.
+//
+bool Instrumentation::WriteJSON(const std::string& fileName)
+{
+    std::vector<unsigned long long> totals;
+    unsigned int numThreads = Totals(totals);
+
+    std::ostringstream tempName;
+    tempName << fileName << ".tmp." << getpid();
+
+    std::ofstream out(tempName.str().c_str());
+    if (out.fail())
+    {
+        std::cerr << "Unable to write statistics to " << tempName.str() << std::endl;
+        return false;
+    }
+
+    out << "{" << std::endl;
+    out << "  \"elapsed_s\": " << (Now() - startTime) / 1e9 << "," << std::endl;
+    out << "  \"threads\": " << numThreads << "," << std::endl;
+
+    out << "  \"counters\": {" << std::endl;
+    for (unsigned int c = 0; c < NUM_COUNTERS; c++)
+    {
+        out << "    \"" << NAMES[c] << "\": " << totals[c] << (c + 1 < NUM_COUNTERS ? "," : "") << std::endl;
+    }
+    out << "  }," << std::endl;
+
+    out << "  \"derived\": {" << std::endl;
+    out << "    \"connect_hit_rate\": " << Ratio(totals[CONNECT_HITS], totals[CONNECT_CHECKS]) << "," << std::endl;
+    out << "    \"isomorphism_hit_rate\": "
+        << Ratio(totals[ISOMORPHISM_MATCHES], totals[ISOMORPHISM_CHECKS]) << "," << std::endl;
+    out << "    \"mean_bucket_size\": " << Ratio(totals[BUCKET_NODES_SCANNED], totals[BUCKET_SCANS]) << "," << std::endl;
+    out << "    \"mean_compose_us\": " << Ratio(totals[COMPOSE_NS], totals[COMPOSE_CALLS]) / 1e3 << "," << std::endl;
+    out << "    \"graph_lock_contention\": "
+        << Ratio(totals[GRAPH_LOCK_CONTENDED], totals[GRAPH_LOCK]) << "," << std::endl;
+    out << "    \"openbabel_lock_contention\": "
+        << Ratio(totals[OPENBABEL_LOCK_CONTENDED], totals[OPENBABEL_LOCK]) << "," << std::endl;
+    out << "    \"mean_obgen_ms\": " << Ratio(totals[OBGEN_NS], totals[OBGEN_CALLS]) / 1e6 << std::endl;
+    out << "  }" << std::endl;
+    out << "}" << std::endl;
+
+    out.close();
+
+    if (out.fail() || rename(tempName.str().c_str(), fileName.c_str()) != 0)
+    {
+        std::cerr << "Unable to write statistics to " << fileName << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// ****************************************************************************
+
+void* Instrumentation::PeriodicDump(void* /* args */)
+{
+    unsigned int elapsed = 0;
+
+    // Sleep in one-second steps so Stop does not wait a whole interval.
+    while (!stopping)
+    {
+        sleep(1);
+
+        if (++elapsed >= interval && !stopping)
+        {
+            WriteJSON(statsFile);
+            elapsed = 0;
+        }
+    }
+
+    return 0;
+}
+
+// ****************************************************************************
+
+void Instrumentation::Start(const std::string& fileName, unsigned int intervalSeconds)
+{
+    statsFile = fileName;
+    interval = intervalSeconds;
+    startTime = Now();
+    stopping = false;
+    enabled = true;
+
+    if (interval > 0)
+    {
+        dumping = pthread_create(&dumpThread, NULL, PeriodicDump, NULL) == 0;
+    }
+}
+
+// ****************************************************************************
+
+void Instrumentation::Stop()
+{
+    if (!enabled) return;
+
+    stopping = true;
+    if (dumping) pthread_join(dumpThread, NULL);
+    dumping = false;
+
+    WriteJSON(statsFile);
+}
@@ -0,0 +1,139 @@
+#ifndef _INSTRUMENTATION_GUARD
+#define _INSTRUMENTATION_GUARD 1
+
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+
+//
+// Low-overhead counters and timers for the synthesis stages (-stats <file>).
+//
+// Every thread accumulates into its own block of counters (registered on first use
+// and kept after the thread exits); only the dump sums the blocks. The counters are
+// written as JSON at exit and, with -statsint <sec>, periodically by a background
+// thread. When disabled, each probe is a single branch.
+//
+class Instrumentation
+{
+  public:
+    enum Counter
+    {
+        COMPOSE_CALLS,
+        COMPOSE_NS,
+        COMPOSE_PRODUCTS,
+        CONNECT_CHECKS,
+        CONNECT_HITS,
+        NODE_COMPARISONS,
+        ISOMORPHISM_CHECKS,
+        ISOMORPHISM_MATCHES,
+        BUCKET_SCANS,
+        BUCKET_NODES_SCANNED,
+        BUCKET_SIZE_MAX,
+        // Lock counters come in threes: acquisitions, contended acquisitions, wait time.
+        GRAPH_LOCK,
+        GRAPH_LOCK_CONTENDED,
+        GRAPH_LOCK_WAIT_NS,
+        OPENBABEL_LOCK,
+        OPENBABEL_LOCK_CONTENDED,
+        OPENBABEL_LOCK_WAIT_NS,
+        OUTPUT_QUEUE_MAX,
+        WRITER_QUEUE_MAX,
+        OBGEN_CALLS,
+        OBGEN_NS,
+        OBGEN_NS_MAX,
+        NUM_COUNTERS
+    };
+
+    static bool enabled;
+
+    static void Add(Counter c, unsigned long long value = 1)
+    {
+        if (!enabled) return;
+
+        unsigned long long* counters = Local();
+        __atomic_store_n(&counters[c], __atomic_load_n(&counters[c], __ATOMIC_RELAXED) + value,
+                         __ATOMIC_RELAXED);
+    }
+
+    static void Max(Counter c, unsigned long long value)
+    {
+        if (!enabled) return;
+
+        unsigned long long* counters = Local();
+        if (value > __atomic_load_n(&counters[c], __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&counters[c], value, __ATOMIC_RELAXED);
+        }
+    }
+
+    // Monotonic clock in nanoseconds.
+    static unsigned long long Now();
+
+    // Lock mutex, counting the acquisition (lock) and, if it was held, the wait.
+    static void Lock(pthread_mutex_t* mutex, Counter lock);
+
+    // Enable the counters; with an interval, dump to fileName every interval seconds.
+    static void Start(const std::string& fileName, unsigned int intervalSeconds);
+    // Stop the periodic dump and write the final counters.
+    static void Stop();
+
+    static bool WriteJSON(const std::string& fileName);
+
+  private:
+    static __thread unsigned long long* local;
+
+    static pthread_mutex_t registry_lock;
+    static std::vector<unsigned long long*> threadCounters;
+
+    static const char* const NAMES[NUM_COUNTERS];
+
+    static std::string statsFile;
+    static unsigned int interval;
+    static unsigned long long startTime;
+    static volatile bool stopping;
+    static bool dumping;
+    static pthread_t dumpThread;
+
+    static unsigned long long* Local()
+    {
+        if (local == 0) local = Register();
+        return local;
+    }
+
+    static unsigned long long* Register();
+    static bool IsMax(unsigned int c);
+    // Sums (or maxima) over the threads; returns the number of threads.
+    static unsigned int Totals(std::vector<unsigned long long>& totals);
+    static void* PeriodicDump(void* args);
+};
+
+//
+// Adds the lifetime of the timer (in nanoseconds) to a counter (and its maximum).
+//
+class ScopedTimer
+{
+  public:
+    ScopedTimer(Instrumentation::Counter total,
+                Instrumentation::Counter max = Instrumentation::NUM_COUNTERS)
+        : totalCounter(total), maxCounter(max),
+          start(Instrumentation::enabled ? Instrumentation::Now() : 0) {}
+
+    ~ScopedTimer()
+    {
+        if (!Instrumentation::enabled || start == 0) return;
+
+        unsigned long long elapsed = Instrumentation::Now() - start;
+
+        Instrumentation::Add(totalCounter, elapsed);
+        if (maxCounter != Instrumentation::NUM_COUNTERS) Instrumentation::Max(maxCounter, elapsed);
+    }
+
+  private:
+    Instrumentation::Counter totalCounter;
+    Instrumentation::Counter maxCounter;
+    unsigned long long start;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include <deque>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <map>
+#include <utility>
+#include <pthread.h>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#include "LevelQueue.h"
+#include "BinaryIO.h"
+#include "MoleculeIO.h"
+#include "Molecule.h"
+
+
+// ****************************************************************************
+
+LevelQueue::LevelQueue() : highWater(0),
+                           spillFd(-1),
+                           readOffset(0),
+                           writeOffset(0),
+                           publishedOffset(0),
+                           numOnDisk(0),
+                           numSpilled(0),
+                           numSerializing(0)
+{
+}
+
+// ****************************************************************************
+
+LevelQueue::~LevelQueue()
+{
+    if (spillFd >= 0) close(spillFd);
+}
+
+// ****************************************************************************
+//
+// The spill file is unlinked as soon as it is opened; it disappears with the process.
+//
+void LevelQueue::SetSpill(unsigned int water, const std::string& fileName)
+{
+    highWater = water;
+    spillFileName = fileName;
+
+    if (highWater == 0) return;
+
+    spillFd = open(spillFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (spillFd < 0)
+    {
+        std::cerr << "Unable to create spill file " << spillFileName
+                  << "; level queue will not spill." << std::endl;
+        highWater = 0;
+        return;
+    }
+
+    unlink(spillFileName.c_str());
+}
+
+// ****************************************************************************
+
+void LevelQueue::push(const std::vector<Molecule*>& mols, pthread_mutex_t* lock)
+{
+    if (mols.empty()) return;
+
+    //
+    // Once anything is on disk (or on its way), newer molecules follow it there to
+    // preserve order.
+    //
+    if (lock) pthread_mutex_lock(lock);
+
+    unsigned int numInMemory = 0;
+    while (numInMemory < mols.size() &&
+           (highWater == 0 ||
+            (readOffset == writeOffset && numSerializing == 0 && memory.size() < highWater)))
+    {
+        memory.push_back(mols[numInMemory++]);
+    }
+
+    unsigned long numToSpill = mols.size() - numInMemory;
+    numSerializing += numToSpill;
+
+    if (lock) pthread_mutex_unlock(lock);
+
+    if (numToSpill == 0) return;
+
+    //
+    // Serialize the rest into one batch of length-prefixed records, without the lock.
+    //
+    std::ostringstream oss;
+    BinaryWriter out(oss);
+    for (unsigned int m = numInMemory; m < mols.size(); m++)
+    {
+        std::ostringstream record;
+        BinaryWriter recordOut(record);
+        MoleculeIO::WriteComplex(recordOut, *mols[m]);
+
+        std::string bytes = record.str();
+        out.Write<unsigned int>(bytes.size());
+        out.WriteBytes(bytes.data(), bytes.size());
+    }
+    std::string batch = oss.str();
+
+    // Reserve the batch's place in the file.
+    if (lock) pthread_mutex_lock(lock);
+
+    off_t start = writeOffset;
+    writeOffset += batch.size();
+    numSerializing -= numToSpill;
+
+    if (lock) pthread_mutex_unlock(lock);
+
+    if (pwrite(spillFd, batch.data(), batch.size(), start) != (ssize_t)batch.size())
+    {
+        throw "Writing to the level queue spill file failed.";
+    }
+
+    // The fingerprint and fragment counter remain with the hypergraph node.
+    for (unsigned int m = numInMemory; m < mols.size(); m++)
+    {
+        mols[m]->ReleaseOpenBabelMol();
+        delete mols[m];
+    }
+
+    if (lock) pthread_mutex_lock(lock);
+    Publish(start, start + batch.size(), numToSpill);
+    if (lock) pthread_mutex_unlock(lock);
+}
+
+// ****************************************************************************
+//
+// Records become visible to pop in file order, once everything before them is written.
+//
+void LevelQueue::Publish(off_t start, off_t end, unsigned long numRecords)
+{
+    written[start] = std::make_pair(end, numRecords);
+
+    std::map<off_t, std::pair<off_t, unsigned long> >::iterator next;
+    while ((next = written.find(publishedOffset)) != written.end())
+    {
+        publishedOffset = next->second.first;
+        numOnDisk += next->second.second;
+        numSpilled += next->second.second;
+
+        written.erase(next);
+    }
+}
+
+// ****************************************************************************
+
+Molecule* LevelQueue::pop()
+{
+    if (memory.empty() && numOnDisk > 0) Refill();
+
+    if (memory.empty()) return 0;
+
+    Molecule* mol = memory.front();
+    memory.pop_front();
+
+    return mol;
+}
+
+// ****************************************************************************
+//
+// Read the next batch of spilled records into memory (only when memory is empty).
+//
+void LevelQueue::Refill()
+{
+    for (unsigned int r = 0; r < REFILL_BATCH && numOnDisk > 0; r++)
+    {
+        unsigned int length;
+        if (pread(spillFd, &length, sizeof(length), readOffset) != sizeof(length))
+        {
+            throw "Reading from the level queue spill file failed.";
+        }
+
+        buffer.resize(length);
+        if (pread(spillFd, &buffer[0], length, readOffset + sizeof(length)) != (ssize_t)length)
+        {
+            throw "Reading from the level queue spill file failed.";
+        }
+
+        readOffset += sizeof(length) + length;
+        numOnDisk--;
+
+        try
+        {
+            BinaryReader in(&buffer[0], length);
+            memory.push_back(MoleculeIO::ReadComplex(in));
+        }
+        catch (const std::string& err)
+        {
+            std::cerr << "Corrupt level queue spill record: " << err << std::endl;
+            throw "Reading from the level queue spill file failed.";
+        }
+    }
+
+    // Everything spilled has been read back (and nothing is being written); reuse
+    // the file from the start.
+    if (numOnDisk == 0 && readOffset == writeOffset)
+    {
+        readOffset = 0;
+        writeOffset = 0;
+        publishedOffset = 0;
+        if (ftruncate(spillFd, 0) != 0)
+        {
+            std::cerr << "Unable to truncate spill file " << spillFileName << std::endl;
+        }
+    }
+}
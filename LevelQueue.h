@@ -0,0 +1,85 @@
+#ifndef _LEVEL_QUEUE_GUARD
+#define _LEVEL_QUEUE_GUARD 1
+
+
+#include <deque>
+#include <vector>
+#include <map>
+#include <string>
+#include <utility>
+#include <pthread.h>
+#include <sys/types.h>
+
+
+class Molecule;
+
+
+//
+// The producer-consumer queue between two synthesis levels.
+//
+// Past a high-water mark of molecules held in memory, newly queued molecules are
+// serialized to a spill file (and freed); they are read back, in order, once the
+// in-memory molecules are consumed. Molecules read back from the spill file do not
+// have their fragment counter / fingerprint; those are shared with the corresponding
+// hypergraph node (see Molecule::ShareIdentity).
+//
+// Callers lock around pop; push takes the caller's lock itself so that molecules
+// going to the spill file are serialized and written without holding it (the lock
+// only reserves their place in the file and publishes them once written).
+//
+class LevelQueue
+{
+  public:
+    LevelQueue();
+    ~LevelQueue();
+
+    // Spill to fileName once highWater molecules are in memory; 0 never spills.
+    void SetSpill(unsigned int highWater, const std::string& fileName);
+
+    bool empty() const { return memory.empty() && numOnDisk == 0; }
+    unsigned long size() const { return memory.size() + numOnDisk; }
+
+    // Queue the molecules, in order; lock is the caller's lock of this queue (0 if
+    // the queue is not shared).
+    void push(const std::vector<Molecule*>& mols, pthread_mutex_t* lock);
+    void push(Molecule* mol) { push(std::vector<Molecule*>(1, mol), 0); }
+
+    // The oldest molecule in the queue; 0 if empty.
+    Molecule* pop();
+
+    // Total number of molecules ever written to the spill file.
+    unsigned long NumSpilled() const { return numSpilled; }
+
+  private:
+    std::deque<Molecule*> memory;
+
+    unsigned int highWater;
+    std::string spillFileName;
+    int spillFd;
+
+    // Spilled records occupy [readOffset, writeOffset) of the spill file; those
+    // before publishedOffset are written (numOnDisk of them). Batches written out of
+    // order wait in written (start -> end, number of records) until they are next.
+    off_t readOffset;
+    off_t writeOffset;
+    off_t publishedOffset;
+    std::map<off_t, std::pair<off_t, unsigned long> > written;
+    unsigned long numOnDisk;
+    unsigned long numSpilled;
+
+    // Molecules decided to spill but not yet reserved in the file.
+    unsigned long numSerializing;
+
+    std::vector<char> buffer;
+
+    // Number of records read back from the spill file at a time.
+    static const unsigned int REFILL_BATCH = 64;
+
+    void Publish(off_t start, off_t end, unsigned long numRecords);
+    void Refill();
+
+    LevelQueue(const LevelQueue&);
+    LevelQueue& operator=(const LevelQueue&);
+};
+
+#endif
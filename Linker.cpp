@@ -60,7 +60,7 @@ void Linker::parseAppendix(std::string& suffix)
         // A linker can link to any atom.
         this->atoms[x].setCanConnectToAnyAtom();
         this->atoms[x].setMaxConnect(maxConnections);
-        this->atoms[x].setAtomType(* new AtomT(atomType));
+        this->atoms[x].setAtomTypeId(AtomT::Intern(atomType));
         this->atoms[x].setOwnerMolecule(this);
         this->atoms[x].setOwnerMoleculeType(LINKER);
     }
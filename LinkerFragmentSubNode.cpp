@@ -59,6 +59,21 @@ void LinkerFragmentSubNode::addConnection(FragmentSubNode* connector)
 
 // ************************************************************************************
 
+void LinkerFragmentSubNode::remapConnections(const std::map<const FragmentSubNode*,
+                                                            FragmentSubNode*>& remap)
+{
+    for (std::vector<FragmentSubNode*>::iterator it = this->connections.begin();
+         it != this->connections.end();
+         it++)
+    {
+        std::map<const FragmentSubNode*, FragmentSubNode*>::const_iterator found = remap.find(*it);
+
+        if (found != remap.end()) *it = found->second;
+    }
+}
+
+// ************************************************************************************
+
 bool LinkerFragmentSubNode::IsIsomorphicTo(FragmentSubNode* that)
 {
     if (this->uniqueSubnodeID != that->getSubNodeID()) return false;
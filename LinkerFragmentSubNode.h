@@ -17,6 +17,8 @@ class LinkerFragmentSubNode : public FragmentSubNode
     FragmentSubNode* copy() const;
 
     void addConnection(FragmentSubNode* connector);
+    void remapConnections(const std::map<const FragmentSubNode*, FragmentSubNode*>& remap);
+    void getConnections(std::vector<FragmentSubNode*>& conns) const { conns = connections; }
 
     unsigned int degree() { return connections.size(); }
 
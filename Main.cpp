@@ -6,6 +6,8 @@
 #include <cstdio>
 #include <sstream>
 #include <cstdlib>
+#include <algorithm>
+#include <sys/time.h>
 
 
 //
@@ -27,6 +29,8 @@
 #include "Molecule.h"
 #include "Rigid.h"
 #include "Linker.h"
+#include "FragmentLoader.h"
+#include "FragmentCache.h"
 
 //
 // File processing in / out.
@@ -34,6 +38,7 @@
 #include "OBWriter.h"
 #include "Options.h"
 #include "Validator.h"
+#include "GoalPruner.h"
 
 
 //
@@ -42,6 +47,9 @@
 #include "HyperGraph.h"
 #include "EdgeAnnotation.h"
 #include "Instantiator.h"
+#include "HyperGraphFile.h"
+#include "SubsetQuery.h"
+#include "Instrumentation.h"
 
 #include "PebblerHyperGraph.h"
 #include "Utilities.h"
@@ -57,174 +65,165 @@ std::vector<Rigid*> rigids;
 
 void Cleanup(std::vector<Linker*>& linkers, std::vector<Rigid*>& rigids);
 
-bool splitMolecule(std::ifstream& infile, std::string& name,
-                   std::string& prefix, std::string& suffix)
-{
-    prefix = "";
-    suffix = "";
-
-    std::string line = "";
 
-    // Eat #### in large files (if it exists)
-    eatWhiteLines(infile); 
-    if (infile.peek() == '#')
+//
+// Parse each input data files (in parallel; see FragmentLoader).
+// With -cache, a binary cache of the parsed fragments is used when it matches the inputs.
+//
+bool readInputFiles(const Options& options)
+{
+    if (options.cacheDirectory.empty())
     {
-        getline(infile, line);
-        name = line;
-        eatWhiteLines(infile);
-    }
+        FragmentLoader loader(Options::LOADER_THREAD_POOL_SIZE);
 
-    getline(infile, line);
-    prefix += line + '\n';
+        return loader.Load(options.inFiles, linkers, rigids);
+    }
 
-    // Nothing left to read...
-    if (infile.eof() || infile.fail()) return false;
+    FragmentCache cache(options.cacheDirectory);
+    std::string descriptorLog;
 
-    // Read the prefix (end indicated by END)
-    while(line.find("END") == std::string::npos)
+    if (cache.Load(options.inFiles, linkers, rigids, descriptorLog))
     {
-        getline(infile, line);
-        prefix += line + '\n';
+        FragmentLoader::WriteDescriptorLog(descriptorLog);
+        return true;
     }
 
-    // Add '$$$$' to the prefix.
-    // prefix += "\n$$$$";
+    FragmentLoader loader(Options::LOADER_THREAD_POOL_SIZE);
 
-    // Set suffix equal to remainder of the file
-    while (line.find("$$$$") == std::string::npos)
-    {
-        getline(infile, line);
-        suffix += line + '\n';
-    }
+    if (!loader.Load(options.inFiles, linkers, rigids)) return false;
+
+    cache.Save(options.inFiles, linkers, rigids, loader.DescriptorLog());
 
     return true;
 }
 
-Molecule* createLocalMolecule(OpenBabel::OBMol* mol, MoleculeT mType,
-                              const std::string& name, std::string& suffix)
+//
+// -reach: the synthesized molecules derivable from a subset of the linkers / rigids
+// (by pebbling the hypergraph from the base nodes of the given names), per level.
+//
+void ReportReachable(const HyperGraph<Molecule, EdgeAnnotationT>& graph, const std::string& names)
 {
-    //
-    // Add the suffix as comment data to the actual OBMol object.  
-    //
-    OpenBabel::OBCommentData* cData = new OpenBabel::OBCommentData();
-    cData->SetAttribute("Comment");
-    cData->SetData(suffix);
-    mol->SetData(cData);
+    std::vector<int> startNodes;
 
-    //
-    // Create this particular molecule type based on the name of the file.
-    //
-    if (mType == LINKER)
-    {
-        return new Linker(mol, name);
-    }
-    else if (mType == RIGID)
+    std::istringstream list(names);
+    std::string name;
+    while (std::getline(list, name, ','))
     {
-        return new Rigid(mol, name);
+        bool found = false;
+        for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS && f < graph.vertices.size(); f++)
+        {
+            if (graph.vertices[f].data.getName() == name)
+            {
+                startNodes.push_back(f);
+                found = true;
+            }
+        }
+
+        if (!found) std::cerr << "-reach: no linker / rigid named '" << name << "'" << std::endl;
     }
-    
-    return 0;
-}
 
-void addMolecule(char type, Molecule* molecule)
-{
-    if (type == 'l')
+    PebblerHyperGraph<Molecule, EdgeAnnotationT> pebblerGraph = graph.GetPebblerHyperGraph();
+    pebblerGraph.Pebble(startNodes);
+
+    std::vector<unsigned int> reachable(HIERARCHICAL_LEVEL_BOUND + 1, 0);
+    std::vector<unsigned int> total(HIERARCHICAL_LEVEL_BOUND + 1, 0);
+    for (int v = 0; v < pebblerGraph.size(); v++)
     {
-        linkers.push_back(static_cast<Linker*>(molecule));        
+        unsigned int level = pebblerGraph.GetNodeLevel(v);
+        if (level > HIERARCHICAL_LEVEL_BOUND) continue;
+
+        total[level]++;
+        if (pebblerGraph.IsNodePebbled(v)) reachable[level]++;
     }
-    else if (type == 'r')
+
+    std::cout << "Reachable from " << startNodes.size() << " of "
+              << Molecule::NUM_UNIQUE_FRAGMENTS << " linkers / rigids:" << std::endl;
+    for (unsigned int m = 2; m <= HIERARCHICAL_LEVEL_BOUND; m++)
     {
-        rigids.push_back(static_cast<Rigid*>(molecule));        
+        std::cout << "\tLevel " << m << ": " << reachable[m] << " of " << total[m] << std::endl;
     }
 }
 
-void readMoleculeFile(const char* fileName)
+//
+// Parse a comma-separated list of fragment names against the query's fragments.
+//
+bool ParseFragmentList(const SubsetQuery& query, const std::string& names, std::vector<bool>& listed)
 {
-    //
-    // Input parser conversion functionality for Open babel
-    //
-    OpenBabel::OBConversion obConversion;
-    obConversion.SetInFormat("SDF");
+    listed.assign(query.NumFragments(), false);
 
-    //
-    // Open the file, split the current molecule into Molecule Data (prefix)
-    // and Our Data (Suffix)
-    //
-    std::ifstream infile;
-    infile.open(fileName);
-
-    std::string name = "UNKNOWN";
-    std::string prefix = "";
-    std::string suffix = "";
-    
-    while(splitMolecule(infile, name, prefix, suffix))
+    std::istringstream list(names);
+    std::string name;
+    while (std::getline(list, name, ','))
     {
-        //
-        // If the name of molecule is not given, overwrite it with the name of the file.
-        //
-        if (name == "UNKNOWN")
+        int f = query.FindFragment(name);
+        if (f < 0)
         {
-           name = "####   ";
-           name += fileName;
-           name += "    ####";
+            std::cerr << "No linker / rigid named '" << name << "' in the hypergraph." << std::endl;
+            return false;
         }
 
-        if (g_debug_output) std::cerr << "Name: " << std::endl << name << std::endl;
-        if (g_debug_output) std::cerr << "Prefix: " << std::endl << prefix << std::endl;
-        if (g_debug_output) std::cerr << "Suffix: " << std::endl << suffix << std::endl;
-
-        // Create and parse using Open Babel
-        OpenBabel::OBMol* mol = new OpenBabel::OBMol();
-        bool notAtEnd = obConversion.ReadString(mol, prefix);
+        listed[f] = true;
+    }
 
-        // Assign all needed data to the molecule (comment data)
-        Molecule* local = createLocalMolecule(mol, fileName[0] == 'l' ? LINKER : RIGID,
-                                              name, suffix);
+    return true;
+}
 
-        // calculate the molecular weight, H donors and acceptors and the plogp
-        local->openBabelPredictLipinski();
+//
+// -query: count the molecules of a saved hypergraph (-hg) that use only the fragments
+// kept (-keep) or not dropped (-drop), per level; nothing is synthesized.
+//
+int RunSubsetQuery(const Options& options)
+{
+    HyperGraphFile graph;
+    if (!graph.Open(options.queryFile)) return 1;
 
-        // add to logfile
-        if (local->islipinskiPredicted())
-        {
-            std::ofstream logfile("synth_log_initial_fragments_logfile.txt",
-                                  std::ofstream::out | std::ofstream::app); // append
-            logfile << fileName << "\nMolWt = " << local->getMolWt() << "\n";
-            logfile << "HBD = " << local->getHBD() << "\n";
-            logfile << "HBA1 = " << local->getHBA1() << "\n";
-            logfile << "logP = " << local->getlogP() << "\n";
-            logfile << std::endl;
-            logfile.close();
-        }
-        else std::cerr << "Main: predictLipinski failed somehow!" << endl;
+    SubsetQuery query(graph);
 
-        if (g_debug_output) std::cout << "Local: " << *local << "|" << std::endl;
-    
-        // Add to the linker or rigid list as needed.
-        addMolecule(fileName[0], local); 
+    std::vector<bool> allowed;
+    if (!options.keepFragments.empty())
+    {
+        if (!ParseFragmentList(query, options.keepFragments, allowed)) return 1;
+    }
+    else
+    {
+        if (!ParseFragmentList(query, options.dropFragments, allowed)) return 1;
+        allowed.flip();
     }
-}
 
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
 
-//
-// Parse each input data files
-//
-bool readInputFiles(const Options& options)
-{
-    for (std::vector<std::string>::const_iterator it = options.inFiles.begin();
-         it != options.inFiles.end(); it++)
+    std::vector<bool> survivors;
+    query.Query(allowed, survivors);
+
+    gettimeofday(&end, NULL);
+
+    std::vector<unsigned int> surviving;
+    std::vector<unsigned int> total;
+    for (unsigned int n = 0; n < graph.NumNodes(); n++)
     {
-        if ((*it)[0] != 'l' && (*it)[0] != 'r')
+        unsigned int level = graph.GetNode(n).level;
+        if (level >= total.size())
         {
-            cerr << "Unexpected file prefix: \'" << (*it)[0]
-                 << "\' with file " << *it << endl;
-            return false;
+            total.resize(level + 1, 0);
+            surviving.resize(level + 1, 0);
         }
 
-        readMoleculeFile((*it).c_str());
+        total[level]++;
+        if (survivors[n]) surviving[level]++;
     }
 
-    return true;
+    unsigned int allowedCount = std::count(allowed.begin(), allowed.end(), true);
+
+    std::cout << "Molecules using only " << allowedCount << " of " << query.NumFragments()
+              << " linkers / rigids (" << (end.tv_sec - start.tv_sec) * 1000.0 +
+                                          (end.tv_usec - start.tv_usec) / 1000.0 << " ms):" << std::endl;
+    for (unsigned int m = 2; m < total.size(); m++)
+    {
+        std::cout << "\tLevel " << m << ": " << surviving[m] << " of " << total[m] << std::endl;
+    }
+
+    return 0;
 }
 
 
@@ -253,6 +252,8 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    if (!options.queryFile.empty()) return RunSubsetQuery(options);
+
     // 
     // Output command-line option information
     //
@@ -266,6 +267,36 @@ int main(int argc, char** argv)
               << Options::TANIMOTO << std::endl;
     std::cerr << "OBGEN output thread pool size: "
               << Options::OBGEN_THREAD_POOL_SIZE << std::endl;
+    std::cerr << "Fragment loader thread pool size: "
+              << Options::LOADER_THREAD_POOL_SIZE << std::endl;
+    if (Options::MEMORY_CAP_MB > 0)
+    {
+        std::cerr << "Bounded memory synthesis; resident memory cap: "
+                  << Options::MEMORY_CAP_MB << " MB" << std::endl;
+    }
+    if (Options::SPILL_THRESHOLD > 0)
+    {
+        std::cerr << "Level queues spill to " << Options::SPILL_DIRECTORY << " past "
+                  << Options::SPILL_THRESHOLD << " molecules" << std::endl;
+    }
+    if (Options::CHECKPOINT_FILE.empty()) Options::CHECKPOINT_FILE = options.outFile + ".ckpt";
+    if (Options::CHECKPOINT_INTERVAL > 0)
+    {
+        std::cerr << "Checkpointing to " << Options::CHECKPOINT_FILE << " every "
+                  << Options::CHECKPOINT_INTERVAL << " seconds" << std::endl;
+    }
+    if (Options::RESUME)
+    {
+        std::cerr << "Resuming from checkpoint " << Options::CHECKPOINT_FILE << std::endl;
+    }
+    if (!options.statsFile.empty())
+    {
+        std::cerr << "Writing statistics to " << options.statsFile;
+        if (Options::STATS_INTERVAL > 0) std::cerr << " every " << Options::STATS_INTERVAL << " seconds";
+        std::cerr << std::endl;
+
+        Instrumentation::Start(options.statsFile, Options::STATS_INTERVAL);
+    }
 
 
     if (!readInputFiles(options)) return 1;
@@ -280,37 +311,124 @@ int main(int argc, char** argv)
         return 0;
     }
 
+    //
+    // The molecules specified in the validation file (command-line -v) are loaded
+    // now and validated as synthesized molecules are written.
+    //
+    Validator validator(OBWriter::fingerprints);
+    if (validator.Load(options.validationFile)) OBWriter::SetValidator(&validator);
+
+    if (Options::GOAL)
+    {
+        if (validator.size() == 0) std::cerr << "-goal requires validation molecules (-v); ignored." << std::endl;
+        else std::cerr << "Synthesis stops once all validation molecules are matched." << std::endl;
+    }
+
+    if (Options::ORDERED) std::cerr << "Output is written by level, in canonical SMILES order." << std::endl;
+
     // Output object for the nodes of the hypergraph.
     OBWriter* writer = new OBWriter(Options::OBGEN_THREAD_POOL_SIZE);
-    writer->InitializeFile(options.outFile);
+    writer->InitializeFile(options.outFile, Options::RESUME);
 
     // The main object that performs synthesis.
     Instantiator instantiator(writer, cout);
 
+    //
+    // Goal-directed synthesis: only molecules that can grow into a validation target are extended.
+    //
+    GoalPruner pruner;
+    if (Options::PRUNE)
+    {
+        if (validator.size() > 0 && pruner.Load(options.validationFile))
+        {
+            std::cerr << "Goal pruning toward " << pruner.NumTargets() << " validation molecules" << std::endl;
+            instantiator.SetGoalPruner(&pruner);
+        }
+        else std::cerr << "-prune requires validation molecules (-v); ignored." << std::endl;
+    }
+
+    //
+    // Checkpoints are keyed by the contents of the input files so a resume
+    // against different fragments is refused.
+    //
+    if (Options::CHECKPOINT_INTERVAL > 0 || Options::RESUME)
+    {
+        unsigned long long inputKey;
+        if (!FragmentCache::HashInputs(options.inFiles, inputKey))
+        {
+            std::cerr << "Unable to read the input files for the checkpoint key." << std::endl;
+            return 1;
+        }
+
+        instantiator.SetCheckpoint(Options::CHECKPOINT_FILE, inputKey);
+    }
+
     // Instantiation build the hypergraph; this is the main data structure for the
     // resultant molecules.
     // Also creates the hypergraph using threaded or non-threaded techniques.
     HyperGraph<Molecule, EdgeAnnotationT>* graph = instantiator.ThreadedInstantiate(linkers,
                                                                                     rigids);
+    if (graph == 0)
+    {
+        std::cerr << "Unable to resume from " << Options::CHECKPOINT_FILE << "; exiting." << std::endl;
+        return 1;
+    }
+
+    if (instantiator.Failed())
+    {
+        std::cerr << "Synthesis stopped after an error; the output is incomplete." << std::endl;
+
+        delete writer;
+        Instrumentation::Stop();
+        Cleanup(linkers, rigids);
+
+        return 1;
+    }
+
+    if (OBWriter::GoalReached())
+    {
+        std::cout << "All validation molecules matched; synthesis stopped early." << std::endl;
+    }
 
     std::cout << "Hypergraph contains (" << graph->size() << ") nodes" << std::endl;
-    std::cout << OBWriter::compliantMols.size()
+
+    if (!options.hyperGraphFile.empty())
+    {
+        if (HyperGraphFile::Save(*graph, options.hyperGraphFile))
+        {
+            std::cout << "Hypergraph written to " << options.hyperGraphFile << std::endl;
+        }
+    }
+
+    if (!options.reachFragments.empty()) ReportReachable(*graph, options.reachFragments);
+
+    std::cout << OBWriter::fingerprints.size()
               << " are Lipinski compliant molecules" << std::endl;
 
     //
-    // Validate the molecules specified in the validation file (command-line -v)
+    // Verdict for the molecules specified in the validation file (command-line -v)
     //
-    Validator validator(OBWriter::compliantMols);
-    validator.Validate(options.validationFile);
+    if (validator.size() > 0)
+    {
+        validator.ValidateIndex();
+        validator.Report();
+    }
 
     // Deleting the writer will kill the thread pool.
     delete writer; 
 
-    // For later: pebbling
-    //PebblerHyperGraph<Molecule, EdgeAnnotationT> pebblerGraph = graph->GetPebblerHyperGraph();
+    // Final statistics, once the output threads are done.
+    Instrumentation::Stop();
 
     Cleanup(linkers, rigids);
 
+    // The writer is stopped (and the output flushed) once it is deleted.
+    if (OBWriter::OutputFailed())
+    {
+        std::cerr << "Writing the output failed; the output is incomplete." << std::endl;
+        return 1;
+    }
+
 std::cerr << "Exiting the main thread." << std::endl;
 
     return 0;
@@ -25,6 +25,7 @@
 #include "Constants.h"
 #include "Options.h"
 #include "FragmentGraph.h"
+#include "Instrumentation.h"
 
 
 // Static allocation of the thread pool.
@@ -46,7 +47,12 @@ static const unsigned int NO_CONNECTION = -1;
 
 
 
-Molecule::Molecule() : lipinskiPredicted(false),
+Molecule::Molecule() : uniqueIndexID(-1),
+                       type(COMPLEX),
+                       fragmentCounter(0),
+                       obmol(0),
+                       fingerprint(0),
+                       lipinskiPredicted(false),
                        lipinskiEstimated(false)
 {
     init_openbabel_lock();
@@ -89,7 +95,7 @@ Molecule::Molecule(OpenBabel::OBMol* mol, const std::string& n, MoleculeT t) :
     init_openbabel_lock();
 
     // Locking open babel since it is not thread-safe (at all)
-    pthread_mutex_lock(&Molecule::openbabel_lock);
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
 
     // Create the initial atom / bond data based on obmol.
     localizeOBMol();
@@ -98,6 +104,62 @@ Molecule::Molecule(OpenBabel::OBMol* mol, const std::string& n, MoleculeT t) :
     pthread_mutex_unlock(&openbabel_lock);
 }
 
+//
+// Concatenation of two molecules in our local representation; unlike the constructor
+// above, nothing is derived from the Open Babel molecule.
+//
+Molecule::Molecule(const Molecule& left, const Molecule& right,
+                   int leftAtom, int rightAtom, OpenBabel::OBMol* mol) :
+    uniqueIndexID(-1),
+    numLinkers(-1),
+    numRigids(-1),
+    numUniqueLinkers(-1),
+    numUniqueRigids(-1),
+    obmol(mol),
+    name("complex"),
+    type(COMPLEX),
+    fragmentCounter(0),
+    fingerprint(0),
+    lipinskiPredicted(false),
+    lipinskiEstimated(false) 
+{
+    init_openbabel_lock();
+
+    int leftSize = left.atoms.size();
+
+    //
+    // Atoms: copies of both (trivially copyable) atom arrays; ids follow the index.
+    //
+    this->atoms.reserve(leftSize + right.atoms.size());
+    this->atoms.insert(this->atoms.end(), left.atoms.begin(), left.atoms.end());
+    this->atoms.insert(this->atoms.end(), right.atoms.begin(), right.atoms.end());
+
+    for (int a = 0; a < this->atoms.size(); a++)
+    {
+        this->atoms[a].setAtomID(atomIdMaker.getNextId());
+    }
+
+    //
+    // Bonds: those of left, those of right (offset) and the connecting bond; the
+    // same order Open Babel gives the combined molecule.
+    //
+    this->bonds.reserve(left.bonds.size() + right.bonds.size() + 1);
+    this->bonds.insert(this->bonds.end(), left.bonds.begin(), left.bonds.end());
+
+    for (int b = 0; b < right.bonds.size(); b++)
+    {
+        const Bond& bond = right.bonds[b];
+
+        this->bonds.push_back(Bond(this->bonds.size(),
+                                   bond.getOriginAtomID() + leftSize,
+                                   bond.getTargetAtomID() + leftSize));
+    }
+
+    this->bonds.push_back(Bond(this->bonds.size(), leftAtom, rightAtom + leftSize));
+
+    BuildAdjacency();
+}
+
 void Molecule::init_openbabel_lock()
 {
     //
@@ -199,6 +261,56 @@ void Molecule::initGraphRepresentation()
     }
 }
 
+// *****************************************************************************
+
+void Molecule::Compact()
+{
+    std::vector<Atom>().swap(atoms);
+    std::vector<Bond>().swap(bonds);
+    std::vector<unsigned int>().swap(adjacencyStart);
+    std::vector<unsigned int>().swap(adjacencyBonds);
+    std::vector<unsigned int>().swap(connectionIDs);
+    std::vector<Rigid*>().swap(rigids);
+    std::vector<Linker*>().swap(linkers);
+
+    obmol = 0;
+}
+
+void Molecule::ReleaseOpenBabelMol()
+{
+    Instrumentation::Lock(&openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    delete obmol;
+    obmol = 0;
+
+    pthread_mutex_unlock(&openbabel_lock);
+}
+
+void Molecule::ReleaseFingerprint()
+{
+    delete fingerprint;
+    fingerprint = 0;
+}
+
+void Molecule::Release()
+{
+    ReleaseOpenBabelMol();
+    ReleaseFingerprint();
+
+    delete[] fragmentCounter;
+    fragmentCounter = 0;
+}
+
+void Molecule::ShareIdentity(const Molecule& node)
+{
+    fragmentCounter = node.fragmentCounter;
+    fingerprint = node.fingerprint;
+
+    calcFragmentInfo();
+}
+
+// *****************************************************************************
+
 void Molecule::SetBaseMoleculeInfo(const std::vector<Molecule*> baseMols,
                                   unsigned int numRigids, unsigned int numLinkers)
 {
@@ -215,7 +327,7 @@ void Molecule::SetBaseMoleculeInfo(const std::vector<Molecule*> baseMols,
 
 void Molecule::openBabelPredictLipinski()
 {
-    pthread_mutex_lock(&Molecule::openbabel_lock);
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
 
     // calculate the molecular weight, H donors and acceptors and the plogp
     OpenBabel::OBDescriptor* pDesc1 = OpenBabel::OBDescriptor::FindType("HBD");
@@ -283,9 +395,11 @@ void Molecule::localizeOBMol()
     //
     // Translate the OB atoms into our local atoms.
     //
+    this->atoms.reserve(numOfAtoms);
+    this->bonds.reserve(numOfBonds);
     for(int x = 0; x < numOfAtoms; x++)
     {
-        this->addAtom(*new Atom(atomIdMaker.getNextId(), *new AtomT()));
+        this->addAtom(Atom(atomIdMaker.getNextId(), false));
     }
 
     //
@@ -298,6 +412,25 @@ void Molecule::localizeOBMol()
         this->addBond((int)oneObBond->GetBeginAtom()->GetId(), 
                       (int)oneObBond->GetEndAtom()->GetId());
     }
+
+    BuildAdjacency();
+}
+
+//
+// Atoms of unknown type are not counted, so the count never exceeds the heavy atoms
+// of the Open Babel molecule.
+//
+unsigned int Molecule::getNumberOfHeavyAtoms() const
+{
+    unsigned int numHeavy = 0;
+    for (unsigned int a = 0; a < atoms.size(); a++)
+    {
+        AtomEnumT element = AtomT::Interned(atoms[a].getAtomTypeId()).atomType;
+
+        if (element != HYDROGEN && element != UNKNOWN) numHeavy++;
+    }
+
+    return numHeavy;
 }
 
 //
@@ -314,6 +447,8 @@ bool Molecule::operator==(const Molecule& that) const
     // The fragment counter maintains the number of instances of each specific fragment;
     // if any of those counts differ, we have non-isomorphism.
     //
+    Instrumentation::Add(Instrumentation::NODE_COMPARISONS);
+
     for (int f = 0; f < Molecule::FRAGMENT_END_INDEX; f++)
     {
         if (this->fragmentCounter[f] != that.fragmentCounter[f])
@@ -332,7 +467,12 @@ bool Molecule::operator==(const Molecule& that) const
     //
     // Fingerprint checking is last since it is slow; check other characteristics first.
     //
-    return this->fingerprint->IsIsomorphicTo(that.getFingerprint());
+    Instrumentation::Add(Instrumentation::ISOMORPHISM_CHECKS);
+
+    bool isomorphic = this->fingerprint->IsIsomorphicTo(that.getFingerprint());
+    if (isomorphic) Instrumentation::Add(Instrumentation::ISOMORPHISM_MATCHES);
+
+    return isomorphic;
 }
 
 // *****************************************************************************
@@ -490,6 +630,8 @@ std::vector<EdgeAggregator*>* Molecule::Compose(const Molecule& that) const
 {
     std::vector<EdgeAggregator*>* newMolecules = new std::vector<EdgeAggregator*>();
 
+    ScopedTimer timer(Instrumentation::COMPOSE_NS);
+    Instrumentation::Add(Instrumentation::COMPOSE_CALLS);
 
     //
     // Pre-emptively check the molecular weight to see if there is a benefit
@@ -497,6 +639,9 @@ std::vector<EdgeAggregator*>* Molecule::Compose(const Molecule& that) const
     //
     if (Molecule::willExceedMolecularWeight(*this, that)) return newMolecules;
 
+    // Counted locally; the connection checks are too frequent to record one at a time.
+    unsigned long long connectHits = 0;
+
     //
     // For each atom in this molecule, does it connect to an atom in that molecule?
     //
@@ -510,6 +655,7 @@ std::vector<EdgeAggregator*>* Molecule::Compose(const Molecule& that) const
             //
             if (atoms[thisA].CanConnectTo(that.atoms[thatA]))
             {
+                connectHits++;
 
                 if (g_debug_output)
                 {
@@ -536,10 +682,19 @@ std::vector<EdgeAggregator*>* Molecule::Compose(const Molecule& that) const
                     // Add the new molecule / edge to the list of new molecules
                     newMolecules->push_back(new EdgeAggregator(ante, newMol, new EdgeAnnotationT()));
                 }
+                else
+                {
+                    newMol->Release();
+                    delete newMol;
+                }
             }
         }
     } 
 
+    Instrumentation::Add(Instrumentation::CONNECT_CHECKS, (unsigned long long)atoms.size() * that.atoms.size());
+    Instrumentation::Add(Instrumentation::CONNECT_HITS, connectHits);
+    Instrumentation::Add(Instrumentation::COMPOSE_PRODUCTS, newMolecules->size());
+
     return newMolecules;
 }
 
@@ -554,7 +709,7 @@ Molecule* Molecule::ComposeToNewMolecule(const Molecule& that,
                                          int thisAtomIndex,
                                          int thatAtomIndex) const
 {
-    pthread_mutex_lock(&openbabel_lock);
+    Instrumentation::Lock(&openbabel_lock, Instrumentation::OPENBABEL_LOCK);
     //
     // Combine the Open Babel representations.
     //
@@ -569,31 +724,17 @@ Molecule* Molecule::ComposeToNewMolecule(const Molecule& that,
     // Remove the comment information as it is no longer relevant to this molecule.
     newOBMol->DeleteData("Comment");
 
-    // Unlocking open babel; the next constructor call performs a relock
+    // Unlocking open babel
     pthread_mutex_unlock(&openbabel_lock);
 
     //
+    // Concatenate the local atoms and bonds of both molecules with the new bond.
+    // (thatAtomIndex is in the combined (1-based) Open Babel numbering.)
     //
-    // Transfer the local data.
-    //
-    //
-    // Create the new Molecule object; it will create the localized information.
-    Molecule* newLocal = new Molecule(newOBMol, "complex", COMPLEX);
-
-    //
-    // Copy the local atom information
-    //
-    int newAtomCount = 0;
-    for (int a = 0; a < this->atoms.size(); a++, newAtomCount++)
-    {
-        newLocal->atoms[newAtomCount].SetBasedOn(this->atoms[a]);
-    }
+    Molecule* newLocal = new Molecule(*this, that, thisAtomIndex - 1,
+                                      thatAtomIndex - 1 - this->atoms.size(), newOBMol);
 
-    int firstThatIndex = newAtomCount;
-    for (int a = 0; a < that.atoms.size(); a++, newAtomCount++)
-    {
-        newLocal->atoms[newAtomCount].SetBasedOn(that.atoms[a]);
-    }
+    int firstThatIndex = this->atoms.size();
 
     // Init the fragment counter container.
     newLocal->initFragmentInfo();
@@ -677,7 +818,13 @@ FragmentGraph* Molecule::getFingerprint() const
 
 int Molecule::getAtomIndex(int id) const
 {
-    for(int x = 0; x < this->atoms.size(); x++)
+    // Atoms are stored in id order.
+    int x = id - (int)atomIdMaker.min();
+
+    if (x >= 0 && x < this->atoms.size() && this->atoms[x].getAtomID() == id) return x;
+
+    // Not in id order (should not happen); search.
+    for(x = 0; x < this->atoms.size(); x++)
     {
         if(this->atoms[x].getAtomID() == id)
         {
@@ -715,6 +862,9 @@ bool Molecule::addBond(int xID, int yID) // , eTypeOfBondT bt, eStatusBitT s)
 
     this->bonds.push_back(Bond(this->bonds.size(), xID, yID));
 
+    // The compressed adjacency is rebuilt on demand.
+    adjacencyStart.clear();
+
     return true;
 }
 
@@ -722,6 +872,9 @@ bool Molecule::addBond(int xID, int yID) // , eTypeOfBondT bt, eStatusBitT s)
 
 int Molecule::getBondIndex(int id) const
 {
+    // Bond ids are their indices.
+    if (id >= 0 && id < this->bonds.size() && this->bonds[id].getBondID() == id) return id;
+
     for(int x = 0; x < this->bonds.size(); x++)
     {
         if(this->bonds[x].getBondID() == id)
@@ -737,6 +890,24 @@ int Molecule::getBondIndex(int id) const
 
 int Molecule::getBondIndex(int xID, int yID) const
 {
+    //
+    // Only the bonds of atom x are considered when the adjacency is current.
+    //
+    if (adjacencyStart.size() == this->atoms.size() + 1)
+    {
+        int xIndex = getAtomIndex(xID);
+        if (xIndex == -1) return -1;
+
+        for (unsigned int n = adjacencyStart[xIndex]; n < adjacencyStart[xIndex + 1]; n++)
+        {
+            const Bond& bond = this->bonds[adjacencyBonds[n]];
+
+            if (bond.getOriginAtomID() == yID || bond.getTargetAtomID() == yID) return adjacencyBonds[n];
+        }
+
+        return -1;
+    }
+
     for(int x = 0; x < this->bonds.size(); x++)
     {
         if(this->bonds[x].getOriginAtomID() == xID && this->bonds[x].getTargetAtomID() == yID)
@@ -753,6 +924,31 @@ int Molecule::getBondIndex(int xID, int yID) const
     return -1;
 }
 
+// *****************************************************************************
+//
+// Counting sort of the bond endpoints into compressed rows.
+//
+void Molecule::BuildAdjacency()
+{
+    adjacencyStart.assign(this->atoms.size() + 1, 0);
+    adjacencyBonds.resize(2 * this->bonds.size());
+
+    for (int b = 0; b < this->bonds.size(); b++)
+    {
+        adjacencyStart[getAtomIndex(bonds[b].getOriginAtomID()) + 1]++;
+        adjacencyStart[getAtomIndex(bonds[b].getTargetAtomID()) + 1]++;
+    }
+
+    for (int a = 0; a < this->atoms.size(); a++) adjacencyStart[a + 1] += adjacencyStart[a];
+
+    std::vector<unsigned int> next(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (int b = 0; b < this->bonds.size(); b++)
+    {
+        adjacencyBonds[next[getAtomIndex(bonds[b].getOriginAtomID())]++] = b;
+        adjacencyBonds[next[getAtomIndex(bonds[b].getTargetAtomID())]++] = b;
+    }
+}
+
 // *****************************************************************************
 
 Bond Molecule::getBond(int id) const
@@ -31,7 +31,7 @@ class Molecule
     Molecule();
     Molecule(OpenBabel::OBMol* mol, const std::string& name, MoleculeT t);
 
-    ~Molecule();
+    virtual ~Molecule();
 
     void setUniqueIndexID(unsigned int id) { uniqueIndexID = id; }
     unsigned int getUniqueIndexID() const { return uniqueIndexID; }
@@ -55,6 +55,8 @@ class Molecule
 
     int getNumberOfAtoms() const { return this->atoms.size(); }
     int getNumberOfBonds() const { return this->bonds.size(); }
+    // Local atoms of a known, non-hydrogen type; no Open Babel access.
+    unsigned int getNumberOfHeavyAtoms() const;
 
     Atom getAtom(int id) const;
     Bond getBond(int id) const;
@@ -79,6 +81,9 @@ class Molecule
     unsigned int NumUniqueRigids() const { return numUniqueRigids; }
     unsigned int NumUniqueLinkers() const { return numUniqueLinkers; }
 
+    // Number of occurrences of base fragment f (by unique index id) in this molecule.
+    unsigned int FragmentCount(unsigned int f) const { return fragmentCounter[f]; }
+
     std::string getName() const { return name; }
 
     void openBabelPredictLipinski();
@@ -101,6 +106,20 @@ class Molecule
     // Initialize the graph-based representation of the fragment
     void initGraphRepresentation();
 
+    //
+    // Memory management; copies of a molecule share the Open Babel molecule,
+    // fingerprint and fragment counter, so the caller decides which copy owns them.
+    //
+    // Drop the local atoms / bonds and the Open Babel reference; what remains identifies
+    // the molecule (fragment counts and fingerprint) as a hypergraph node.
+    void Compact();
+    void ReleaseOpenBabelMol();
+    void ReleaseFingerprint();
+    // Release all shared data (Open Babel molecule, fingerprint and fragment counter).
+    void Release();
+    // Share the fragment counter and fingerprint of (the hypergraph node for) this molecule.
+    void ShareIdentity(const Molecule& node);
+
     // Collection of linkers and rigids for this synthesis.
     static std::vector<Molecule*> baseMolecules;
     static void SetBaseMoleculeInfo(const std::vector<Molecule*> baseMols,
@@ -116,9 +135,20 @@ class Molecule
     void init_openbabel_lock();
     static pthread_mutex_t openbabel_lock;
 
+    // Binary (de)serialization of the local representation.
+    friend class MoleculeIO;
+    // Micro-benchmarks of the composition routines (bench/Benchmark.cpp).
+    friend class Benchmark;
+
   private:
     void localizeOBMol();
 
+    // Composition: the atoms and bonds of left followed by those of right (ids
+    // offset by the size of left) plus the bond between left atom leftAtom and right
+    // atom rightAtom (indices); mol is the corresponding Open Babel molecule.
+    Molecule(const Molecule& left, const Molecule& right,
+             int leftAtom, int rightAtom, OpenBabel::OBMol* mol);
+
     bool exceedsMaxEstimatedThresholds();
     bool ContainsLoops() const;
     bool satisfiesMoleculeSynthesisCriteria();
@@ -167,9 +197,18 @@ class Molecule
     // Used for molecular comparison
     FragmentGraph* fingerprint;
 
-    // Local atoms and bonds
+    // Local atoms and bonds, in id order: atom id atomIdMaker.min() + i is atoms[i]
+    // and bond id i is bonds[i].
     std::vector<Atom> atoms;
     std::vector<Bond> bonds;
+
+    // Bonds by endpoint (compressed rows): the bonds of atoms[i] are
+    // adjacencyBonds[adjacencyStart[i] .. adjacencyStart[i + 1]). Empty until
+    // BuildAdjacency; adding a bond discards it.
+    std::vector<unsigned int> adjacencyStart;
+    std::vector<unsigned int> adjacencyBonds;
+
+    void BuildAdjacency();
    
     int getAtomIndex(int id) const;
     int getBondIndex(int id) const;
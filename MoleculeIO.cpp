@@ -0,0 +1,621 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <pthread.h>
+
+
+#include <openbabel/mol.h>
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+
+
+#include "MoleculeIO.h"
+#include "Molecule.h"
+#include "Linker.h"
+#include "Rigid.h"
+#include "Atom.h"
+#include "Bond.h"
+#include "FragmentGraph.h"
+#include "FragmentGraphNode.h"
+#include "FragmentSubNode.h"
+#include "Instrumentation.h"
+
+
+//
+// Perception state restored along with the values it covers. Rings, SSSR and
+// stereochemistry are perceived again on demand from the coordinates, dimension
+// and wedge / hash bonds, as they are for a molecule read from an SDF record.
+//
+static const int RESTORED_MOL_FLAGS = OB_AROMATIC_MOL | OB_ATOMTYPES_MOL | OB_HYBRID_MOL |
+                                      OB_IMPVAL_MOL | OB_KEKULE_MOL | OB_PCHARGE_MOL |
+                                      OB_H_ADDED_MOL | OB_PH_CORRECTED_MOL |
+                                      OB_AROM_CORRECTED_MOL | OB_TCHARGE_MOL |
+                                      OB_TSPIN_MOL | OB_ATOMSPIN_MOL;
+
+// Per-atom flags.
+static const unsigned char IO_AROMATIC_ATOM = 1 << 0;
+static const unsigned char IO_NO_H_FORCED = 1 << 1;
+static const unsigned char IO_IMPL_H_FORCED = 1 << 2;
+
+// ****************************************************************************
+//
+// Perceived values are written only if perceived; nothing is perceived here so the
+// molecule is left as it was.
+//
+void MoleculeIO::WriteOBMol(BinaryWriter& out, OpenBabel::OBMol& mol)
+{
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    int flags = mol.GetFlags() & RESTORED_MOL_FLAGS;
+
+    out.WriteString(mol.GetTitle());
+    out.Write<unsigned int>(mol.GetDimension());
+    out.Write<int>(flags);
+    out.Write<int>(flags & OB_TCHARGE_MOL ? mol.GetTotalCharge() : 0);
+    out.Write<unsigned int>(flags & OB_TSPIN_MOL ? mol.GetTotalSpinMultiplicity() : 1);
+
+    out.Write<unsigned int>(mol.NumAtoms());
+    for (unsigned int a = 1; a <= mol.NumAtoms(); a++)
+    {
+        OpenBabel::OBAtom* atom = mol.GetAtom(a);
+
+        unsigned char atomFlags = 0;
+        if ((flags & OB_AROMATIC_MOL) && atom->IsAromatic()) atomFlags |= IO_AROMATIC_ATOM;
+        if (atom->HasNoHForced()) atomFlags |= IO_NO_H_FORCED;
+        if (atom->HasImplHForced()) atomFlags |= IO_IMPL_H_FORCED;
+
+        out.Write<int>(atom->GetAtomicNum());
+        out.Write<int>(atom->GetFormalCharge());
+        out.Write<unsigned int>(atom->GetIsotope());
+        out.Write<double>(atom->GetX());
+        out.Write<double>(atom->GetY());
+        out.Write<double>(atom->GetZ());
+        out.Write<int>(atom->GetSpinMultiplicity());
+        out.Write<unsigned char>(atomFlags);
+        out.Write<int>(flags & OB_IMPVAL_MOL ? (int)atom->GetImplicitValence() : 0);
+        out.Write<int>(flags & OB_HYBRID_MOL ? atom->GetHyb() : 0);
+        out.WriteString(flags & OB_ATOMTYPES_MOL ? atom->GetType() : "");
+        out.Write<double>(flags & OB_PCHARGE_MOL ? atom->GetPartialCharge() : 0.0);
+    }
+
+    out.Write<unsigned int>(mol.NumBonds());
+    for (unsigned int b = 0; b < mol.NumBonds(); b++)
+    {
+        OpenBabel::OBBond* bond = mol.GetBond(b);
+
+        int bondFlags = 0;
+        if ((flags & OB_AROMATIC_MOL) && bond->IsAromatic()) bondFlags |= OB_AROMATIC_BOND;
+        if (bond->IsWedge()) bondFlags |= OB_WEDGE_BOND;
+        if (bond->IsHash()) bondFlags |= OB_HASH_BOND;
+
+        out.Write<unsigned int>(bond->GetBeginAtomIdx());
+        out.Write<unsigned int>(bond->GetEndAtomIdx());
+        out.Write<unsigned int>(bond->GetBondOrder());
+        out.Write<int>(bondFlags);
+    }
+
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+}
+
+// ****************************************************************************
+//
+// EndModify clears perceived data, so the perceived values (and the flags marking
+// them perceived) are restored afterwards.
+//
+OpenBabel::OBMol* MoleculeIO::ReadOBMol(BinaryReader& in)
+{
+    std::string title = in.ReadString();
+    unsigned int dimension = in.Read<unsigned int>();
+    int flags = in.Read<int>() & RESTORED_MOL_FLAGS;
+    int totalCharge = in.Read<int>();
+    unsigned int totalSpin = in.Read<unsigned int>();
+
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    OpenBabel::OBMol* mol = new OpenBabel::OBMol();
+
+    try
+    {
+        mol->BeginModify();
+
+        std::vector<unsigned char> atomFlags;
+        std::vector<int> implicitValences;
+        std::vector<int> hybridizations;
+        std::vector<std::string> types;
+        std::vector<double> partialCharges;
+
+        unsigned int numAtoms = in.Read<unsigned int>();
+        for (unsigned int a = 0; a < numAtoms; a++)
+        {
+            OpenBabel::OBAtom* atom = mol->NewAtom();
+
+            atom->SetAtomicNum(in.Read<int>());
+            atom->SetFormalCharge(in.Read<int>());
+            atom->SetIsotope(in.Read<unsigned int>());
+
+            double x = in.Read<double>();
+            double y = in.Read<double>();
+            double z = in.Read<double>();
+            atom->SetVector(x, y, z);
+
+            atom->SetSpinMultiplicity(in.Read<int>());
+
+            atomFlags.push_back(in.Read<unsigned char>());
+            implicitValences.push_back(in.Read<int>());
+            hybridizations.push_back(in.Read<int>());
+            types.push_back(in.ReadString());
+            partialCharges.push_back(in.Read<double>());
+        }
+
+        std::vector<bool> aromaticBonds;
+
+        unsigned int numBonds = in.Read<unsigned int>();
+        for (unsigned int b = 0; b < numBonds; b++)
+        {
+            unsigned int begin = in.Read<unsigned int>();
+            unsigned int end = in.Read<unsigned int>();
+            unsigned int order = in.Read<unsigned int>();
+            int bondFlags = in.Read<int>();
+
+            mol->AddBond(begin, end, order, bondFlags);
+            aromaticBonds.push_back((bondFlags & OB_AROMATIC_BOND) != 0);
+        }
+
+        mol->EndModify();
+        mol->SetTitle(title);
+        mol->SetDimension(dimension);
+
+        for (unsigned int a = 0; a < numAtoms; a++)
+        {
+            OpenBabel::OBAtom* atom = mol->GetAtom(a + 1);
+
+            if (atomFlags[a] & IO_NO_H_FORCED) atom->ForceNoH();
+            if (atomFlags[a] & IO_IMPL_H_FORCED) atom->ForceImplH();
+
+            if (flags & OB_AROMATIC_MOL)
+            {
+                if (atomFlags[a] & IO_AROMATIC_ATOM) atom->SetAromatic();
+                else atom->UnsetAromatic();
+            }
+            if (flags & OB_IMPVAL_MOL) atom->SetImplicitValence(implicitValences[a]);
+            if (flags & OB_HYBRID_MOL) atom->SetHyb(hybridizations[a]);
+            if (flags & OB_ATOMTYPES_MOL) atom->SetType(types[a]);
+            if (flags & OB_PCHARGE_MOL) atom->SetPartialCharge(partialCharges[a]);
+        }
+
+        if (flags & OB_AROMATIC_MOL)
+        {
+            for (unsigned int b = 0; b < numBonds; b++)
+            {
+                if (aromaticBonds[b]) mol->GetBond(b)->SetAromatic();
+                else mol->GetBond(b)->UnsetAromatic();
+            }
+        }
+
+        if (flags & OB_TCHARGE_MOL) mol->SetTotalCharge(totalCharge);
+        if (flags & OB_TSPIN_MOL) mol->SetTotalSpinMultiplicity(totalSpin);
+
+        mol->SetFlags(mol->GetFlags() | flags);
+    }
+    catch (const std::string&)
+    {
+        delete mol;
+        pthread_mutex_unlock(&Molecule::openbabel_lock);
+        throw;
+    }
+
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+    return mol;
+}
+
+// ****************************************************************************
+
+void MoleculeIO::WriteAtomT(BinaryWriter& out, const AtomT& type)
+{
+    out.Write<int>(type.atomType);
+    out.Write<int>(type.specificNum);
+    out.Write<int>(type.specialT);
+}
+
+// ****************************************************************************
+
+AtomT MoleculeIO::ReadAtomT(BinaryReader& in)
+{
+    AtomEnumT atomType = (AtomEnumT)in.Read<int>();
+    int specificNum = in.Read<int>();
+    SpecialEnumT specialT = (SpecialEnumT)in.Read<int>();
+
+    return AtomT(atomType, specificNum, specialT);
+}
+
+// ****************************************************************************
+
+void MoleculeIO::WriteAtom(BinaryWriter& out, const Atom& atom)
+{
+    out.Write<int>(atom.atomID);
+    WriteAtomT(out, AtomT::Interned(atom.atomType));
+    out.Write<int>(atom.ownerType);
+    out.Write<unsigned int>(atom.connectionID);
+    out.Write<unsigned int>(atom.graphNodeIndex.first);
+    out.Write<unsigned int>(atom.graphNodeIndex.second);
+    out.Write<unsigned char>(atom.canConnectToAnyAtom);
+    out.Write<int>(atom.maxConnect);
+    out.Write<int>(atom.numExternalConnections);
+
+    // Interned ids are per-process; the types themselves are written.
+    out.Write<unsigned int>(atom.allowableTypes.count());
+    for (unsigned int t = 0; t < AtomT::MAX_INTERNED; t++)
+    {
+        if (atom.allowableTypes.test(t)) WriteAtomT(out, AtomT::Interned(t));
+    }
+}
+
+// ****************************************************************************
+
+void MoleculeIO::ReadAtom(BinaryReader& in, Atom& atom)
+{
+    atom.atomID = in.Read<int>();
+    atom.atomType = AtomT::Intern(ReadAtomT(in));
+    atom.ownerType = (MoleculeT)in.Read<int>();
+    atom.connectionID = in.Read<unsigned int>();
+    atom.graphNodeIndex.first = in.Read<unsigned int>();
+    atom.graphNodeIndex.second = in.Read<unsigned int>();
+    atom.canConnectToAnyAtom = in.Read<unsigned char>() != 0;
+    atom.maxConnect = in.Read<int>();
+    atom.numExternalConnections = in.Read<int>();
+
+    atom.allowableTypes.reset();
+    unsigned int numTypes = in.Read<unsigned int>();
+    for (unsigned int t = 0; t < numTypes; t++)
+    {
+        atom.allowableTypes.set(AtomT::Intern(ReadAtomT(in)));
+    }
+}
+
+// ****************************************************************************
+
+void MoleculeIO::WriteFragment(BinaryWriter& out, const Molecule& fragment)
+{
+    out.Write<int>(fragment.type);
+    out.WriteString(fragment.name);
+
+    WriteOBMol(out, *fragment.obmol);
+    WriteLocal(out, fragment);
+
+    out.Write<unsigned char>(fragment.lipinskiPredicted);
+    out.Write<double>(fragment.MolWt);
+    out.Write<double>(fragment.HBD);
+    out.Write<double>(fragment.HBA1);
+    out.Write<double>(fragment.logP);
+}
+
+// ****************************************************************************
+
+Molecule* MoleculeIO::ReadFragment(BinaryReader& in)
+{
+    MoleculeT type = (MoleculeT)in.Read<int>();
+    if (type != LINKER && type != RIGID) throw std::string("MoleculeIO: expected a linker or rigid");
+
+    Molecule* fragment = 0;
+    if (type == LINKER) fragment = new Linker();
+    else fragment = new Rigid();
+
+    try
+    {
+        fragment->type = type;
+        fragment->name = in.ReadString();
+        fragment->obmol = ReadOBMol(in);
+        ReadLocal(in, *fragment);
+
+        for (unsigned int a = 0; a < fragment->atoms.size(); a++)
+        {
+            fragment->atoms[a].setOwnerMolecule(fragment);
+        }
+
+        fragment->lipinskiPredicted = in.Read<unsigned char>() != 0;
+        fragment->lipinskiEstimated = false;
+        fragment->MolWt = in.Read<double>();
+        fragment->HBD = in.Read<double>();
+        fragment->HBA1 = in.Read<double>();
+        fragment->logP = in.Read<double>();
+    }
+    catch (const std::string&)
+    {
+        delete fragment->obmol;
+        delete fragment;
+        throw;
+    }
+
+    return fragment;
+}
+
+// ****************************************************************************
+
+void MoleculeIO::WriteComplex(BinaryWriter& out, const Molecule& mol)
+{
+    out.Write<unsigned int>(mol.uniqueIndexID);
+
+    WriteOBMol(out, *mol.obmol);
+    WriteLocal(out, mol);
+
+    // The originating linker / rigid of each atom.
+    for (unsigned int a = 0; a < mol.atoms.size(); a++)
+    {
+        const Molecule* owner = mol.atoms[a].ownerFragment;
+        out.Write<int>(owner == 0 ? -1 : (int)owner->getUniqueIndexID());
+    }
+
+    out.Write<unsigned char>(mol.lipinskiPredicted);
+    out.Write<unsigned char>(mol.lipinskiEstimated);
+    out.Write<double>(mol.MolWt);
+    out.Write<double>(mol.HBD);
+    out.Write<double>(mol.HBA1);
+    out.Write<double>(mol.logP);
+}
+
+// ****************************************************************************
+
+Molecule* MoleculeIO::ReadComplex(BinaryReader& in)
+{
+    Molecule* mol = new Molecule();
+
+    try
+    {
+        mol->name = "complex";
+        mol->type = COMPLEX;
+        mol->uniqueIndexID = in.Read<unsigned int>();
+        mol->obmol = ReadOBMol(in);
+        ReadLocal(in, *mol);
+
+        for (unsigned int a = 0; a < mol->atoms.size(); a++)
+        {
+            int owner = in.Read<int>();
+
+            if (owner >= (int)Molecule::baseMolecules.size())
+            {
+                throw std::string("MoleculeIO: unexpected fragment index");
+            }
+
+            mol->atoms[a].setOwnerMolecule(owner < 0 ? 0 : Molecule::baseMolecules[owner]);
+        }
+
+        mol->lipinskiPredicted = in.Read<unsigned char>() != 0;
+        mol->lipinskiEstimated = in.Read<unsigned char>() != 0;
+        mol->MolWt = in.Read<double>();
+        mol->HBD = in.Read<double>();
+        mol->HBA1 = in.Read<double>();
+        mol->logP = in.Read<double>();
+    }
+    catch (const std::string&)
+    {
+        mol->ReleaseOpenBabelMol();
+        delete mol;
+        throw;
+    }
+
+    return mol;
+}
+
+// ****************************************************************************
+
+void MoleculeIO::WriteLocal(BinaryWriter& out, const Molecule& mol)
+{
+    out.Write<unsigned int>(mol.atoms.size());
+    for (unsigned int a = 0; a < mol.atoms.size(); a++)
+    {
+        WriteAtom(out, mol.atoms[a]);
+    }
+
+    out.Write<unsigned int>(mol.bonds.size());
+    for (unsigned int b = 0; b < mol.bonds.size(); b++)
+    {
+        out.Write<int>(mol.bonds[b].getBondID());
+        out.Write<int>(mol.bonds[b].getOriginAtomID());
+        out.Write<int>(mol.bonds[b].getTargetAtomID());
+    }
+}
+
+// ****************************************************************************
+
+void MoleculeIO::ReadLocal(BinaryReader& in, Molecule& mol)
+{
+    unsigned int numAtoms = in.Read<unsigned int>();
+    mol.atoms.reserve(numAtoms);
+    for (unsigned int a = 0; a < numAtoms; a++)
+    {
+        Atom atom(a, false);
+        ReadAtom(in, atom);
+
+        mol.atoms.push_back(atom);
+        mol.atomIdMaker.getNextId();
+    }
+
+    unsigned int numBonds = in.Read<unsigned int>();
+    mol.bonds.reserve(numBonds);
+    for (unsigned int b = 0; b < numBonds; b++)
+    {
+        int id = in.Read<int>();
+        int origin = in.Read<int>();
+        int target = in.Read<int>();
+
+        mol.bonds.push_back(Bond(id, origin, target));
+    }
+
+    mol.BuildAdjacency();
+}
+
+// ****************************************************************************
+
+void MoleculeIO::WriteNode(BinaryWriter& out, const Molecule& node)
+{
+    out.Write<unsigned int>(node.uniqueIndexID);
+
+    // Sparse fragment counts: (fragment index, count) pairs.
+    unsigned int numUsed = 0;
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        if (node.fragmentCounter[f] != 0) numUsed++;
+    }
+
+    out.Write<unsigned int>(numUsed);
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        if (node.fragmentCounter[f] != 0)
+        {
+            out.Write<unsigned int>(f);
+            out.Write<unsigned int>(node.fragmentCounter[f]);
+        }
+    }
+
+    out.Write<unsigned char>(node.fingerprint != 0);
+    if (node.fingerprint != 0) WriteFingerprint(out, *node.fingerprint);
+}
+
+// ****************************************************************************
+//
+// The node is compact: no atoms, bonds or Open Babel molecule.
+//
+void MoleculeIO::ReadNode(BinaryReader& in, Molecule& node)
+{
+    node.name = "complex";
+    node.type = COMPLEX;
+    node.uniqueIndexID = in.Read<unsigned int>();
+
+    node.initFragmentInfo();
+
+    unsigned int numUsed = in.Read<unsigned int>();
+    for (unsigned int u = 0; u < numUsed; u++)
+    {
+        unsigned int f = in.Read<unsigned int>();
+        unsigned int count = in.Read<unsigned int>();
+
+        if (f >= Molecule::NUM_UNIQUE_FRAGMENTS) throw std::string("MoleculeIO: unexpected fragment index");
+
+        node.fragmentCounter[f] = count;
+    }
+
+    node.calcFragmentInfo();
+    node.Compact();
+
+    if (in.Read<unsigned char>() != 0) node.fingerprint = ReadFingerprint(in);
+}
+
+// ****************************************************************************
+//
+// Nodes are written per fragment (in order), then the connections of each subnode
+// as (fragment, node position, subnode id) triples.
+//
+void MoleculeIO::WriteFingerprint(BinaryWriter& out, const FragmentGraph& graph)
+{
+    std::map<const FragmentGraphNode*, std::pair<unsigned int, unsigned int> > positions;
+
+    out.Write<unsigned int>(graph.numFragments);
+
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        out.Write<unsigned int>(graph.orderedNodes[f].size());
+
+        for (unsigned int n = 0; n < graph.orderedNodes[f].size(); n++)
+        {
+            out.Write<unsigned int>(graph.orderedNodes[f][n]->getNodeID());
+            positions[graph.orderedNodes[f][n]] = std::make_pair(f, n);
+        }
+    }
+
+    std::vector<FragmentSubNode*> conns;
+    for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+    {
+        for (unsigned int n = 0; n < graph.orderedNodes[f].size(); n++)
+        {
+            const std::vector<FragmentSubNode*>& subnodes = graph.orderedNodes[f][n]->getSubNodes();
+
+            for (unsigned int s = 0; s < subnodes.size(); s++)
+            {
+                subnodes[s]->getConnections(conns);
+
+                out.Write<unsigned int>(conns.size());
+                for (unsigned int c = 0; c < conns.size(); c++)
+                {
+                    std::map<const FragmentGraphNode*,
+                             std::pair<unsigned int, unsigned int> >::const_iterator pos;
+                    pos = positions.find(conns[c]->getParentNode());
+
+                    if (pos == positions.end())
+                    {
+                        throw std::string("MoleculeIO: fingerprint connection outside the graph");
+                    }
+
+                    out.Write<unsigned int>(pos->second.first);
+                    out.Write<unsigned int>(pos->second.second);
+                    out.Write<unsigned int>(conns[c]->getSubNodeID());
+                }
+            }
+        }
+    }
+}
+
+// ****************************************************************************
+
+FragmentGraph* MoleculeIO::ReadFingerprint(BinaryReader& in)
+{
+    FragmentGraph* graph = new FragmentGraph();
+
+    try
+    {
+        graph->numFragments = in.Read<unsigned int>();
+
+        for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+        {
+            unsigned int numNodes = in.Read<unsigned int>();
+
+            for (unsigned int n = 0; n < numNodes; n++)
+            {
+                unsigned int graphID = in.Read<unsigned int>();
+
+                graph->orderedNodes[f].push_back(new FragmentGraphNode(Molecule::baseMolecules[f],
+                                                                       graphID));
+            }
+        }
+
+        for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS; f++)
+        {
+            for (unsigned int n = 0; n < graph->orderedNodes[f].size(); n++)
+            {
+                const std::vector<FragmentSubNode*>& subnodes =
+                                                     graph->orderedNodes[f][n]->getSubNodes();
+
+                for (unsigned int s = 0; s < subnodes.size(); s++)
+                {
+                    unsigned int numConns = in.Read<unsigned int>();
+
+                    for (unsigned int c = 0; c < numConns; c++)
+                    {
+                        unsigned int toF = in.Read<unsigned int>();
+                        unsigned int toN = in.Read<unsigned int>();
+                        unsigned int toSub = in.Read<unsigned int>();
+
+                        if (toF >= Molecule::NUM_UNIQUE_FRAGMENTS ||
+                            toN >= graph->orderedNodes[toF].size())
+                        {
+                            throw std::string("MoleculeIO: unexpected fingerprint connection");
+                        }
+
+                        FragmentSubNode* target = graph->orderedNodes[toF][toN]->getSubNode(toSub);
+                        if (target == 0) throw std::string("MoleculeIO: unexpected fingerprint subnode");
+
+                        subnodes[s]->addConnection(target);
+                    }
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        delete graph;
+        throw;
+    }
+
+    return graph;
+}
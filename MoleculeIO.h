@@ -0,0 +1,59 @@
+#ifndef _MOLECULE_IO_GUARD
+#define _MOLECULE_IO_GUARD 1
+
+
+#include <openbabel/mol.h>
+
+
+#include "BinaryIO.h"
+#include "AtomT.h"
+
+
+class Atom;
+class Bond;
+class Molecule;
+class FragmentGraph;
+
+
+//
+// Binary (de)serialization of our molecular representation.
+// Open Babel access acquires Molecule::openbabel_lock; callers must not hold it.
+//
+class MoleculeIO
+{
+  public:
+    // Open Babel structure: title, dimension, atoms (element, charge, coordinates, spin,
+    // forced hydrogens) and bonds, with the perceived aromaticity, implicit valences,
+    // hybridization, atom types, partial and total charges.
+    static void WriteOBMol(BinaryWriter& out, OpenBabel::OBMol& mol);
+    static OpenBabel::OBMol* ReadOBMol(BinaryReader& in);
+
+    static void WriteAtomT(BinaryWriter& out, const AtomT& type);
+    static AtomT ReadAtomT(BinaryReader& in);
+
+    static void WriteAtom(BinaryWriter& out, const Atom& atom);
+    static void ReadAtom(BinaryReader& in, Atom& atom);
+
+    // A parsed linker / rigid: structure, appendix information and Lipinski values.
+    static void WriteFragment(BinaryWriter& out, const Molecule& fragment);
+    static Molecule* ReadFragment(BinaryReader& in);
+
+    // A synthesized molecule awaiting composition (level queue spill). The fragment
+    // counts and fingerprint are not written; they are shared with the hypergraph node.
+    static void WriteComplex(BinaryWriter& out, const Molecule& mol);
+    static Molecule* ReadComplex(BinaryReader& in);
+
+    // A hypergraph node: unique index, fragment counts and (if not retired) fingerprint.
+    static void WriteNode(BinaryWriter& out, const Molecule& node);
+    static void ReadNode(BinaryReader& in, Molecule& node);
+
+    static void WriteFingerprint(BinaryWriter& out, const FragmentGraph& graph);
+    static FragmentGraph* ReadFingerprint(BinaryReader& in);
+
+  private:
+    // Local atoms and bonds.
+    static void WriteLocal(BinaryWriter& out, const Molecule& mol);
+    static void ReadLocal(BinaryReader& in, Molecule& mol);
+};
+
+#endif
@@ -21,28 +21,34 @@
 #include "Utilities.h"
 #include "IdFactory.h"
 #include "Options.h"
+#include "Validator.h"
+#include "Instrumentation.h"
 
 
 // Static Definitions
 pthread_mutex_t OBWriter::valid_molecule_lock;
-pthread_mutex_t OBWriter::output_file_lock;
 pthread_mutex_t OBWriter::id_lock;
 IdFactory OBWriter::molIDmaker(1000);
-std::ofstream OBWriter::out;
-std::vector<OpenBabel::OBMol*> OBWriter::compliantMols;
+OutputFile OBWriter::out;
+AsyncWriter OBWriter::sdfWriter;
+std::string OBWriter::outFileName;
+FingerprintIndex OBWriter::fingerprints;
+Validator* OBWriter::validator = 0;
+std::map<unsigned int, unsigned long> OBWriter::outstanding;
+std::set<unsigned int> OBWriter::completeLevels;
+unsigned int OBWriter::releasedLevel = 0;
 
 // ****************************************************************************
 
 OBWriter::OBWriter(unsigned int threadCount) : mCounter(0),
                                                mFailCounter(0),
                                                writing_complete(false),
-                                               writing_started(false) 
+                                               writing_started(false)
 {
-    pthread_mutex_init(&output_file_lock, NULL);
     pthread_mutex_init(&id_lock, NULL);
 
     // Create the thread pool
-    pool = new Thread_Pool<std::string, int>(threadCount, OBWriter::OutputSingleMolecule);
+    pool = new Thread_Pool<OutputRequest, int>(threadCount, OBWriter::OutputSingleMolecule);
 }
 
 // ****************************************************************************
@@ -51,15 +57,106 @@ OBWriter::~OBWriter()
 {
     // Killing the thread pool to force all threads to join.
     delete pool;
+
+    sdfWriter.Stop();
+}
+
+// ****************************************************************************
+
+void OBWriter::InitializeFile(const std::string& outFile, bool resume)
+{
+    outFileName = outFile;
+
+    if (resume) return;
+
+    OpenFile(false);
+}
+
+// ****************************************************************************
+
+void OBWriter::OpenFile(bool append)
+{
+    out.Open(outFileName, append);
+
+    sdfWriter.Start(out, Options::ORDERED);
 }
 
 // ****************************************************************************
 
-void OBWriter::InitializeFile(const std::string& outFile)
+long long OBWriter::OutputOffset()
 {
-    out.open(outFile.c_str());
+    sdfWriter.Flush();
 
-    if (out.fail()) throw "Output stream opening failed.";
+    return out.Offset();
+}
+
+// ****************************************************************************
+//
+// Anything past the checkpointed offset was written after the checkpoint and
+// will be regenerated.
+//
+bool OBWriter::ResumeFile(long long offset,
+                          const std::vector<std::pair<AsyncWriter::Key, std::string> >& held)
+{
+    if (truncate(outFileName.c_str(), offset) != 0)
+    {
+        std::cerr << "Unable to truncate " << outFileName << " to the checkpoint." << std::endl;
+        return false;
+    }
+
+    //
+    // Reload the molecules already written (for validation).
+    //
+    OutputFileReader reader(outFileName);
+    std::istream in(&reader);
+
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
+
+    OpenBabel::OBConversion SDF_conv;
+    SDF_conv.SetInFormat("SDF");
+
+    std::vector<unsigned int> fp;
+    OpenBabel::OBMol mol;
+    while (SDF_conv.Read(&mol, &in))
+    {
+        FingerprintIndex::Compute(mol, fp);
+        unsigned int position = fingerprints.Add(fp, mol.GetTitle());
+        if (validator != 0) validator->Observe(fp, position, 0);
+
+        mol.Clear();
+    }
+
+    unsigned int numWritten = fingerprints.size();
+
+    // With -ordered, the molecules of levels not yet complete are held back.
+    for (unsigned int h = 0; h < held.size(); h++)
+    {
+        std::istringstream block(held[h].second);
+        if (SDF_conv.Read(&mol, &block))
+        {
+            FingerprintIndex::Compute(mol, fp);
+            unsigned int position = fingerprints.Add(fp, mol.GetTitle());
+            if (validator != 0) validator->Observe(fp, position, held[h].first.first);
+        }
+
+        mol.Clear();
+    }
+
+    pthread_mutex_unlock(&Molecule::openbabel_lock);
+
+    if (!reader.good() || reader.Failed())
+    {
+        std::cerr << "Unable to read back " << outFileName << " up to the checkpoint." << std::endl;
+        return false;
+    }
+
+    OpenFile(true);
+    sdfWriter.Hold(held);
+
+    std::cerr << "Resuming output to " << outFileName << " after "
+              << numWritten << " molecules." << std::endl;
+
+    return true;
 }
 
 // ****************************************************************************
@@ -67,7 +164,6 @@ void OBWriter::InitializeFile(const std::string& outFile)
 void OBWriter::Initialize()
 {
     pthread_mutex_init(&OBWriter::valid_molecule_lock, NULL);
-    pthread_mutex_init(&OBWriter::output_file_lock, NULL);
     pthread_mutex_init(&OBWriter::id_lock, NULL);
 }
 
@@ -83,7 +179,54 @@ void OBWriter::IndicateSynthesisComplete()
         // Sleep 5 seconds; obgen takes a while.
         sleep(5);
     }
-    std::cerr << "Writing of the molecules with obgen is complete." << std::endl;
+    sdfWriter.Flush();
+
+    if (sdfWriter.Failed())
+    {
+        std::cerr << "Writing " << outFileName << " failed; the output is incomplete." << std::endl;
+    }
+    else std::cerr << "Writing of the molecules with obgen is complete." << std::endl;
+    std::cerr << "Skipped " << written.NumDuplicates()
+              << " chemically identical molecules (canonical SMILES) before obgen." << std::endl;
+}
+
+// ****************************************************************************
+
+void OBWriter::LevelComplete(unsigned int level)
+{
+    pthread_mutex_lock(&OBWriter::id_lock);
+    completeLevels.insert(level);
+    ReleaseLevels();
+    pthread_mutex_unlock(&OBWriter::id_lock);
+}
+
+// ****************************************************************************
+//
+// Release the output of every complete level whose molecules (and those of each
+// lower level) have all reached sdfWriter; the caller holds id_lock.
+//
+void OBWriter::ReleaseLevels()
+{
+    unsigned int level = releasedLevel;
+    while (completeLevels.count(level + 1) > 0 && outstanding[level + 1] == 0) level++;
+
+    if (level == releasedLevel) return;
+
+    releasedLevel = level;
+    sdfWriter.Release(level);
+}
+
+// ****************************************************************************
+
+bool OBWriter::DrainOutput()
+{
+    while (writing_started && mCounter > pool->out_q_size())
+    {
+        sleep(1);
+    }
+    sdfWriter.Flush();
+
+    return !sdfWriter.Failed();
 }
 
 // ****************************************************************************
@@ -107,7 +250,7 @@ void OBWriter::OutputMolecule(Molecule& mol)
     // Process the molecule for output
     //
     // (1) Lock around open babel; this makes a copy with the copy constructor.
-    pthread_mutex_lock(&Molecule::openbabel_lock);  
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);  
     OpenBabel::OBMol theMol = *(mol.getOpenBabelMol());
 
     // The molecule must be Lipinski compliant (using Open Babel)
@@ -118,16 +261,57 @@ void OBWriter::OutputMolecule(Molecule& mol)
         pthread_mutex_unlock(&Molecule::openbabel_lock);
         return;
     }
-    else this->mCounter++;
 
     // (2) Export to SMI
     std::string smiMol = OBWriter::ScrubAndConvertToSMI(theMol);
+    std::string canonical = OBWriter::CanonicalSMI(theMol);
     pthread_mutex_unlock(&Molecule::openbabel_lock);
 
     //
-    // (3) Add the molecule to the queue for processing.
+    // With -ordered, obgen starts from the canonical SMILES, which is also the title,
+    // so the output does not depend on which of the identical molecules is kept.
+    //
+    if (Options::ORDERED) smiMol = canonical + "\t" + canonical + "\n";
+
+    //
+    // (3) Skip a molecule chemically identical to one already written.
+    //
+    if (!written.Insert(canonical)) return;
+
+    pthread_mutex_lock(&OBWriter::id_lock);
+    this->mCounter++;
+    outstanding[mol.size()]++;
+    unsigned long queued = this->mCounter - pool->out_q_size();
+    pthread_mutex_unlock(&OBWriter::id_lock);
+
+    Instrumentation::Max(Instrumentation::OUTPUT_QUEUE_MAX, queued);
+
+    //
+    // (4) Add the molecule to the queue for processing.
     //
-    pool->push(smiMol);
+    pool->push(OutputRequest(smiMol, mol.size(), canonical));
+}
+
+// ****************************************************************************
+//
+// Canonical SMILES (without the title) of mol; the caller holds the Open Babel lock.
+//
+std::string OBWriter::CanonicalSMI(OpenBabel::OBMol& mol)
+{
+    OpenBabel::OBConversion CAN_conv;
+
+    if (!CAN_conv.SetOutFormat("CAN")) throw "SetOutFormat failed!";
+
+    std::string smi = CAN_conv.WriteString(&mol);
+
+    return smi.substr(0, smi.find_first_of(" \t\r\n"));
+}
+
+// ****************************************************************************
+
+bool OBWriter::GoalReached()
+{
+    return Options::GOAL && validator != 0 && validator->AllRecovered();
 }
 
 // ****************************************************************************
@@ -135,14 +319,15 @@ void OBWriter::OutputMolecule(Molecule& mol)
 void OBWriter::Initialize()
 {
     pthread_mutex_init(&OBWriter::valid_molecule_lock, NULL);
-    pthread_mutex_init(&OBWriter::output_file_lock, NULL);
     pthread_mutex_init(&OBWriter::id_lock, NULL);
 }
 */
 // ****************************************************************************
 
-int OBWriter::OutputSingleMolecule(std::string smiMol)
+int OBWriter::OutputSingleMolecule(OutputRequest request)
 {
+    const std::string& smiMol = request.smi;
+
     //
     // Generate a unique identification number for this molecule.
     //
@@ -175,7 +360,11 @@ int OBWriter::OutputSingleMolecule(std::string smiMol)
     std::cerr << "Calling: " << obgenCall.str() << std::endl;
 
     // Spawn obgen process to work on the temp file.
-    system(obgenCall.str().c_str());
+    {
+        ScopedTimer timer(Instrumentation::OBGEN_NS, Instrumentation::OBGEN_NS_MAX);
+        system(obgenCall.str().c_str());
+    }
+    Instrumentation::Add(Instrumentation::OBGEN_CALLS);
 
     //
     // Convert to SDF and append to the final output file; maintain molecule for validation.
@@ -184,31 +373,46 @@ int OBWriter::OutputSingleMolecule(std::string smiMol)
     in.open(molFile.c_str());
 
     //
-    // We keep the SDF version of the synthesized molecule
+    // Only the fingerprint and title of the synthesized molecule are kept.
     //
     // Begin open babel usage
-    pthread_mutex_lock(&Molecule::openbabel_lock);
+    Instrumentation::Lock(&Molecule::openbabel_lock, Instrumentation::OPENBABEL_LOCK);
 
     OpenBabel::OBMol* mol = new OpenBabel::OBMol();
     OpenBabel::OBConversion SDF_conv;
     SDF_conv.SetInAndOutFormats("SDF", "SDF");
     SDF_conv.ReadFile(mol, molFile.c_str());
 
-    //
-    // Append output to a total output file.
-    //
-    pthread_mutex_lock(&output_file_lock);
-    OBWriter::out << SDF_conv.WriteString(mol);
-    pthread_mutex_unlock(&output_file_lock);
+    // Serialized here; the writer thread appends it to the output file.
+    std::string block = SDF_conv.WriteString(mol);
+
+    // The fingerprint is computed once here rather than on every validation.
+    std::vector<unsigned int> fp;
+    FingerprintIndex::Compute(*mol, fp);
+    std::string title = mol->GetTitle();
+
+    delete mol;
 
     // End open babel usage
     pthread_mutex_unlock(&Molecule::openbabel_lock);
 
-    // Save the valid molecule
+    // With -ordered every molecule must reach the writer (even with an empty block)
+    // before the output of its level is released.
+    sdfWriter.Push(AsyncWriter::Key(request.level, request.canonical), block);
+
+    pthread_mutex_lock(&OBWriter::id_lock);
+    outstanding[request.level]--;
+    ReleaseLevels();
+    pthread_mutex_unlock(&OBWriter::id_lock);
+
+    // Save the fingerprint of the valid molecule
     pthread_mutex_lock(& OBWriter::valid_molecule_lock);
-    OBWriter::compliantMols.push_back(mol);
+    unsigned int position = OBWriter::fingerprints.Add(fp, title);
     pthread_mutex_unlock(& OBWriter::valid_molecule_lock);
 
+    // Validation proceeds alongside synthesis, in this writer thread.
+    if (validator != 0) validator->Observe(fp, position, request.level);
+
     // Close the input file MOL file.
     in.close();
 
@@ -387,7 +591,8 @@ void OBWriter::write(std::vector<Molecule> molecules)
     CallsBeforeWriting(synthMolecules);
 
     // Converter to output the synthesized molecules
-    OpenBabel::OBConversion toSDF(&std::cin, &this->out);
+    std::ostringstream sdf;
+    OpenBabel::OBConversion toSDF(&std::cin, &sdf);
     toSDF.SetOutFormat("SDF");
 
     //
@@ -400,9 +605,9 @@ void OBWriter::write(std::vector<Molecule> molecules)
         //
         // Print the molecule number
         //
-        this->out << "#### ";
-        this->out << mCounter++;
-        this->out << " ####";
+        sdf << "#### ";
+        sdf << mCounter++;
+        sdf << " ####";
 
         //
         // Print the names of all the linkers / rigids.
@@ -414,12 +619,12 @@ void OBWriter::write(std::vector<Molecule> molecules)
 
         foreach_rigids(r_it, rigids)
         {
-            this->out << (*r_it)->getName() << std::endl;
+            sdf << (*r_it)->getName() << std::endl;
         }
 
         foreach_linkers(l_it, linkers)
         {
-            this->out << (*l_it)->getName() << std::endl;
+            sdf << (*l_it)->getName() << std::endl;
         }
         
         //
@@ -428,6 +633,8 @@ void OBWriter::write(std::vector<Molecule> molecules)
         OpenBabel::OBMol* obmol = it->getOpenBabelMol();
         toSDF.Write(obmol);
     }
+
+    sdfWriter.Push(AsyncWriter::Key(0, ""), sdf.str());
 }
 
 // ****************************************************************************
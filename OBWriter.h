@@ -6,6 +6,8 @@
 #include <string>
 #include <iostream>
 #include <queue>
+#include <map>
+#include <set>
 #include <pthread.h>
 
 
@@ -15,8 +17,29 @@
 #include "Molecule.h"
 #include "Thread_Pool.h"
 #include "IdFactory.h"
+#include "FingerprintIndex.h"
+#include "CanonicalSmilesSet.h"
+#include "AsyncWriter.h"
 
 
+class Validator;
+
+
+//
+// A molecule handed to the output thread pool: its SMILES, synthesis level and
+// canonical SMILES (which, with -ordered, place it in the output).
+//
+struct OutputRequest
+{
+    std::string smi;
+    unsigned int level;
+    std::string canonical;
+
+    OutputRequest() : level(0) {}
+    OutputRequest(const std::string& s, unsigned int lev, const std::string& can)
+        : smi(s), level(lev), canonical(can) {}
+};
+
 //
 // A class to dump all of the molecules to a file.
 //
@@ -28,35 +51,84 @@ class OBWriter
 
     // static void InitializeFile(const char* fileName);
     void OutputMolecule(Molecule&);
-    static int OutputSingleMolecule(std::string smiMol);
-    static std::vector<OpenBabel::OBMol*> compliantMols;
+    static int OutputSingleMolecule(OutputRequest request);
+    // Fingerprints (and titles) of the written molecules, computed as each is written.
+    static FingerprintIndex fingerprints;
+
+    // Each written molecule is observed by the validator (if any) as it is written.
+    static void SetValidator(Validator* v) { validator = v; }
+
+    // With -goal: every validation molecule has a match above -tc.
+    static bool GoalReached();
 
     void IndicateSynthesisComplete();
+
+    // Writing the output file failed; the output is incomplete.
+    static bool OutputFailed() { return sdfWriter.Failed(); }
+
+    // No more molecules of the given level will be output; with -ordered the output
+    // of each level is written once it and every lower level are complete.
+    void LevelComplete(unsigned int level);
     void InitiateOutputThreadPool();
 
-    static void InitializeFile(const std::string& outFile);
+    // With resume, the file is opened by ResumeFile once the checkpoint is read.
+    static void InitializeFile(const std::string& outFile, bool resume = false);
+
+    //
+    // Checkpoint support
+    //
+    // Wait until every molecule handed to the pool has been written; false if
+    // writing the output failed.
+    bool DrainOutput();
+    // Flushed size of the output file.
+    static long long OutputOffset();
+    // Truncate the output to the checkpointed size, reload the fingerprints of the
+    // molecules written so far (and of those held back by -ordered) and append from there.
+    static bool ResumeFile(long long offset,
+                           const std::vector<std::pair<AsyncWriter::Key, std::string> >& held);
 
     void write(std::vector<Molecule> molecules);
 
+    // Canonical SMILES (without the title) of mol; the caller holds the Open Babel lock.
+    static std::string CanonicalSMI(OpenBabel::OBMol& mol);
+
   private:
     unsigned int mCounter; 
     unsigned int mFailCounter; 
     bool writing_complete;
     bool writing_started;
 
-    static pthread_mutex_t output_file_lock;
     static pthread_mutex_t valid_molecule_lock;
     static pthread_mutex_t id_lock;
     static IdFactory molIDmaker;
-    static std::ofstream out;
-
-    Thread_Pool<std::string, int>* pool;  
+    // Compressed according to its extension (.gz / .zst).
+    static OutputFile out;
+    // The only writer of out: obgen threads hand it their SDF blocks.
+    static AsyncWriter sdfWriter;
+    static std::string outFileName;
+    static Validator* validator;
+
+    // Molecules handed to the pool and not yet passed to sdfWriter, per level; the
+    // levels complete; and the highest level whose output is released (under id_lock).
+    static std::map<unsigned int, unsigned long> outstanding;
+    static std::set<unsigned int> completeLevels;
+    static unsigned int releasedLevel;
+    static void ReleaseLevels();
+
+    Thread_Pool<OutputRequest, int>* pool;
+
+    // Canonical SMILES of the molecules handed to the pool; chemically identical
+    // molecules are not sent through obgen again.
+    CanonicalSmilesSet written;  
 
     void Initialize();
     static std::string ScrubAndConvertToSMI(OpenBabel::OBMol& mol);
+    static void OpenFile(bool append);
 
     void ScrubAndExportSMI(std::vector<Molecule>& molecules);
     void CallsBeforeWriting(std::vector<Molecule>& molecules);
+
+    friend class Checkpoint;
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
+#include <unistd.h>
 
 
 #include "Options.h"
@@ -12,15 +13,38 @@
 double Options::TANIMOTO = 0.95;
 bool Options::THREADED = false;
 unsigned int Options::OBGEN_THREAD_POOL_SIZE = 15;
+unsigned int Options::LOADER_THREAD_POOL_SIZE = 1;
+unsigned int Options::MEMORY_CAP_MB = 0;
+unsigned int Options::SPILL_THRESHOLD = 0;
+std::string Options::SPILL_DIRECTORY = ".";
+unsigned int Options::CHECKPOINT_INTERVAL = 0;
+std::string Options::CHECKPOINT_FILE = "";
+bool Options::RESUME = false;
+unsigned int Options::TOP_K = 1;
+bool Options::GOAL = false;
+bool Options::PRUNE = false;
+bool Options::ORDERED = false;
+unsigned int Options::STATS_INTERVAL = 0;
 
 Options::Options(int argCount, char** vals) : argc(argCount), argv(vals)
 {
     // Default values
     outFile = "molecules.sdf";
     validationFile = "";
+    cacheDirectory = "";
+    hyperGraphFile = "";
+    reachFragments = "";
+    queryFile = "";
+    keepFragments = "";
+    dropFragments = "";
+    statsFile = "";
 
     Options::TANIMOTO = 0.95;
     Options::THREADED = false;
+
+    // Fragment loading defaults to one thread per online core.
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    Options::LOADER_THREAD_POOL_SIZE = cores > 0 ? cores : 1;
 }
 
 bool Options::parseCommandLine()
@@ -55,6 +79,49 @@ bool Options::handleOption(int& index)
         validationFile = argv[++index];
         return true;
     }
+    if (strcmp(argv[index], "-cache") == 0)
+    {
+        cacheDirectory = argv[++index];
+        return true;
+    }
+    if (strcmp(argv[index], "-query") == 0)
+    {
+        queryFile = argv[++index];
+        return true;
+    }
+    if (strcmp(argv[index], "-keep") == 0)
+    {
+        keepFragments = argv[++index];
+        return true;
+    }
+    if (strcmp(argv[index], "-drop") == 0)
+    {
+        dropFragments = argv[++index];
+        return true;
+    }
+    if (strcmp(argv[index], "-reach") == 0)
+    {
+        reachFragments = argv[++index];
+        return true;
+    }
+    if (strncmp(argv[index], "-statsint", 9) == 0)
+    {
+        if (strcmp(argv[index], "-statsint") == 0)
+            STATS_INTERVAL = atoi(argv[++index]);
+        else
+            STATS_INTERVAL = atoi(&argv[index][9]);
+        return true;
+    }
+    if (strcmp(argv[index], "-stats") == 0)
+    {
+        statsFile = argv[++index];
+        return true;
+    }
+    if (strcmp(argv[index], "-hg") == 0)
+    {
+        hyperGraphFile = argv[++index];
+        return true;
+    }
     if (strncmp(argv[index], "-tc", 3) == 0)
     {
         // not directly following; e.g. -tc 0.95
@@ -117,12 +184,82 @@ bool Options::handleOption(int& index)
     }
     if (strncmp(argv[index], "-pool", 5) == 0)
     {
-        if (strcmp(argv[index], "-mw") == 0)
+        if (strcmp(argv[index], "-pool") == 0)
             OBGEN_THREAD_POOL_SIZE = atoi(argv[++index]);
         else
             OBGEN_THREAD_POOL_SIZE = atoi(&argv[index][5]);
         return true;
     }
+    if (strncmp(argv[index], "-load", 5) == 0)
+    {
+        if (strcmp(argv[index], "-load") == 0)
+            LOADER_THREAD_POOL_SIZE = atoi(argv[++index]);
+        else
+            LOADER_THREAD_POOL_SIZE = atoi(&argv[index][5]);
+        return true;
+    }
+    if (strcmp(argv[index], "-resume") == 0)
+    {
+        Options::RESUME = true;
+        return true;
+    }
+    if (strcmp(argv[index], "-ckptfile") == 0)
+    {
+        CHECKPOINT_FILE = argv[++index];
+        return true;
+    }
+    if (strncmp(argv[index], "-ckpt", 5) == 0)
+    {
+        if (strcmp(argv[index], "-ckpt") == 0)
+            CHECKPOINT_INTERVAL = atoi(argv[++index]);
+        else
+            CHECKPOINT_INTERVAL = atoi(&argv[index][5]);
+        return true;
+    }
+    if (strcmp(argv[index], "-spilldir") == 0)
+    {
+        SPILL_DIRECTORY = argv[++index];
+        return true;
+    }
+    if (strncmp(argv[index], "-spill", 6) == 0)
+    {
+        if (strcmp(argv[index], "-spill") == 0)
+            SPILL_THRESHOLD = atoi(argv[++index]);
+        else
+            SPILL_THRESHOLD = atoi(&argv[index][6]);
+        return true;
+    }
+    if (strcmp(argv[index], "-ordered") == 0)
+    {
+        Options::ORDERED = true;
+        return true;
+    }
+    if (strcmp(argv[index], "-prune") == 0)
+    {
+        Options::PRUNE = true;
+        return true;
+    }
+    if (strcmp(argv[index], "-goal") == 0)
+    {
+        Options::GOAL = true;
+        return true;
+    }
+    if (strncmp(argv[index], "-topk", 5) == 0)
+    {
+        if (strcmp(argv[index], "-topk") == 0)
+            TOP_K = atoi(argv[++index]);
+        else
+            TOP_K = atoi(&argv[index][5]);
+        return true;
+    }
+    if (strncmp(argv[index], "-memcap", 7) == 0)
+    {
+        if (strcmp(argv[index], "-memcap") == 0)
+            MEMORY_CAP_MB = atoi(argv[++index]);
+        else
+            MEMORY_CAP_MB = atoi(&argv[index][7]);
+        return true;
+    }
 
 /*
 
@@ -17,9 +17,57 @@ class Options
     std::string validationFile;
     std::vector<std::string> inFiles;
 
+    // Directory of the binary fragment-library cache; empty disables caching.
+    std::string cacheDirectory;
+
+    // Binary export of the synthesized hypergraph; empty disables the export.
+    std::string hyperGraphFile;
+
+    // Comma-separated linker / rigid names; report the molecules derivable from them.
+    std::string reachFragments;
+
+    // Subset query over a saved hypergraph instead of synthesis: the molecules using
+    // only the kept fragments (or none of the dropped ones); comma-separated names.
+    std::string queryFile;
+    std::string keepFragments;
+    std::string dropFragments;
+
+    // JSON dump of the instrumentation counters; empty disables instrumentation.
+    std::string statsFile;
+
     static double TANIMOTO;
     static bool THREADED;
     static unsigned int OBGEN_THREAD_POOL_SIZE;
+    static unsigned int LOADER_THREAD_POOL_SIZE;
+
+    // Resident memory cap (in MB) for bounded-memory synthesis; 0 is unbounded.
+    static unsigned int MEMORY_CAP_MB;
+
+    // Level queues spill to disk past this many molecules in memory; 0 never spills.
+    static unsigned int SPILL_THRESHOLD;
+    static std::string SPILL_DIRECTORY;
+
+    // Seconds between synthesis checkpoints; 0 disables checkpointing.
+    static unsigned int CHECKPOINT_INTERVAL;
+    // Checkpoint file; defaults to <output-file>.ckpt.
+    static std::string CHECKPOINT_FILE;
+    // Continue from the checkpoint file instead of starting over.
+    static bool RESUME;
+
+    // Number of most similar synthesized molecules reported per validation molecule.
+    static unsigned int TOP_K;
+
+    // Stop synthesis once every validation molecule has a match above -tc.
+    static bool GOAL;
+
+    // Only extend molecules that can grow into a validation target.
+    static bool PRUNE;
+
+    // Write molecules in the order they reach the output, not the order obgen finishes.
+    static bool ORDERED;
+
+    // Seconds between dumps of the statistics file; 0 writes it only at exit.
+    static unsigned int STATS_INTERVAL;
 
   private:
     int argc;
@@ -0,0 +1,300 @@
+#include <string>
+#include <cstdio>
+#include <sys/stat.h>
+
+
+#include <zlib.h>
+
+
+#include "OutputFile.h"
+
+
+// ****************************************************************************
+
+static bool EndsWith(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// ****************************************************************************
+
+OutputFile::Codec OutputFile::CodecFor(const std::string& fileName)
+{
+    if (EndsWith(fileName, ".gz")) return GZIP;
+    if (EndsWith(fileName, ".zst")) return ZSTD;
+
+    return PLAIN;
+}
+
+// ****************************************************************************
+
+OutputFile::OutputFile() : codec(PLAIN), dirty(false), file(0), gz(0)
+{
+#ifdef USE_ZSTD
+    zstd = 0;
+#endif
+}
+
+// ****************************************************************************
+
+OutputFile::~OutputFile()
+{
+    Close();
+}
+
+// ****************************************************************************
+
+void OutputFile::Open(const std::string& fileName, bool append)
+{
+    Close();
+
+    name = fileName;
+    codec = CodecFor(fileName);
+    dirty = false;
+
+    if (codec == GZIP)
+    {
+        OpenGzip(append);
+        return;
+    }
+
+#ifndef USE_ZSTD
+    if (codec == ZSTD) throw "zstd output (.zst) requires building with USE_ZSTD=1.";
+#endif
+
+    file = fopen(name.c_str(), append ? "ab" : "wb");
+
+    if (file == 0) throw "Output stream opening failed.";
+
+    setvbuf(file, 0, _IOFBF, BUFFER_SIZE);
+
+#ifdef USE_ZSTD
+    if (codec == ZSTD)
+    {
+        zstd = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(zstd, ZSTD_c_compressionLevel, ZSTD_LEVEL);
+        zstdOut.resize(ZSTD_CStreamOutSize());
+    }
+#endif
+}
+
+// ****************************************************************************
+//
+// A new gzip member; concatenated members read back as one stream.
+//
+void OutputFile::OpenGzip(bool append)
+{
+    char mode[8];
+    sprintf(mode, "%s%d", append ? "ab" : "wb", GZIP_LEVEL);
+
+    gz = gzopen(name.c_str(), mode);
+
+    if (gz == 0) throw "Output stream opening failed.";
+
+    gzbuffer(gz, BUFFER_SIZE);
+}
+
+// ****************************************************************************
+
+void OutputFile::Write(const char* data, unsigned long size)
+{
+    if (size == 0) return;
+
+    dirty = true;
+
+    if (codec == GZIP)
+    {
+        if (gzwrite(gz, data, size) != (int)size) throw "Writing the compressed output failed.";
+        return;
+    }
+
+#ifdef USE_ZSTD
+    if (codec == ZSTD)
+    {
+        ZstdCompress(data, size, ZSTD_e_continue);
+        return;
+    }
+#endif
+
+    if (fwrite(data, 1, size, file) != size) throw "Writing the output failed.";
+}
+
+// ****************************************************************************
+
+#ifdef USE_ZSTD
+void OutputFile::ZstdCompress(const char* data, unsigned long size, ZSTD_EndDirective mode)
+{
+    ZSTD_inBuffer input = { data, size, 0 };
+
+    bool finished = false;
+    while (!finished)
+    {
+        ZSTD_outBuffer output = { &zstdOut[0], zstdOut.size(), 0 };
+
+        size_t remaining = ZSTD_compressStream2(zstd, &output, &input, mode);
+
+        if (ZSTD_isError(remaining)) throw "Compressing the output failed.";
+
+        if (fwrite(output.dst, 1, output.pos, file) != output.pos) throw "Writing the output failed.";
+
+        finished = mode == ZSTD_e_continue ? input.pos == input.size : remaining == 0;
+    }
+}
+#endif
+
+// ****************************************************************************
+
+void OutputFile::Flush()
+{
+    if (codec == GZIP)
+    {
+        if (!dirty) return;
+
+        int closed = gzclose(gz);
+        gz = 0;
+        if (closed != Z_OK) throw "Writing the compressed output failed.";
+        OpenGzip(true);
+    }
+
+#ifdef USE_ZSTD
+    if (codec == ZSTD && dirty) ZstdCompress(0, 0, ZSTD_e_end);
+#endif
+
+    if (file != 0 && fflush(file) != 0) throw "Writing the output failed.";
+
+    dirty = false;
+}
+
+// ****************************************************************************
+
+void OutputFile::Close()
+{
+#ifdef USE_ZSTD
+    if (zstd != 0)
+    {
+        if (dirty) ZstdCompress(0, 0, ZSTD_e_end);
+        ZSTD_freeCCtx(zstd);
+        zstd = 0;
+    }
+#endif
+
+    if (gz != 0) gzclose(gz);
+    if (file != 0) fclose(file);
+
+    gz = 0;
+    file = 0;
+    dirty = false;
+}
+
+// ****************************************************************************
+
+long long OutputFile::Offset() const
+{
+    struct stat info;
+
+    if (stat(name.c_str(), &info) != 0) return 0;
+
+    return info.st_size;
+}
+
+// ****************************************************************************
+
+OutputFileReader::OutputFileReader(const std::string& fileName)
+    : codec(OutputFile::CodecFor(fileName)), failed(false), gz(0)
+{
+#ifdef USE_ZSTD
+    file = 0;
+    zstd = 0;
+    frameRemaining = 0;
+
+    if (codec == OutputFile::ZSTD)
+    {
+        file = fopen(fileName.c_str(), "rb");
+        zstd = ZSTD_createDCtx();
+        compressed.resize(ZSTD_DStreamInSize());
+        input.src = &compressed[0];
+        input.size = input.pos = 0;
+    }
+    else
+#endif
+    if (codec != OutputFile::ZSTD) gz = gzopen(fileName.c_str(), "rb");
+
+    setg(buffer, buffer, buffer);
+}
+
+// ****************************************************************************
+
+OutputFileReader::~OutputFileReader()
+{
+#ifdef USE_ZSTD
+    if (zstd != 0) ZSTD_freeDCtx(zstd);
+    if (file != 0) fclose(file);
+#endif
+
+    if (gz != 0) gzclose(gz);
+}
+
+// ****************************************************************************
+
+bool OutputFileReader::good() const
+{
+#ifdef USE_ZSTD
+    if (codec == OutputFile::ZSTD) return file != 0;
+#endif
+
+    return gz != 0;
+}
+
+// ****************************************************************************
+
+OutputFileReader::int_type OutputFileReader::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    long count = 0;
+
+#ifdef USE_ZSTD
+    if (codec == OutputFile::ZSTD && file != 0)
+    {
+        while (count == 0)
+        {
+            if (input.pos == input.size)
+            {
+                input.size = fread(&compressed[0], 1, compressed.size(), file);
+                input.pos = 0;
+                if (input.size == 0)
+                {
+                    if (ferror(file) || frameRemaining != 0) failed = true;
+                    break;
+                }
+            }
+
+            ZSTD_outBuffer output = { buffer, BUFFER_SIZE, 0 };
+            frameRemaining = ZSTD_decompressStream(zstd, &output, &input);
+            if (ZSTD_isError(frameRemaining))
+            {
+                failed = true;
+                break;
+            }
+            count = output.pos;
+        }
+    }
+#endif
+
+    if (gz != 0)
+    {
+        count = gzread(gz, buffer, BUFFER_SIZE);
+
+        // A truncated member reads as end of file with Z_BUF_ERROR.
+        int error = Z_OK;
+        if (count <= 0) gzerror(gz, &error);
+        if (count < 0 || (error != Z_OK && error != Z_STREAM_END)) failed = true;
+    }
+
+    if (count <= 0) return traits_type::eof();
+
+    setg(buffer, buffer, buffer + count);
+
+    return traits_type::to_int_type(*gptr());
+}
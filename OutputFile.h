@@ -0,0 +1,111 @@
+#ifndef _OUTPUT_FILE_GUARD
+#define _OUTPUT_FILE_GUARD 1
+
+
+#include <string>
+#include <streambuf>
+#include <cstdio>
+#include <zlib.h>
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+
+//
+// The synthesized-molecule output file, compressed on the fly according to its
+// extension: .gz (zlib) or .zst (zstd; requires building with USE_ZSTD=1); anything
+// else is written as is.
+//
+// Flush completes the current gzip member / zstd frame, so the file is readable up to
+// Offset() at any flush; resumed runs append further members / frames.
+//
+class OutputFile
+{
+  public:
+    enum Codec { PLAIN, GZIP, ZSTD };
+
+    static Codec CodecFor(const std::string& fileName);
+
+    OutputFile();
+    ~OutputFile();
+
+    // Throws if the file cannot be opened (or the codec is not built in).
+    void Open(const std::string& fileName, bool append);
+    void Write(const char* data, unsigned long size);
+    void Flush();
+    void Close();
+
+    // Size of the file on disk (after a Flush).
+    long long Offset() const;
+
+    Codec GetCodec() const { return codec; }
+
+  private:
+    std::string name;
+    Codec codec;
+
+    // Written since the last Flush (no empty members / frames).
+    bool dirty;
+
+    FILE* file;
+    gzFile gz;
+
+#ifdef USE_ZSTD
+    ZSTD_CCtx* zstd;
+    std::string zstdOut;
+
+    void ZstdCompress(const char* data, unsigned long size, ZSTD_EndDirective mode);
+#endif
+
+    static const unsigned int BUFFER_SIZE = 1 << 20;
+    static const int GZIP_LEVEL = 6;
+    static const int ZSTD_LEVEL = 3;
+
+    void OpenGzip(bool append);
+
+    OutputFile(const OutputFile&);
+    OutputFile& operator=(const OutputFile&);
+};
+
+//
+// Reads back the (decompressed) contents of an output file, e.g. with std::istream.
+//
+class OutputFileReader : public std::streambuf
+{
+  public:
+    OutputFileReader(const std::string& fileName);
+    ~OutputFileReader();
+
+    bool good() const;
+
+    // A read or decompression error (or a truncated member / frame) ended the stream.
+    bool Failed() const { return failed; }
+
+  protected:
+    int_type underflow();
+
+  private:
+    OutputFile::Codec codec;
+    bool failed;
+
+    // zlib reads plain files as is.
+    gzFile gz;
+
+#ifdef USE_ZSTD
+    FILE* file;
+    ZSTD_DCtx* zstd;
+    std::string compressed;
+    ZSTD_inBuffer input;
+    // 0 once the last frame read is complete.
+    size_t frameRemaining;
+#endif
+
+    static const unsigned int BUFFER_SIZE = 1 << 16;
+    char buffer[BUFFER_SIZE];
+
+    OutputFileReader(const OutputFileReader&);
+    OutputFileReader& operator=(const OutputFileReader&);
+};
+
+#endif
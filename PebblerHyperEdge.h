@@ -3,30 +3,27 @@
 
 #include <vector>
 #include <string>
+#include <sstream>
 #include <algorithm>
 
 #include "EdgeAnnotation.h"
 
+//
+// A hyperedge of the pebbling graph; the pebbles themselves are kept by the graph.
+//
 template<class A>
 class PebblerHyperEdge
 {
   public:
     std::vector<int> sourceNodes;
-    // parallel array to the sourceNodes; pebbles are boolean marks
-    std::vector<bool> pebbles;
     int targetNode;
     A annotation;
 
-    // Once completely pebbled, we mark as pebbled for memoizing purposes.
-    bool fullyPebbled;
-  
     PebblerHyperEdge(const std::vector<int>& src, int target, const A& annot);
     ~PebblerHyperEdge() {}
 
-    bool IsFullyPebbled() const;
     bool Equals(const PebblerHyperEdge<A>& thatEdge) const;
     std::string toString() const;
-    void ClearPebbles();
     int SourceIndex(int srcNode) const;
     
     template<class SA>
@@ -39,9 +36,6 @@ PebblerHyperEdge<A>::PebblerHyperEdge(const std::vector<int>& src, int target, c
    sourceNodes = src;
    targetNode = target;
    annotation = annot; 
-   // Ensure parallel array is large enough for marking.
-   pebbles.reserve(src.size());
-   fullyPebbled = false;
 }
 
 template<class A>
@@ -54,63 +48,37 @@ int PebblerHyperEdge<A>::SourceIndex(int srcNode) const
     return -1;
 }
 
-template<class A>
-void PebblerHyperEdge<A>::ClearPebbles()
-{
-    // memoized
-    fullyPebbled = false;
-    
-    pebbles.clear();
-    pebbles.reserve(sourceNodes.size());
-}
-
-template<class A>
-bool PebblerHyperEdge<A>::IsFullyPebbled() const
-{
-    // memoized
-    if (fullyPebbled) return true;
-
-    // calculate
-    if (std::find(pebbles.begin(), pebbles.end(), false) == pebbles.end()) return false;
-
-    // Mark
-    fullyPebbled = true;
-
-    return true;
-}
-
-// Ahe source nodes and target must be the same for equality.
+// The source nodes (as a multiset) and target must be the same for equality.
 template<class A>
 bool PebblerHyperEdge<A>::Equals(const PebblerHyperEdge<A>& thatEdge) const
 {
     if (targetNode != thatEdge.targetNode) return false;
 
-    if (this->sourceNodes.size() != thatEdge.sourcePebbles.size()) return false;
+    if (this->sourceNodes.size() != thatEdge.sourceNodes.size()) return false;
 
-    for (int s = 0; s < thatEdge.sourceNodes.size(); s++)
-    {
-        if (std::find(this->sourceNodes.begin(), this->sourceNodes.end(), thatEdge.sourceNodes[s]) == sourceNodes.end()) return false;
-    }
-    
-    return true;
+    std::vector<int> these = sourceNodes;
+    std::vector<int> those = thatEdge.sourceNodes;
+    std::sort(these.begin(), these.end());
+    std::sort(those.begin(), those.end());
+
+    return these == those;
 }
 
 template<class A>
 std::string PebblerHyperEdge<A>::toString() const
 {
-    std::string retS = "";
+    std::ostringstream oss;
 
-    retS += " { ";
+    oss << " { ";
 
     for (int n = 0; n < sourceNodes.size(); n++)
     {
-        retS += sourceNodes[n];
-        if (n+1 < sourceNodes.size()) retS += ", ";
+        oss << sourceNodes[n];
+        if (n+1 < sourceNodes.size()) oss << ", ";
     }
-    retS += " } -> ";
-    retS += targetNode;
+    oss << " } -> " << targetNode;
 
-    return retS;
+    return oss.str();
 }
 
 template<class SA>
@@ -121,4 +89,4 @@ std::ostream& operator<< (std::ostream& os, PebblerHyperEdge<SA>& edge)
     return os;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -2,7 +2,6 @@
 #define _PEBBLER_HYPER_GRAPH_GUARD 1
 
 #include <vector>
-#include <deque>
 #include <exception>
 #include <utility>
 #include <sstream>
@@ -10,34 +9,79 @@
 
 #include "PebblerHyperNode.h"
 #include "PebblerHyperEdge.h"
-#include "HyperEdgeMultiMap.h"
 #include "HyperNode.h"
 #include "HyperEdge.h"
 #include "Utilities.h"
 
 //
-// Integer-based representation of the main hypergraph
+// Integer-based representation of the main hypergraph, for reachability (pebbling).
+//
+// The hyperedges are kept in compressed rows: edge e has target edgeTargets[e] and
+// sources edgeSources[edgeSourceStart[e] .. edgeSourceStart[e + 1]); node v is a source
+// of edges outEdges[outEdgeStart[v] .. outEdgeStart[v + 1]) (once per occurrence, so a
+// molecule composed of two copies of v lists the edge twice).
 //
 template<class T, class A>
 class PebblerHyperGraph
 {
   private:
-    // The main graph data structure
     std::vector<PebblerHyperNode<T, A> > vertices;
-    HyperEdgeMultiMap<A> forwardEdges;
-    HyperEdgeMultiMap<A> backEdges;
+    std::vector<PebblerHyperEdge<A> > edges;
+
+    std::vector<int> edgeTargets;
+    std::vector<unsigned int> edgeSourceStart;
+    std::vector<unsigned int> edgeSources;
+    std::vector<unsigned int> outEdgeStart;
+    std::vector<unsigned int> outEdges;
+
+    // Pebbles: one bit per node / edge.
+    std::vector<unsigned long long> nodePebbles;
+    std::vector<unsigned long long> edgePebbles;
+    unsigned int numPebbledNodes;
+
+    // Sources of each edge not pebbled yet; the edge fires at zero.
+    std::vector<unsigned int> unpebbledSources;
+
+    // The edges that fired, in firing order (the derivations found by the last Pebble).
+    // Edges are unique by construction, so each fires once.
+    std::vector<unsigned int> firedEdges;
 
-    bool IsNodePebbled(int index) const { return vertices[index].pebbled; }    
-    void PebbleBackward(int numLinkerRigids);
-    void ForwardTraversal(HyperEdgeMultiMap<A>& edgeDatabase, const std::vector<int>& nodesToPebble);
-    void Pebble(const std::vector<int>& linkers, const std::vector<int>& rigids);
+    static bool TestBit(const std::vector<unsigned long long>& bits, int index)
+    {
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+    static void SetBit(std::vector<unsigned long long>& bits, int index)
+    {
+        bits[index >> 6] |= 1ULL << (index & 63);
+    }
 
   public:
-    PebblerHyperGraph() { }
-    PebblerHyperGraph(const std::vector<PebblerHyperNode<T, A> >& vs);
+    PebblerHyperGraph() : numPebbledNodes(0) { }
+    PebblerHyperGraph(const std::vector<PebblerHyperNode<T, A> >& vs,
+                      const std::vector<PebblerHyperEdge<A> >& es);
     ~PebblerHyperGraph() { }
     int size() const { return vertices.size(); }
-    
+    int NumEdges() const { return edges.size(); }
+
+    unsigned int GetNodeLevel(int index) const { return vertices[index].level; }
+    const PebblerHyperEdge<A>& GetEdge(int e) const { return edges[e]; }
+
+    //
+    // Dowling-Gallier pebbling: pebble the start nodes and every node derivable from
+    // them; an edge fires once all of its sources are pebbled. Linear in the size of
+    // the graph.
+    //
+    void Pebble(const std::vector<int>& startNodes);
+
+    bool IsNodePebbled(int index) const { return TestBit(nodePebbles, index); }
+    bool IsEdgePebbled(int e) const { return TestBit(edgePebbles, e); }
+    unsigned int NumPebbledNodes() const { return numPebbledNodes; }
+    void GetPebbledNodes(std::vector<int>& nodes) const;
+
+    // The pebbled edges (indices, in firing order) and those deriving the given node.
+    const std::vector<unsigned int>& GetPebbledEdges() const { return firedEdges; }
+    std::vector<PebblerHyperEdge<A> > GetPebbledEdges(int goalNodeIndex) const;
+
     template<class TS, class AS>
     friend std::ostream& operator<< (std::ostream& os, PebblerHyperGraph<TS, AS>& graph);
 
@@ -45,12 +89,45 @@ class PebblerHyperGraph
 };
 
 template<class T, class A>
-PebblerHyperGraph<T,A>::PebblerHyperGraph(const std::vector<PebblerHyperNode<T, A> >& vs)
+PebblerHyperGraph<T,A>::PebblerHyperGraph(const std::vector<PebblerHyperNode<T, A> >& vs,
+                                          const std::vector<PebblerHyperEdge<A> >& es)
+    : vertices(vs), edges(es), numPebbledNodes(0)
 {
-    for (int v = 0; v < vs.size(); v++)
+    //
+    // Edge rows
+    //
+    edgeSourceStart.push_back(0);
+    for (int e = 0; e < edges.size(); e++)
     {
-        vertices.push_back(vs[v]);
+        edgeTargets.push_back(edges[e].targetNode);
+        edgeSources.insert(edgeSources.end(), edges[e].sourceNodes.begin(), edges[e].sourceNodes.end());
+        edgeSourceStart.push_back(edgeSources.size());
     }
+
+    //
+    // Node rows (counting sort of the source occurrences)
+    //
+    outEdgeStart.assign(vertices.size() + 1, 0);
+    for (int e = 0; e < edges.size(); e++)
+    {
+        for (unsigned int s = edgeSourceStart[e]; s < edgeSourceStart[e + 1]; s++)
+        {
+            outEdgeStart[edgeSources[s] + 1]++;
+        }
+    }
+    for (int v = 0; v < vertices.size(); v++) outEdgeStart[v + 1] += outEdgeStart[v];
+
+    outEdges.resize(edgeSources.size());
+    std::vector<unsigned int> next(outEdgeStart.begin(), outEdgeStart.end() - 1);
+    for (int e = 0; e < edges.size(); e++)
+    {
+        for (unsigned int s = edgeSourceStart[e]; s < edgeSourceStart[e + 1]; s++)
+        {
+            outEdges[next[edgeSources[s]]++] = e;
+        }
+    }
+
+    ClearPebbles();
 }
 
 //
@@ -59,108 +136,79 @@ PebblerHyperGraph<T,A>::PebblerHyperGraph(const std::vector<PebblerHyperNode<T,
 template <class T, class A>
 void PebblerHyperGraph<T, A>::ClearPebbles()
 {
-    for (int v = 0; v < vertices.size(); v++)
+    nodePebbles.assign((vertices.size() + 63) / 64, 0);
+    edgePebbles.assign((edges.size() + 63) / 64, 0);
+    numPebbledNodes = 0;
+
+    unpebbledSources.resize(edges.size());
+    for (int e = 0; e < edges.size(); e++)
     {
-        vertices[v].ClearPebbles();
+        unpebbledSources[e] = edgeSourceStart[e + 1] - edgeSourceStart[e];
     }
+
+    firedEdges.clear();
 }
 
 template<class T, class A>
-std::ostream& operator<< (std::ostream& os, PebblerHyperGraph<T, A>& graph)
+void PebblerHyperGraph<T, A>::GetPebbledNodes(std::vector<int>& nodes) const
 {
-    os << "TBC";
-    
-    return os;
+    nodes.clear();
+
+    for (int v = 0; v < vertices.size(); v++)
+    {
+        if (IsNodePebbled(v)) nodes.push_back(v);
+    }
 }
 
-///////////////////////////////////////////////////////////////////////////////////
-//
-// Use Dowling-Gallier pebbling technique to pebble using all given nodes
-//
-// Pebbling requires TWO phases:
-//    1. Pebble in the forward direction any node which is reached once is RED.
-//       Any node reached twice is PURPLE and identifies a backward node (via an eventual backward edge)
-//       The result of this phase are:
-//           a. marked (RED) nodes and (RED) edges for forward analysis through the graph.
-//           b. marked (PURPLE) nodes (no edges).
-//    2. Using the purple nodes as a starting point, we pebble the graph in a backward direction.
-//       This is the same algorithm as pebbling forward (RED) edges, but this time we color the edges BLUE for backward.
-//       The result of this phase are:
-//           a. All applicable nodes marked BLUE or PURPLE.
-//           b. All applicable backward edges marked BLUE.
-//
 template<class T, class A>
-void PebblerHyperGraph<T, A>::Pebble(const std::vector<int>& linkers, const std::vector<int>& rigids)
+std::vector<PebblerHyperEdge<A> > PebblerHyperGraph<T, A>::GetPebbledEdges(int goalNodeIndex) const
 {
-    std::vector<int> nodesToPebble;
+    std::vector<PebblerHyperEdge<A> > goalEdges;
 
-    //
-    // Construct the list 
-    //
-    for (std::vector<int>::iterator it = linkers.begin(); it != linkers.end(); it++)
+    for (unsigned int f = 0; f < firedEdges.size(); f++)
     {
-        nodesToPebble.push_back(*it);
+        if (edgeTargets[firedEdges[f]] == goalNodeIndex) goalEdges.push_back(edges[firedEdges[f]]);
     }
 
-    for (std::vector<int>::iterator it = rigids.begin(); it != rigids.end(); it++)
+    return goalEdges;
+}
+
+template<class T, class A>
+std::ostream& operator<< (std::ostream& os, PebblerHyperGraph<T, A>& graph)
+{
+    for (int e = 0; e < graph.edges.size(); e++)
     {
-        nodesToPebble.push_back(*it);
+        os << (graph.IsEdgePebbled(e) ? "* " : "  ") << graph.edges[e].toString() << std::endl;
     }
-    
-    std::sort(nodesToPebble.begin(), nodesToPebble.end());
-
-
-    // Forward pebble: it acquires the valid list of forward edges 
-    ForwardTraversal(forwardEdges, nodesToPebble);
 
-    // Backward pebble: acquires the valid list of bakcward edges 
-    PebbleBackward(nodesToPebble.size());
+    return os;
 }
 
+///////////////////////////////////////////////////////////////////////////////////
 //
-// Pebble the graph in the backward direction using all pebbled nodes from the forward direction.
-// Note: we do so in a descending order (opposite the way we did from the forward direction); this attempts to 
+// Each node is pebbled (and leaves the worklist) once and each source occurrence of an
+// edge is counted down once, so pebbling is linear in the size of the graph.
 //
 template<class T, class A>
-void PebblerHyperGraph<T, A>::PebbleBackward(int numLinkerRigids)
+void PebblerHyperGraph<T, A>::Pebble(const std::vector<int>& startNodes)
 {
-    //
-    // Acquire all nodes which are to be pebbled (reachable during forward analysis)
-    //
-    std::vector<int> deducedNodesToPebbleBackward;
+    ClearPebbles();
+
+    std::vector<int> worklist;
 
-    // Avoid re-pebbling figure again so start after the figure
-    for (int v = vertices.size() - 1; v >= numLinkerRigids; v--)
+    for (std::vector<int>::const_iterator it = startNodes.begin(); it != startNodes.end(); it++)
     {
-        if (IsNodePebbled(v))
+        if (*it < 0 || *it >= vertices.size())
         {
-            deducedNodesToPebbleBackward.push_back(v);
+            throw MakeString("Unexpected node in pebbling: ", *it);
         }
-    }
-
-    // Clear all pebbles (nodes and edges)
-    ClearPebbles();
 
-    //
-    // Pebble the graph in the backward direction using all pebbled nodes from the forward direction.
-    // Note: we do so in a descending order (opposite the way we did from the forward direction)
-    // We create an ascending list and will pull from the back of the list
-    //
-    ForwardTraversal(backEdges, deducedNodesToPebbleBackward);
-}
-
-//
-// Given a node, pebble the reachable parts of the graph (in the forward direction)
-// We pebble in a breadth first manner
-//
-template <class T, class A>
-void PebblerHyperGraph<T, A>::ForwardTraversal(HyperEdgeMultiMap<A>& edgeDatabase, const std::vector<int>& nodesToPebble)
-{
-    std::deque<int> worklist;
-    
-    for (std::vector<int>::iterator it = nodesToPebble.begin(); it != nodesToPebble.end(); it++)
-    {
-        worklist.push_back(*it);
+        if (!IsNodePebbled(*it))
+        {
+            SetBit(nodePebbles, *it);
+            numPebbledNodes++;
+            worklist.push_back(*it);
+        }
     }
 
     //
@@ -168,44 +216,29 @@ void PebblerHyperGraph<T, A>::ForwardTraversal(HyperEdgeMultiMap<A>& edgeDatabas
     //
     while (!worklist.empty())
     {
-        // Acquire the next value to consider
-        int currentNodeIndex = worklist.front();
-        worklist.pop_front();
-
-        // Pebble the current node as a forward node and percolate forward
-        vertices[currentNodeIndex].pebble = true;
+        int currentNodeIndex = worklist.back();
+        worklist.pop_back();
 
         // For all hyperedges leaving this node, mark a pebble along the arc
-        for (int e = 0; e < vertices[currentNodeIndex].edges.size(); e++)
+        for (unsigned int o = outEdgeStart[currentNodeIndex]; o < outEdgeStart[currentNodeIndex + 1]; o++)
         {
-            PebblerHyperEdge<A> currentEdge = vertices[currentNodeIndex].edges[e];
+            unsigned int e = outEdges[o];
+
+            if (--unpebbledSources[e] != 0) continue;
+
+            // The edge is fully pebbled: a derivation of its target.
+            SetBit(edgePebbles, e);
+            firedEdges.push_back(e);
 
-            if (!currentEdge.IsFullyPebbled())
+            int target = edgeTargets[e];
+            if (!IsNodePebbled(target))
             {
-                // Indicate the node has been pebbled by adding to the list of pebbled vertices; should not have to be a unique addition
-                currentEdge.sourcePebbles[currentEdge.SourceIndex(currentNodeIndex)] = true;
-
-                // With this new node, check if the edge is full pebbled; if so, percolate
-                if (currentEdge.IsFullyPebbled())
-                {
-                    // Has the target of this edge been pebbled previously? Pebbled -> Pebbled means we have a backward edge
-                    if (!IsNodePebbled(currentEdge.targetNode))
-                    {
-                        // Success, we have a forward edge
-                        // Construct a static set of pebbled hyperedges for problem construction
-                        edgeDatabase.Put(currentEdge);
-
-                        // Add this node to the worklist to percolate further
-                        if (!Contains(worklist, currentEdge.targetNode))
-                        {
-                            worklist.push_back(currentEdge.targetNode);
-                            std::sort(worklist.begin(), worklist.end());
-                        }
-                    }
-                }
+                SetBit(nodePebbles, target);
+                numPebbledNodes++;
+                worklist.push_back(target);
             }
         }
     }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -6,56 +6,27 @@
 
 #include "PebblerHyperEdge.h"
 
+//
+// A node of the pebbling graph; its hyperedges and pebbles are kept by the graph.
+// The original node is not copied; only its index and level (size) are kept.
+//
 template<class T, class A>
 class PebblerHyperNode
 {
   public:
-    T data; // Original Hypergraph representation
-    int id; // index of original hypergraph node
-    std::vector<PebblerHyperEdge<A> > edges;
-    bool pebbled;
+    int id;             // index of original hypergraph node
+    unsigned int level; // size of the original node's data
 
-    PebblerHyperNode() {}
+    PebblerHyperNode() : id(-1), level(0) {}
     ~PebblerHyperNode() {}
-    PebblerHyperNode(const T& d, int i)
-    {
-        data = d;
-        id = i;
-        pebbled = false;
-    }
-    
-    void ClearPebbles();
-    void AddEdge(const PebblerHyperEdge<A>& edge) { edges.push_back(edge); }
-    void AddEdge(const std::vector<int> src, int target, T annotation)
-    {
-        AddEdge(PebblerHyperEdge<A>(src, target, annotation));
-    }
+    PebblerHyperNode(int i, unsigned int lev) : id(i), level(lev) {}
 };
 
-template<class T, class A>
-void PebblerHyperNode<T, A>::ClearPebbles()
-{
-    pebbled = false;
-    
-    for (int e = 0; e < edges.size(); e++)
-    {
-        edges[e].ClearPebbles();
-    }
-}  
-
 template<class T, class A>
 std::ostream& operator<< (std::ostream& os, PebblerHyperNode<T, A>& node)
 {
-    os << node.data.toString() << + "\t\t\t\t= { ";
-
-    os << node.id + " = { ";
-    for (int e = 0; e < node.edges.size(); e++)
-    {
-        os << node.edges[e];
-        if (e+1 < node.edges.size()) os << ", ";
-    }
-    os << " }" << std::endl;
+    os << node.id << ": level " << node.level << std::endl;
     
     return os;
 }
-#endif
\ No newline at end of file
+#endif
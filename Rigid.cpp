@@ -47,7 +47,7 @@ void Rigid::parseAppendix(std::string& suffix)
     {
         suffStream >> atomType;
 
-        this->atoms[x].setAtomType(* new AtomT(atomType));
+        this->atoms[x].setAtomTypeId(AtomT::Intern(atomType));
         this->atoms[x].setOwnerMoleculeType(RIGID);
     }
 
@@ -76,7 +76,7 @@ void Rigid::parseAppendix(std::string& suffix)
             suffStream >> atomType;
 
             this->atoms[atomId - 1].setMaxConnect(1);
-            this->atoms[atomId - 1].addConnectionType(* new AtomT(atomType));
+            this->atoms[atomId - 1].addConnectionTypeId(AtomT::Intern(atomType));
 
             eatWhiteToNewLineOrChar(suffStream);
         }
@@ -46,6 +46,18 @@ void RigidFragmentSubNode::addConnection(FragmentSubNode* connector)
 
 // ************************************************************************************
 
+void RigidFragmentSubNode::remapConnections(const std::map<const FragmentSubNode*,
+                                                           FragmentSubNode*>& remap)
+{
+    if (connection == 0) return;
+
+    std::map<const FragmentSubNode*, FragmentSubNode*>::const_iterator found = remap.find(connection);
+
+    if (found != remap.end()) connection = found->second;
+}
+
+// ************************************************************************************
+
 bool RigidFragmentSubNode::IsIsomorphicTo(FragmentSubNode* that)
 {
     if (this->uniqueSubnodeID != that->getSubNodeID()) return false;
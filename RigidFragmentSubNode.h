@@ -17,6 +17,12 @@ class RigidFragmentSubNode : public FragmentSubNode
     FragmentSubNode* copy() const;
 
     void addConnection(FragmentSubNode* connector);
+    void remapConnections(const std::map<const FragmentSubNode*, FragmentSubNode*>& remap);
+    void getConnections(std::vector<FragmentSubNode*>& conns) const
+    {
+        conns.clear();
+        if (connection != 0) conns.push_back(connection);
+    }
 
     unsigned int degree() { return connection == 0 ? 0 : 1; }
 
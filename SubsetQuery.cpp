@@ -0,0 +1,112 @@
+#include <vector>
+#include <string>
+#include <cstring>
+
+
+#include "SubsetQuery.h"
+#include "HyperGraphFile.h"
+
+
+// ****************************************************************************
+
+SubsetQuery::SubsetQuery(const HyperGraphFile& g) : graph(g),
+                                                   numFragments(g.NumFragments()),
+                                                   numNodes(g.NumNodes())
+{
+    wordsPerNode = (numFragments + 63) / 64;
+
+    fragmentBits.assign((unsigned long long)numNodes * wordsPerNode, 0);
+    usingStart.assign(numFragments + 1, 0);
+
+    for (unsigned int n = 0; n < numNodes; n++)
+    {
+        const HyperGraphFile::Node& node = graph.GetNode(n);
+        const HyperGraphFile::FragmentCount* counts = graph.Counts(node);
+
+        for (unsigned int c = 0; c < node.numCounts; c++)
+        {
+            unsigned int f = counts[c].fragment;
+            if (f >= numFragments) throw std::string("SubsetQuery: unexpected fragment index");
+
+            fragmentBits[n * wordsPerNode + f / 64] |= 1ULL << (f % 64);
+            usingStart[f + 1]++;
+        }
+    }
+
+    for (unsigned int f = 0; f < numFragments; f++) usingStart[f + 1] += usingStart[f];
+
+    nodesUsing.resize(usingStart[numFragments]);
+    std::vector<unsigned int> next(usingStart.begin(), usingStart.end() - 1);
+
+    for (unsigned int n = 0; n < numNodes; n++)
+    {
+        const HyperGraphFile::Node& node = graph.GetNode(n);
+        const HyperGraphFile::FragmentCount* counts = graph.Counts(node);
+
+        for (unsigned int c = 0; c < node.numCounts; c++)
+        {
+            nodesUsing[next[counts[c].fragment]++] = n;
+        }
+    }
+}
+
+// ****************************************************************************
+
+int SubsetQuery::FindFragment(const std::string& name) const
+{
+    for (unsigned int f = 0; f < numFragments; f++)
+    {
+        if (name == graph.String(graph.GetFragment(f).name)) return f;
+    }
+
+    return -1;
+}
+
+// ****************************************************************************
+//
+// Excluding through the inverted lists touches only the nodes using a dropped fragment;
+// the bitset scan touches every node once. The cheaper of the two is used.
+//
+void SubsetQuery::Query(const std::vector<bool>& allowed, std::vector<bool>& survivors) const
+{
+    unsigned long long droppedUses = 0;
+    for (unsigned int f = 0; f < numFragments; f++)
+    {
+        if (!allowed[f]) droppedUses += usingStart[f + 1] - usingStart[f];
+    }
+
+    if (droppedUses <= (unsigned long long)numNodes * wordsPerNode)
+    {
+        survivors.assign(numNodes, true);
+
+        for (unsigned int f = 0; f < numFragments; f++)
+        {
+            if (allowed[f]) continue;
+
+            for (unsigned int u = usingStart[f]; u < usingStart[f + 1]; u++)
+            {
+                survivors[nodesUsing[u]] = false;
+            }
+        }
+
+        return;
+    }
+
+    std::vector<unsigned long long> dropped(wordsPerNode, 0);
+    for (unsigned int f = 0; f < numFragments; f++)
+    {
+        if (!allowed[f]) dropped[f / 64] |= 1ULL << (f % 64);
+    }
+
+    survivors.assign(numNodes, false);
+
+    for (unsigned int n = 0; n < numNodes; n++)
+    {
+        const unsigned long long* bits = &fragmentBits[(unsigned long long)n * wordsPerNode];
+
+        unsigned long long conflict = 0;
+        for (unsigned int w = 0; w < wordsPerNode; w++) conflict |= bits[w] & dropped[w];
+
+        survivors[n] = conflict == 0;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef _SUBSET_QUERY_GUARD
+#define _SUBSET_QUERY_GUARD 1
+
+
+#include <vector>
+#include <string>
+
+
+#include "HyperGraphFile.h"
+
+
+//
+// Which synthesized molecules use only fragments of a subset S of the linkers / rigids?
+// (-query <hypergraph-file> with -keep or -drop; the file is written by -hg.)
+//
+// Each node of the saved hypergraph has a bitset of the fragments it uses and each
+// fragment an inverted list of the nodes using it. A query excludes the nodes on the
+// lists of the fragments outside S or, when those lists are long, tests each node's
+// bitset against S directly; either way no synthesis is rerun.
+//
+class SubsetQuery
+{
+  public:
+    SubsetQuery(const HyperGraphFile& graph);
+
+    unsigned int NumFragments() const { return numFragments; }
+
+    // Index of the fragment with the given name, or -1.
+    int FindFragment(const std::string& name) const;
+
+    // Nodes whose fragments all belong to the allowed set (allowed[f] for each fragment).
+    void Query(const std::vector<bool>& allowed, std::vector<bool>& survivors) const;
+
+  private:
+    const HyperGraphFile& graph;
+    unsigned int numFragments;
+    unsigned int numNodes;
+    unsigned int wordsPerNode;
+
+    // Fragment bitsets: node n owns fragmentBits[n * wordsPerNode .. (n + 1) * wordsPerNode).
+    std::vector<unsigned long long> fragmentBits;
+
+    // Inverted lists: fragment f is used by nodesUsing[usingStart[f] .. usingStart[f + 1]).
+    std::vector<unsigned int> usingStart;
+    std::vector<unsigned int> nodesUsing;
+};
+
+#endif
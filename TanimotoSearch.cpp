@@ -0,0 +1,283 @@
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+
+#include "TanimotoSearch.h"
+
+
+// ****************************************************************************
+//
+// Popcount kernels: |A & B| over a number of 512-bit (8-word) blocks.
+//
+
+static unsigned int AndCountScalar(const unsigned long long* a,
+                                   const unsigned long long* b,
+                                   unsigned int blocks)
+{
+    unsigned int count = 0;
+
+    for (unsigned int w = 0; w < blocks * FingerprintIndex::BLOCK_WORDS; w++)
+    {
+        count += __builtin_popcountll(a[w] & b[w]);
+    }
+
+    return count;
+}
+
+//
+// AVX2 has no vector popcount; count the nibbles with a shuffle lookup
+// and sum the bytes with sad (Mula et al.).
+//
+__attribute__((target("avx2")))
+static unsigned int AndCountAVX2(const unsigned long long* a,
+                                 const unsigned long long* b,
+                                 unsigned int blocks)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+
+    __m256i total = _mm256_setzero_si256();
+
+    for (unsigned int w = 0; w < blocks * FingerprintIndex::BLOCK_WORDS; w += 4)
+    {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a + w)),
+                                     _mm256_loadu_si256((const __m256i*)(b + w)));
+
+        __m256i counts = _mm256_add_epi8(
+            _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low)),
+            _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+    }
+
+    return _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+           _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static unsigned int AndCountAVX512(const unsigned long long* a,
+                                   const unsigned long long* b,
+                                   unsigned int blocks)
+{
+    __m512i total = _mm512_setzero_si512();
+
+    for (unsigned int w = 0; w < blocks * FingerprintIndex::BLOCK_WORDS; w += 8)
+    {
+        __m512i v = _mm512_and_si512(_mm512_loadu_si512((const void*)(a + w)),
+                                     _mm512_loadu_si512((const void*)(b + w)));
+
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+    }
+
+    return _mm512_reduce_add_epi64(total);
+}
+
+// ****************************************************************************
+
+TanimotoSearch::AndCountKernel TanimotoSearch::kernel = TanimotoSearch::SelectKernel();
+
+TanimotoSearch::AndCountKernel TanimotoSearch::SelectKernel()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512vpopcntdq")) return AndCountAVX512;
+    if (__builtin_cpu_supports("avx2")) return AndCountAVX2;
+
+    return AndCountScalar;
+}
+
+const char* TanimotoSearch::KernelName()
+{
+    if (kernel == AndCountAVX512) return "AVX-512 VPOPCNTDQ";
+    if (kernel == AndCountAVX2) return "AVX2";
+
+    return "scalar";
+}
+
+// ****************************************************************************
+
+TanimotoSearch::TanimotoSearch(const FingerprintIndex& idx) : index(idx)
+{
+    stride = index.Stride();
+
+    //
+    // Counting sort of the index by popcount.
+    //
+    unsigned int maxCount = stride * 64;
+    bucketStart.assign(maxCount + 2, 0);
+
+    for (unsigned int i = 0; i < index.size(); i++) bucketStart[index.PopCount(i) + 1]++;
+    for (unsigned int c = 1; c < bucketStart.size(); c++) bucketStart[c] += bucketStart[c - 1];
+
+    std::vector<unsigned int> next(bucketStart.begin(), bucketStart.end() - 1);
+
+    order.resize(index.size());
+    for (unsigned int i = 0; i < index.size(); i++) order[next[index.PopCount(i)]++] = i;
+
+    //
+    // Contiguous copy in bucket order so each bucket is scanned sequentially.
+    //
+    sorted.resize((unsigned long)index.size() * stride);
+    for (unsigned int s = 0; s < order.size(); s++)
+    {
+        std::copy(index.Fingerprint(order[s]), index.Fingerprint(order[s]) + stride,
+                  &sorted[(unsigned long)s * stride]);
+    }
+}
+
+// ****************************************************************************
+
+// Orders a heap so its top is the weakest of the current top-k hits.
+struct WeakerHit
+{
+    bool operator()(const TanimotoSearch::Hit& lhs, const TanimotoSearch::Hit& rhs) const
+    {
+        if (lhs.tanimoto != rhs.tanimoto) return lhs.tanimoto > rhs.tanimoto;
+        return lhs.index < rhs.index;
+    }
+};
+
+// Orders queries by popcount so a batch covers a narrow range of buckets.
+struct QueryByCount
+{
+    const std::vector<unsigned int>& counts;
+
+    QueryByCount(const std::vector<unsigned int>& c) : counts(c) {}
+
+    bool operator()(unsigned int lhs, unsigned int rhs) const { return counts[lhs] < counts[rhs]; }
+};
+
+//
+// Swamidass-Baldi: Tanimoto(A, B) <= min(|A|, |B|) / max(|A|, |B|).
+//
+static double PopCountBound(unsigned int a, unsigned int b)
+{
+    if (a == 0 && b == 0) return 0.0;
+
+    return a < b ? (double)a / b : (double)b / a;
+}
+
+void TanimotoSearch::Search(const std::vector<std::vector<unsigned int> >& queries,
+                            unsigned int k,
+                            std::vector<std::vector<Hit> >& results,
+                            double threshold) const
+{
+    results.clear();
+    results.resize(queries.size());
+
+    if (k == 0 || index.size() == 0) return;
+
+    const unsigned int blocks = stride / FingerprintIndex::BLOCK_WORDS;
+    const unsigned int maxCount = bucketStart.size() - 2;
+
+    //
+    // Popcount of each query; queries of the wrong width receive no hits.
+    //
+    std::vector<unsigned int> counts(queries.size(), 0);
+    std::vector<unsigned int> pending;
+    for (unsigned int q = 0; q < queries.size(); q++)
+    {
+        if (queries[q].size() != index.WordsPerFingerprint()) continue;
+
+        for (unsigned int w = 0; w < queries[q].size(); w++)
+        {
+            counts[q] += __builtin_popcount(queries[q][w]);
+        }
+        pending.push_back(q);
+    }
+
+    std::sort(pending.begin(), pending.end(), QueryByCount(counts));
+
+    std::vector<unsigned long long> packed(QUERY_BATCH * stride);
+    std::vector<unsigned int> lowBucket(QUERY_BATCH);
+    std::vector<unsigned int> highBucket(QUERY_BATCH);
+
+    typedef std::priority_queue<Hit, std::vector<Hit>, WeakerHit> TopK;
+    std::vector<TopK> best(QUERY_BATCH);
+
+    for (unsigned int first = 0; first < pending.size(); first += QUERY_BATCH)
+    {
+        unsigned int batchSize = std::min((unsigned int)pending.size() - first, QUERY_BATCH);
+
+        //
+        // Pack the batch of queries along with the popcount buckets that can reach the threshold:
+        //    |B| in [t |A|, |A| / t]
+        //
+        unsigned int low = maxCount;
+        unsigned int high = 0;
+        for (unsigned int slot = 0; slot < batchSize; slot++)
+        {
+            unsigned int q = pending[first + slot];
+            unsigned int a = counts[q];
+
+            FingerprintIndex::Pack(queries[q], stride, &packed[slot * stride]);
+            best[slot] = TopK();
+
+            lowBucket[slot] = (unsigned int)std::ceil(threshold * a);
+            highBucket[slot] = threshold > 0 ? std::min(maxCount, (unsigned int)std::floor(a / threshold))
+                                             : maxCount;
+
+            low = std::min(low, lowBucket[slot]);
+            high = std::max(high, highBucket[slot]);
+        }
+
+        //
+        // Compare the batch against each reachable bucket, one cache-sized tile at a time.
+        //
+        for (unsigned int b = low; b <= high; b++)
+        {
+            for (unsigned int tile = bucketStart[b]; tile < bucketStart[b + 1]; tile += TILE_SIZE)
+            {
+                unsigned int tileEnd = std::min(bucketStart[b + 1], tile + TILE_SIZE);
+
+                for (unsigned int slot = 0; slot < batchSize; slot++)
+                {
+                    if (b < lowBucket[slot] || b > highBucket[slot]) continue;
+
+                    TopK& top = best[slot];
+                    unsigned int a = counts[pending[first + slot]];
+
+                    // No entry of this bucket can displace the current top-k.
+                    if (top.size() == k && PopCountBound(a, b) <= top.top().tanimoto) continue;
+
+                    const unsigned long long* query = &packed[slot * stride];
+
+                    for (unsigned int s = tile; s < tileEnd; s++)
+                    {
+                        unsigned int andBits = kernel(query, &sorted[(unsigned long)s * stride], blocks);
+                        unsigned int orBits = a + b - andBits;
+
+                        double tanimoto = orBits == 0 ? 0.0 : (double)andBits / (double)orBits;
+
+                        if (top.size() < k) top.push(Hit(tanimoto, order[s]));
+                        else if (tanimoto > top.top().tanimoto)
+                        {
+                            top.pop();
+                            top.push(Hit(tanimoto, order[s]));
+                        }
+                    }
+                }
+            }
+        }
+
+        //
+        // Report best first.
+        //
+        for (unsigned int slot = 0; slot < batchSize; slot++)
+        {
+            std::vector<Hit>& hits = results[pending[first + slot]];
+
+            hits.resize(best[slot].size());
+            for (int h = hits.size() - 1; h >= 0; h--)
+            {
+                hits[h] = best[slot].top();
+                best[slot].pop();
+            }
+        }
+    }
+}
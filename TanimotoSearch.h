@@ -0,0 +1,83 @@
+#ifndef _TANIMOTO_SEARCH_GUARD
+#define _TANIMOTO_SEARCH_GUARD 1
+
+
+#include <vector>
+
+
+#include "FingerprintIndex.h"
+
+
+//
+// Similarity search of query fingerprints against a FingerprintIndex.
+//
+// For every query the k most similar indexed fingerprints (Tanimoto coefficient,
+// highest first) are reported; the first is the maximum.
+//
+// The index is copied in popcount order (buckets of equal popcount). Since
+// Tanimoto(A, B) <= min(|A|, |B|) / max(|A|, |B|) (Swamidass and Baldi), only the
+// buckets that can reach the threshold are scanned, and a bucket is skipped once
+// its bound cannot improve a query's top-k.
+//
+// Queries are sorted by popcount and processed QUERY_BATCH at a time against
+// TILE_SIZE fingerprints of a bucket so the tile stays in cache while each query
+// of the batch is compared against it.
+//
+// |A & B| is counted by the widest kernel the processor supports:
+// AVX-512 VPOPCNTDQ, AVX2 (nibble lookup) or 64-bit scalar popcount.
+//
+class TanimotoSearch
+{
+  public:
+    struct Hit
+    {
+        double tanimoto;
+        unsigned int index;
+
+        Hit() : tanimoto(-1), index(0) {}
+        Hit(double t, unsigned int i) : tanimoto(t), index(i) {}
+    };
+
+    // The index must not change for the lifetime of the search.
+    TanimotoSearch(const FingerprintIndex& index);
+
+    // results[q] receives up to k hits for queries[q], best first, among the
+    // fingerprints whose popcount allows a coefficient of at least threshold
+    // (0 considers all).
+    // Queries whose width differs from the index receive no hits.
+    void Search(const std::vector<std::vector<unsigned int> >& queries,
+                unsigned int k,
+                std::vector<std::vector<Hit> >& results,
+                double threshold = 0.0) const;
+
+    // |A & B| of two packed fingerprints using the selected kernel.
+    static unsigned int AndCount(const unsigned long long* a,
+                                 const unsigned long long* b,
+                                 unsigned int blocks) { return kernel(a, b, blocks); }
+
+    // Name of the popcount kernel in use.
+    static const char* KernelName();
+
+    // |A & B| over blocks 512-bit blocks.
+    typedef unsigned int (*AndCountKernel)(const unsigned long long* a,
+                                           const unsigned long long* b,
+                                           unsigned int blocks);
+
+  private:
+    const FingerprintIndex& index;
+    unsigned int stride;
+
+    // Fingerprints in popcount order: sorted holds entry order[s] at position s;
+    // the entries of popcount c are [bucketStart[c], bucketStart[c + 1]).
+    std::vector<unsigned long long> sorted;
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> bucketStart;
+
+    static const unsigned int QUERY_BATCH = 16;
+    static const unsigned int TILE_SIZE = 2048;
+
+    static AndCountKernel SelectKernel();
+    static AndCountKernel kernel;
+};
+
+#endif
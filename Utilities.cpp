@@ -4,6 +4,8 @@
 #include <iostream>
 #include <cctype>
 #include <algorithm>
+#include <unistd.h>
+#include <sys/resource.h>
 
 
 #include "Utilities.h"
@@ -89,3 +91,32 @@ bool ContainsFalse(const vector<bool>& vec)
     return std::find(vec.begin(), vec.end(), false) != vec.end();
 }
 
+//
+// Current resident set size from /proc (Linux); 0 if unavailable.
+//
+unsigned long residentMemory()
+{
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == 0) return 0;
+
+    unsigned long totalPages = 0;
+    unsigned long residentPages = 0;
+    int fields = fscanf(statm, "%lu %lu", &totalPages, &residentPages);
+    fclose(statm);
+
+    if (fields != 2) return 0;
+
+    return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+//
+// Peak resident set size; getrusage reports kilobytes on Linux.
+//
+unsigned long peakResidentMemory()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+    return (unsigned long)usage.ru_maxrss * 1024;
+}
@@ -21,7 +21,7 @@ std::string MakeString(const char s1[], const char s2[]);
 std::string MakeString(const char s1[], std::string s2);
 
 template<class T>
-bool Contains(std::vector<T> list, const T& val)
+bool Contains(const std::vector<T>& list, const T& val)
 {
     for (int i = 0; i < list.size(); i++)
     {
@@ -46,6 +46,10 @@ void eatWhiteLines(std::istream&);
 void MakeBoolVector(vector<bool>& vec, int size);
 bool ContainsFalse(const vector<bool>& vec);
 
+// Current and peak resident set size of this process (in bytes).
+unsigned long residentMemory();
+unsigned long peakResidentMemory();
+
 //
 // Macros for simplifying code a bit.
 //
@@ -1,10 +1,12 @@
 #include <vector>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <sys/time.h>
 
 
 #include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
-#include <openbabel/fingerprint.h>
 
 
 #include "HyperGraph.h"
@@ -13,168 +15,308 @@
 #include "Utilities.h"
 
 
+// ****************************************************************************
+
+Validator::Validator(const FingerprintIndex& fps) : fingerprints(fps),
+                                                     stride(0),
+                                                     numRecovered(0),
+                                                     startTime(Now())
+{
+    for (unsigned int ell = 0; ell < NUM_LOCKS; ell++) pthread_mutex_init(&locks[ell], NULL);
+    pthread_mutex_init(&recovered_lock, NULL);
+}
+
+// ****************************************************************************
+
+Validator::~Validator()
+{
+    for (unsigned int ell = 0; ell < NUM_LOCKS; ell++) pthread_mutex_destroy(&locks[ell]);
+    pthread_mutex_destroy(&recovered_lock);
+}
+
+// ****************************************************************************
+
+double Validator::Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// ****************************************************************************
+//
+// For validation purposes, we use the original files in MOL format (before
+// being stripped for linkers and rigids).
+//
+// (1) Parse the input files for all molecules to validate. 
+// (2) Acquire all of the hypergraph molecules and perform obgen to re-acquire hydrogen bonds.
+// (3) Compare the molecules using the Tanimoto similarity. (Get fingerprints of both
+//     molecules and compare).
 //
-// Validate a single molecule.
+// Only the fingerprint and title of each validation molecule are kept.
 //
-bool Validator::Validate(OpenBabel::OBMol& validationMol)
+bool Validator::Load(const std::string& fileName)
 {
-    std::vector<unsigned int> validationFP;
-    bool returnval = false;
-
-    if (g_debug_output)
+    if (fileName == "")
     {
-        std::cerr << "Atoms: " << validationMol.NumAtoms() << std::endl;
-        std::cerr << "Bonds: " << validationMol.NumBonds() << std::endl;
+        std::cerr << "Validation file not specified; will not validate." << std::endl;
+        return false;
     }
 
-    // Create the fingerprint for the validation molecule
-    OpenBabel::OBFingerprint* fpType = OpenBabel::OBFingerprint::FindFingerprint("");
-
-    // Acquire the fingerprint of the validation molecule so we can use it for
-    // Tanimoto comparison.
-    fpType->GetFingerprint(&validationMol, validationFP);
-
-    if (g_debug_output)
+    std::ifstream in(fileName.c_str());
+    if (!in.is_open())
     {
-        std::cerr << "Validation: " << std::endl;
-        foreach_uints(u_it, validationFP)
-        {
-            std::cerr << *u_it << "|";
-        }
-        std::cerr << std::endl;
+        std::cerr << "Unable to open validation file " << fileName << std::endl;
+        return false;
     }
 
+    std::cerr << "Reading Validation file " << fileName << std::endl;
+
     //
-    // Check this validation fingerprint against all of fingerprints in the list of
-    // valid molecules.
-    // 
-    // Tracks the largest tanimoto coefficient of the synthesized molecule (and index?)
+    // Input parser conversion functionality for Open babel
     //
-    double maxTanimoto = -1;
-    int maxIndex = -1;
-    int molIndex = 0;
-    foreach_obmol_points(m_it, this->molecules)
+    OpenBabel::OBConversion obConversion;
+    obConversion.SetInFormat("MOL2");
+
+    std::vector<std::string> readTitles;
+    std::vector<std::vector<unsigned int> > readFPs;
+
+    OpenBabel::OBMol mol;
+    while (obConversion.Read(&mol, &in))
     {
-        // Acquire the fingerprint of the hypergraph molecule.
-        std::vector<unsigned int> hgFP;
-        OpenBabel::OBFingerprint* fpType = OpenBabel::OBFingerprint::FindFingerprint("");
-        fpType->GetFingerprint(*m_it, hgFP);
+        readFPs.push_back(std::vector<unsigned int>());
+        FingerprintIndex::Compute(mol, readFPs.back());
+        readTitles.push_back(mol.GetTitle());
 
-        // Debug output of the fingerprint.
         if (g_debug_output)
         {
-            std::cerr << "Hypergraph: " << std::endl;
-            foreach_uints(u_it, hgFP)
+            std::cerr << "Atoms: " << mol.NumAtoms() << std::endl;
+            std::cerr << "Bonds: " << mol.NumBonds() << std::endl;
+            std::cerr << "Validation: " << std::endl;
+            foreach_uints(u_it, readFPs.back())
             {
                 std::cerr << *u_it << "|";
             }
             std::cerr << std::endl;
         }
 
-        // Acquire the tanimoto coefficient for the validation molecule and
-        // the synthesized molecules in the hypergraph.
-        double tanimoto = OpenBabel::OBFingerprint::Tanimoto(validationFP, hgFP);
+        mol.Clear();
+    }
 
-        if (tanimoto > maxTanimoto)
-        {
-            maxTanimoto = tanimoto;
-            maxIndex = molIndex;
-        }
+    if (readFPs.empty()) return false;
 
-        if (g_debug_output) std::cerr << "Tanimoto: " << tanimoto << std::endl;
+    //
+    // Order the validation molecules by popcount so Observe compares only a
+    // contiguous range of them.
+    //
+    std::vector<std::pair<unsigned int, unsigned int> > byCount;
+    for (unsigned int v = 0; v < readFPs.size(); v++)
+    {
+        unsigned int count = 0;
+        for (unsigned int w = 0; w < readFPs[v].size(); w++) count += __builtin_popcount(readFPs[v][w]);
 
-        if (tanimoto > (double)Options::TANIMOTO) 
+        byCount.push_back(std::make_pair(count, v));
+    }
+    std::stable_sort(byCount.begin(), byCount.end());
+
+    stride = FingerprintIndex::StrideFor(readFPs[0].size());
+    packed.assign(readFPs.size() * stride, 0);
+
+    for (unsigned int q = 0; q < byCount.size(); q++)
+    {
+        unsigned int v = byCount[q].second;
+
+        titles.push_back(readTitles[v]);
+        queries.push_back(readFPs[v]);
+        counts.push_back(byCount[q].first);
+
+        if (readFPs[v].size() == readFPs[0].size())
         {
-            returnval = true;
-            break;
+            FingerprintIndex::Pack(readFPs[v], stride, &packed[q * stride]);
         }
-
-        molIndex++;
     }
 
+    best.assign(titles.size(), std::vector<TanimotoSearch::Hit>());
+    firstHitLevel.assign(titles.size(), 0);
+    firstHitTime.assign(titles.size(), -1.0);
 
-    std::ofstream logfile("Validation_logfile.txt", std::ofstream::out |
-                                                    std::ofstream::app); // append
-    logfile << "Validation Molecule: " << validationMol.GetTitle() << " with ";
-    logfile << "Synth Molecule: " << this->molecules[maxIndex]->GetTitle() << "\n";
-    logfile << maxIndex << ": maxTanimoto = " << maxTanimoto;
-    // if (returnval) logfile << " - Validated\n";
-    // else logfile << " - Failed to Validate\n";
-    logfile << std::endl;
-    logfile.close();
+    std::cerr << "Read " << titles.size() << " validation molecules." << std::endl;
 
-    return returnval;
+    return true;
 }
 
-
+// ****************************************************************************
 //
-// Validate a list of molecules.
+// Insert a hit in the top -topk of validation molecule q; record the first
+// match above -tc.
 //
-void Validator::Validate(std::vector<OpenBabel::OBMol>& molsToValidate)
+void Validator::Update(unsigned int q, const TanimotoSearch::Hit& hit, unsigned int level)
 {
-    int counter = 1;
+    pthread_mutex_lock(&locks[q % NUM_LOCKS]);
 
-    foreach_obmols(m_it, molsToValidate)
+    if (hit.tanimoto > (double)Options::TANIMOTO && firstHitTime[q] < 0)
     {
-        if (!Validate(*m_it))
-        {
-            std::cerr << "Failed to validate: " << m_it->GetTitle() << std::endl;
-        }
-        else
-        {
-            std::cerr << "Validated molecule #" << counter
-                      << ": " << m_it->GetTitle() << std::endl;
-        }
-        counter++;
+        firstHitTime[q] = Now() - startTime;
+        firstHitLevel[q] = level;
+
+        pthread_mutex_lock(&recovered_lock);
+        numRecovered++;
+        pthread_mutex_unlock(&recovered_lock);
+
+        std::cerr << "Validation molecule " << titles[q] << " recovered at level " << level
+                  << " after " << firstHitTime[q] << " seconds." << std::endl;
     }
+
+    std::vector<TanimotoSearch::Hit>& hits = best[q];
+
+    if (hits.size() < Options::TOP_K || hit.tanimoto > hits.back().tanimoto)
+    {
+        std::vector<TanimotoSearch::Hit>::iterator pos = hits.begin();
+        while (pos != hits.end() && pos->tanimoto >= hit.tanimoto) pos++;
+
+        hits.insert(pos, hit);
+        if (hits.size() > Options::TOP_K) hits.pop_back();
+    }
+
+    pthread_mutex_unlock(&locks[q % NUM_LOCKS]);
 }
 
+// ****************************************************************************
+
+void Validator::Observe(const std::vector<unsigned int>& fp, unsigned int outputIndex,
+                        unsigned int level)
+{
+    if (titles.empty() || Options::TOP_K == 0) return;
+
+    // Fingerprints of another width cannot be compared.
+    if (fp.size() != queries[0].size()) return;
+
+    std::vector<unsigned long long> synth(stride);
+    FingerprintIndex::Pack(fp, stride, &synth[0]);
+
+    unsigned int b = 0;
+    for (unsigned int w = 0; w < fp.size(); w++) b += __builtin_popcount(fp[w]);
+
+    //
+    // Only validation molecules with popcount in [t |B|, |B| / t] can reach the threshold.
+    //
+    double t = Options::TANIMOTO;
+    unsigned int low = (unsigned int)std::ceil(t * b);
+    unsigned int high = t > 0 ? (unsigned int)std::floor(b / t) : counts.back();
+
+    std::vector<unsigned int>::const_iterator first = std::lower_bound(counts.begin(), counts.end(), low);
+    std::vector<unsigned int>::const_iterator last = std::upper_bound(counts.begin(), counts.end(), high);
+
+    const unsigned int blocks = stride / FingerprintIndex::BLOCK_WORDS;
+
+    for (unsigned int q = first - counts.begin(); q < (unsigned int)(last - counts.begin()); q++)
+    {
+        if (queries[q].size() != fp.size()) continue;
+
+        unsigned int andBits = TanimotoSearch::AndCount(&synth[0], &packed[q * stride], blocks);
+        unsigned int orBits = counts[q] + b - andBits;
+
+        double tanimoto = orBits == 0 ? 0.0 : (double)andBits / (double)orBits;
+
+        if (g_debug_output) std::cerr << "Tanimoto: " << tanimoto << std::endl;
+
+        Update(q, TanimotoSearch::Hit(tanimoto, outputIndex), level);
+    }
+}
+
+// ****************************************************************************
 
 //
-// For validation purposes, we use the original files in MOL format (before
-// being stripped for linkers and rigids).
-//
-// (1) Parse the input files for all molecules to validate. 
-// (2) Acquire all of the hypergraph molecules and perform obgen to re-acquire hydrogen bonds.
-// (3) Compare the molecules using the Tanimoto similarity. (Get fingerprints of both
-//     molecules and compare).
+// Observe compares a validation molecule only against synthesized molecules whose
+// popcount can reach -tc, so the best matches of one not validated (none above -tc)
+// may miss more similar molecules below the threshold. Those are searched against
+// the whole index (no threshold) so their most similar molecules are reported.
 //
-void Validator::Validate(const std::string& fileName)
+void Validator::ValidateIndex()
 {
-    if (fileName == "")
+    std::vector<std::vector<unsigned int> > unreached;
+    std::vector<unsigned int> positions;
+    for (unsigned int q = 0; q < titles.size(); q++)
     {
-        std::cerr << "Validation file not specified; will not validate." << std::endl;
-        return;
+        if (!best[q].empty() && best[q][0].tanimoto > (double)Options::TANIMOTO) continue;
+
+        unreached.push_back(queries[q]);
+        positions.push_back(q);
     }
 
-    //
-    // Input parser conversion functionality for Open babel
-    //
-    OpenBabel::OBConversion obConversion;
-    obConversion.SetInFormat("MOL2");
+    if (unreached.empty() || fingerprints.size() == 0) return;
 
-    // The molecules to validate.
-    std::vector<OpenBabel::OBMol> molsToValidate;
-   
-    std::cerr << "Reading Validation file " << fileName << std::endl;
- 
-    //
-    // Read all of the OBMol objects using Open Babel; using their sample code style for reading.
-    //
-    OpenBabel::OBMol* mol = new OpenBabel::OBMol();
-    bool notAtEnd = obConversion.ReadFile(mol, fileName.c_str());
-    molsToValidate.push_back(*mol);
+    TanimotoSearch search(fingerprints);
+
+    if (g_debug_output) std::cerr << "Tanimoto kernel: " << TanimotoSearch::KernelName() << std::endl;
 
-    while(notAtEnd)
+    std::vector<std::vector<TanimotoSearch::Hit> > results;
+    search.Search(unreached, Options::TOP_K, results);
+
+    for (unsigned int u = 0; u < positions.size(); u++) best[positions[u]] = results[u];
+}
+
+// ****************************************************************************
+
+unsigned int Validator::Report()
+{
+    std::ofstream logfile("Validation_logfile.txt", std::ofstream::out |
+                                                    std::ofstream::app); // append
+
+    unsigned int numValidated = 0;
+    for (unsigned int q = 0; q < titles.size(); q++)
     {
-        // Create and parse using Open Babel
-        OpenBabel::OBMol* mol = new OpenBabel::OBMol();
-        notAtEnd = obConversion.Read(mol);
-        if (notAtEnd) molsToValidate.push_back(*mol);
+        const std::vector<TanimotoSearch::Hit>& hits = best[q];
+
+        // The largest tanimoto coefficient is the first hit.
+        bool validated = !hits.empty() && hits[0].tanimoto > (double)Options::TANIMOTO;
+
+        if (!validated)
+        {
+            std::cerr << "Failed to validate: " << titles[q] << std::endl;
+        }
+        else
+        {
+            numValidated++;
+            std::cerr << "Validated molecule: " << titles[q];
+            if (firstHitTime[q] >= 0)
+            {
+                std::cerr << " (level " << firstHitLevel[q] << ", " << firstHitTime[q] << " s)";
+            }
+            std::cerr << std::endl;
+        }
+
+        // Empty only if nothing was synthesized (see ValidateIndex).
+        if (hits.empty())
+        {
+            logfile << "Validation Molecule: " << titles[q]
+                    << ": no synthesized molecule to compare with" << std::endl;
+            continue;
+        }
+
+        logfile << "Validation Molecule: " << titles[q] << " with ";
+        logfile << "Synth Molecule: " << fingerprints.Title(hits[0].index) << "\n";
+        logfile << hits[0].index << ": maxTanimoto = " << hits[0].tanimoto;
+        logfile << std::endl;
+
+        if (firstHitTime[q] >= 0)
+        {
+            logfile << "    first matched at level " << firstHitLevel[q] << " after "
+                    << firstHitTime[q] << " seconds" << std::endl;
+        }
+
+        for (unsigned int h = 1; h < hits.size(); h++)
+        {
+            logfile << "    " << h + 1 << ". " << fingerprints.Title(hits[h].index)
+                    << " (" << hits[h].index << "): " << hits[h].tanimoto << std::endl;
+        }
     }
 
-    // Validate all molecules in the given file.
-    Validate(molsToValidate);
-}
+    logfile.close();
 
+    std::cerr << numValidated << " of " << titles.size() << " validation molecules validated."
+              << std::endl;
 
+    return numValidated;
+}
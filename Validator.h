@@ -3,12 +3,16 @@
 
 
 #include <vector>
+#include <string>
+#include <pthread.h>
 
 
 #include <openbabel/mol.h>
 
 
 #include "HyperGraph.h"
+#include "FingerprintIndex.h"
+#include "TanimotoSearch.h"
 
 
 //
@@ -17,17 +21,80 @@
 //          (2) a set of Open Babel molecules,
 //    Verify that the set of molecules are vertices in the hypergraph.
 //
+// The validation molecules are loaded (and fingerprinted) before synthesis.
+// Each synthesized molecule is then observed by the writer thread that outputs it,
+// so the per-query best matches (the -topk most similar) are current when
+// synthesis ends. Only queries whose popcount can reach the -tc threshold are
+// compared against a synthesized molecule; ValidateIndex then searches the whole
+// index (TanimotoSearch) for the queries without a match above -tc.
+//
+// The level and time (since the validator was created) at which each validation
+// molecule is first matched above -tc are recorded; with -goal, synthesis stops
+// once every validation molecule has been matched (AllRecovered).
+//
 class Validator
 {
   public:
-    Validator(std::vector<OpenBabel::OBMol*>& mols) : molecules(mols) {}
-    bool Validate(OpenBabel::OBMol&);
-    void Validate(const std::string& fileName);
-    void Validate(std::vector<OpenBabel::OBMol>&);
+    Validator(const FingerprintIndex& fps);
+    ~Validator();
+
+    // Parse the validation molecules (MOL2); false if none could be read.
+    bool Load(const std::string& fileName);
+
+    // Compare a synthesized fingerprint (entry outputIndex of the fingerprint
+    // index, synthesized at the given level; 0 if unknown) against the
+    // validation molecules. Thread-safe.
+    void Observe(const std::vector<unsigned int>& fp, unsigned int outputIndex,
+                 unsigned int level);
+
+    // Every validation molecule has a match above -tc.
+    bool AllRecovered() const { return !titles.empty() && numRecovered == titles.size(); }
+
+    // Once writing is complete: search the whole fingerprint index for the
+    // validation molecules without a match above -tc.
+    void ValidateIndex();
+
+    // Report and log the verdict for each validation molecule, with its best matches
+    // (maximum Tanimoto and index) whether or not validated; call ValidateIndex first.
+    // Returns the number validated.
+    unsigned int Report();
+
+    unsigned int size() const { return titles.size(); }
 
   private:
+    const FingerprintIndex& fingerprints;
+
+    //
+    // Validation molecules in popcount order.
+    //
+    std::vector<std::string> titles;
+    std::vector<std::vector<unsigned int> > queries;
+    std::vector<unsigned int> counts;
+    std::vector<unsigned long long> packed;
+    unsigned int stride;
+
+    // Best matches per validation molecule, best first.
+    std::vector<std::vector<TanimotoSearch::Hit> > best;
+
+    // First match above -tc per validation molecule: level (0 if unknown) and
+    // seconds since startTime; firstHitTime < 0 if not yet matched.
+    std::vector<unsigned int> firstHitLevel;
+    std::vector<double> firstHitTime;
+    volatile unsigned int numRecovered;
+    double startTime;
+
+    // Observe updates best[q] (and the first hit) under locks[q % NUM_LOCKS].
+    static const unsigned int NUM_LOCKS = 64;
+    pthread_mutex_t locks[NUM_LOCKS];
+    pthread_mutex_t recovered_lock;
+
+    void Update(unsigned int q, const TanimotoSearch::Hit& hit, unsigned int level);
+    static double Now();
+
+    Validator(const Validator&);
+    Validator& operator=(const Validator&);
 
-    std::vector<OpenBabel::OBMol*>& molecules; 
+    friend class Checkpoint;
 };
 
 #endif
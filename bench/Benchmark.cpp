@@ -0,0 +1,786 @@
+//
+// Micro-benchmarks of the synthesis hot paths.
+//
+//     make bench
+//     ./synth_bench [-time <sec>] [-v <validation-file>] [<linker-files> <rigid-files>]
+//
+// The fragments default to the fixtures in bench/ (lbench.sdf, rbench.sdf). From them a
+// pool of molecules (levels 2 through BENCH_LEVEL, deduplicated through a hypergraph as
+// in synthesis) is composed once; each routine is then timed in isolation over the pool
+// and reported in ns/op and allocations/op (calls of the global operator new, which
+// includes Open Babel's allocations).
+//
+// Without -v, the Validator benchmark compares against a sample of the pool written
+// out as MOL2.
+//
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+
+
+#include <openbabel/mol.h>
+#include <openbabel/obconversion.h>
+
+
+#include "Molecule.h"
+#include "Rigid.h"
+#include "Linker.h"
+#include "EdgeAggregator.h"
+#include "EdgeAnnotation.h"
+#include "HyperGraph.h"
+#include "FragmentGraph.h"
+#include "FragmentLoader.h"
+#include "FingerprintIndex.h"
+#include "Validator.h"
+#include "Options.h"
+#include "Constants.h"
+
+
+//
+// Allocation counting: every allocation through the global operator new.
+//
+static unsigned long long numAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    __atomic_add_fetch(&numAllocations, 1, __ATOMIC_RELAXED);
+
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == 0) throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    std::free(p);
+}
+
+// Sized deallocation (C++14) must pair with the operator new above as well.
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) throw()
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) throw()
+{
+    std::free(p);
+}
+#endif
+
+// ****************************************************************************
+
+class Benchmark
+{
+  public:
+    Benchmark(double minSeconds);
+    ~Benchmark();
+
+    bool Load(const std::vector<std::string>& fileNames);
+    void Populate();
+    bool LoadValidation(const std::string& fileName);
+    void Run();
+
+  private:
+    // Highest level of the molecule pool and the number of molecules kept per level.
+    static const unsigned int BENCH_LEVEL = 4;
+    static const unsigned int POOL_CAP = 1024;
+
+    // Molecules written out as validation molecules (without -v).
+    static const unsigned int VALIDATION_SAMPLE = 64;
+
+    // A composable pair of atoms (indices) of two molecules.
+    struct Connection
+    {
+        const Molecule* left;
+        const Molecule* right;
+        int leftAtom;
+        int rightAtom;
+    };
+
+    // An edge of the pool as produced by Compose.
+    struct Edge
+    {
+        std::vector<Molecule> antecedent;
+        Molecule consequent;
+        EdgeAnnotationT annotation;
+    };
+
+    unsigned long long minTime;
+
+    std::vector<Linker*> linkers;
+    std::vector<Rigid*> rigids;
+    std::vector<Molecule*> baseMolecules;
+
+    // The pool: molecules and edges per level, deduplicated through poolGraph.
+    HyperGraph<Molecule, EdgeAnnotationT>* poolGraph;
+    std::vector<std::vector<Molecule*> > levels;
+    std::vector<std::vector<Edge> > levelEdges;
+
+    // Inputs of the routines.
+    std::vector<std::pair<const Molecule*, const Molecule*> > composePairs;
+    std::vector<Connection> connections;
+    std::vector<FragmentGraph*> fingerprints;
+    std::vector<FragmentGraph*> fingerprintCopies;
+    std::vector<std::pair<FragmentGraph*, FragmentGraph*> > distinctPairs;
+    std::vector<const Edge*> lipinskiEdges;
+    std::vector<std::vector<unsigned int> > synthesizedFPs;
+
+    // Hypergraph of the lower levels and the first bucketSize molecules of the top level.
+    HyperGraph<Molecule, EdgeAnnotationT>* bucketGraph;
+    unsigned int bucketSize;
+
+    FingerprintIndex validatorIndex;
+    Validator* validator;
+
+    // Measurement of the current routine: time and allocations while resumed.
+    unsigned long long elapsed;
+    unsigned long long allocations;
+    unsigned long long resumeTime;
+    unsigned long long resumeAllocations;
+
+    typedef unsigned long (Benchmark::*Routine)(unsigned long iterations);
+
+    static unsigned long long Now();
+    void Resume();
+    void Pause();
+    void Measure(const std::string& name, Routine routine);
+
+    void AddToPool(unsigned int level, std::vector<EdgeAggregator*>& newEdges);
+    void PrepareInputs();
+    void BuildBucketGraph(unsigned int size);
+
+    unsigned long Compose(unsigned long iterations);
+    unsigned long ComposeToNewMolecule(unsigned long iterations);
+    unsigned long CopyFingerprint(unsigned long iterations);
+    unsigned long IsomorphicMatch(unsigned long iterations);
+    unsigned long IsomorphicMismatch(unsigned long iterations);
+    unsigned long AddPresentNode(unsigned long iterations);
+    unsigned long FindAbsentNode(unsigned long iterations);
+    unsigned long AddPresentEdge(unsigned long iterations);
+    unsigned long EstimateLipinski(unsigned long iterations);
+    unsigned long ValidatorObserve(unsigned long iterations);
+};
+
+// ****************************************************************************
+
+Benchmark::Benchmark(double minSeconds) : minTime((unsigned long long)(minSeconds * 1e9)),
+                                          poolGraph(0),
+                                          bucketGraph(0),
+                                          bucketSize(0),
+                                          validator(0)
+{
+}
+
+Benchmark::~Benchmark()
+{
+    delete validator;
+    delete bucketGraph;
+    delete poolGraph;
+
+    for (unsigned int f = 0; f < fingerprintCopies.size(); f++) delete fingerprintCopies[f];
+
+    for (unsigned int m = 2; m < levels.size(); m++)
+    {
+        for (unsigned int i = 0; i < levels[m].size(); i++)
+        {
+            levels[m][i]->Release();
+            delete levels[m][i];
+        }
+    }
+
+    for (unsigned int ell = 0; ell < linkers.size(); ell++) delete linkers[ell];
+    for (unsigned int r = 0; r < rigids.size(); r++) delete rigids[r];
+}
+
+// ****************************************************************************
+
+unsigned long long Benchmark::Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void Benchmark::Resume()
+{
+    resumeAllocations = __atomic_load_n(&numAllocations, __ATOMIC_RELAXED);
+    resumeTime = Now();
+}
+
+void Benchmark::Pause()
+{
+    elapsed += Now() - resumeTime;
+    allocations += __atomic_load_n(&numAllocations, __ATOMIC_RELAXED) - resumeAllocations;
+}
+
+// ****************************************************************************
+//
+// Double the iterations until the measured time reaches the minimum; a routine
+// without inputs returns 0 operations and is skipped.
+//
+void Benchmark::Measure(const std::string& name, Routine routine)
+{
+    unsigned long iterations = 1;
+    unsigned long ops = 0;
+
+    // Warm-up
+    elapsed = allocations = 0;
+    if ((this->*routine)(iterations) == 0)
+    {
+        std::cout << std::left << std::setw(48) << name << "skipped (no inputs)" << std::endl;
+        return;
+    }
+
+    for ( ; ; iterations *= 2)
+    {
+        elapsed = allocations = 0;
+        ops = (this->*routine)(iterations);
+
+        if (elapsed >= minTime || iterations >= (1UL << 30)) break;
+    }
+
+    std::cout << std::left << std::setw(48) << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(14) << (double)elapsed / ops << " ns/op"
+              << std::setprecision(2) << std::setw(12) << (double)allocations / ops << " allocs/op"
+              << std::setw(12) << ops << " ops" << std::endl;
+}
+
+// ****************************************************************************
+//
+// Load the fragments and set them up as the Instantiator does for synthesis.
+//
+bool Benchmark::Load(const std::vector<std::string>& fileNames)
+{
+    FragmentLoader loader(Options::LOADER_THREAD_POOL_SIZE);
+
+    if (!loader.Load(fileNames, linkers, rigids)) return false;
+
+    if (linkers.empty() && rigids.empty())
+    {
+        std::cerr << "No fragments were read." << std::endl;
+        return false;
+    }
+
+    unsigned int id = 0;
+    for (unsigned int r = 0; r < rigids.size(); r++)
+    {
+        rigids[r]->setUniqueIndexID(id++);
+        baseMolecules.push_back(rigids[r]);
+    }
+    for (unsigned int ell = 0; ell < linkers.size(); ell++)
+    {
+        linkers[ell]->setUniqueIndexID(id++);
+        baseMolecules.push_back(linkers[ell]);
+    }
+
+    Molecule::SetBaseMoleculeInfo(baseMolecules, rigids.size(), linkers.size());
+
+    for (unsigned int m = 0; m < baseMolecules.size(); m++)
+    {
+        baseMolecules[m]->initFragmentDevices();
+        baseMolecules[m]->initGraphRepresentation();
+    }
+
+    std::cout << "Fragments: " << linkers.size() << " linkers, " << rigids.size() << " rigids" << std::endl;
+
+    return true;
+}
+
+// ****************************************************************************
+//
+// Keep the new molecules of a composition (up to the pool cap of the level); each
+// pool molecule's unique index is its hypergraph node, as in synthesis.
+//
+void Benchmark::AddToPool(unsigned int level, std::vector<EdgeAggregator*>& newEdges)
+{
+    for (unsigned int e = 0; e < newEdges.size(); e++)
+    {
+        Molecule* consequent = newEdges[e]->consequent;
+
+        if (levels[level].size() < POOL_CAP && poolGraph->AddNode(*consequent))
+        {
+            consequent->setUniqueIndexID(poolGraph->size() - 1);
+            levels[level].push_back(consequent);
+
+            Edge edge;
+            edge.antecedent = newEdges[e]->antecedent;
+            edge.consequent = *consequent;
+            edge.annotation = *newEdges[e]->annotation;
+            levelEdges[level].push_back(edge);
+        }
+        else
+        {
+            consequent->Release();
+            delete consequent;
+        }
+
+        delete newEdges[e]->annotation;
+        delete newEdges[e];
+    }
+}
+
+// ****************************************************************************
+//
+// Compose the pool level by level: pairs of base molecules, then each molecule of
+// a level with each base molecule.
+//
+void Benchmark::Populate()
+{
+    poolGraph = new HyperGraph<Molecule, EdgeAnnotationT>(BENCH_LEVEL + 1);
+
+    levels.assign(BENCH_LEVEL + 1, std::vector<Molecule*>());
+    levelEdges.assign(BENCH_LEVEL + 1, std::vector<Edge>());
+
+    for (unsigned int b = 0; b < baseMolecules.size(); b++)
+    {
+        poolGraph->AddNode(*baseMolecules[b]);
+        levels[1].push_back(baseMolecules[b]);
+    }
+
+    for (unsigned int m = 2; m <= BENCH_LEVEL; m++)
+    {
+        for (unsigned int i = 0; i < levels[m - 1].size(); i++)
+        {
+            for (unsigned int b = (m == 2 ? i : 0); b < baseMolecules.size(); b++)
+            {
+                std::vector<EdgeAggregator*>* newEdges = levels[m - 1][i]->Compose(*baseMolecules[b]);
+
+                AddToPool(m, *newEdges);
+
+                delete newEdges;
+            }
+        }
+
+        std::cout << "Level " << m << ": " << levels[m].size() << " molecules" << std::endl;
+    }
+
+    PrepareInputs();
+}
+
+// ****************************************************************************
+
+void Benchmark::PrepareInputs()
+{
+    //
+    // Compose: base pairs (level 2) and level-2 molecules with base molecules (level 3).
+    //
+    for (unsigned int i = 0; i < baseMolecules.size(); i++)
+    {
+        for (unsigned int j = i; j < baseMolecules.size(); j++)
+        {
+            composePairs.push_back(std::make_pair(baseMolecules[i], baseMolecules[j]));
+        }
+    }
+    for (unsigned int i = 0; i < levels[2].size(); i++)
+    {
+        for (unsigned int b = 0; b < baseMolecules.size(); b++)
+        {
+            composePairs.push_back(std::make_pair(levels[2][i], baseMolecules[b]));
+        }
+    }
+
+    //
+    // ComposeToNewMolecule: the connectable atoms of those pairs.
+    //
+    for (unsigned int p = 0; p < composePairs.size(); p++)
+    {
+        const Molecule* left = composePairs[p].first;
+        const Molecule* right = composePairs[p].second;
+
+        if (Molecule::willExceedMolecularWeight(*left, *right)) continue;
+
+        for (unsigned int a = 0; a < left->atoms.size(); a++)
+        {
+            for (unsigned int b = 0; b < right->atoms.size(); b++)
+            {
+                if (!left->atoms[a].CanConnectTo(right->atoms[b])) continue;
+
+                Connection connection = { left, right, (int)a, (int)b };
+                connections.push_back(connection);
+            }
+        }
+    }
+
+    //
+    // Fingerprints of the pool; pairs with the same fragment counts (which reach the
+    // isomorphism check in Molecule::operator==) that are not isomorphic.
+    //
+    for (unsigned int m = 2; m < levels.size(); m++)
+    {
+        for (unsigned int i = 0; i < levels[m].size(); i++)
+        {
+            fingerprints.push_back(levels[m][i]->getFingerprint());
+            fingerprintCopies.push_back(levels[m][i]->getFingerprint()->copy());
+        }
+
+        for (unsigned int i = 0; i < levels[m].size() && distinctPairs.size() < POOL_CAP; i++)
+        {
+            for (unsigned int j = i + 1; j < levels[m].size() && distinctPairs.size() < POOL_CAP; j++)
+            {
+                bool sameCounts = true;
+                for (unsigned int f = 0; f < Molecule::NUM_UNIQUE_FRAGMENTS && sameCounts; f++)
+                {
+                    sameCounts = levels[m][i]->FragmentCount(f) == levels[m][j]->FragmentCount(f);
+                }
+
+                if (sameCounts)
+                {
+                    distinctPairs.push_back(std::make_pair(levels[m][i]->getFingerprint(),
+                                                           levels[m][j]->getFingerprint()));
+                }
+            }
+        }
+    }
+
+    //
+    // Lipinski estimates and synthesized fingerprints for the Validator.
+    //
+    for (unsigned int m = 2; m < levelEdges.size(); m++)
+    {
+        for (unsigned int e = 0; e < levelEdges[m].size(); e++)
+        {
+            lipinskiEdges.push_back(&levelEdges[m][e]);
+
+            synthesizedFPs.push_back(std::vector<unsigned int>());
+            FingerprintIndex::Compute(*levels[m][e]->getOpenBabelMol(), synthesizedFPs.back());
+        }
+    }
+}
+
+// ****************************************************************************
+//
+// The validation molecules; without a file, a sample of the top level of the pool.
+//
+bool Benchmark::LoadValidation(const std::string& fileName)
+{
+    std::string validationFile = fileName;
+
+    if (validationFile.empty())
+    {
+        const std::vector<Molecule*>& top = levels.back();
+        if (top.empty()) return false;
+
+        std::ostringstream name;
+        name << "synth_bench_validation." << getpid() << ".mol2";
+        validationFile = name.str();
+
+        std::ofstream out(validationFile.c_str());
+        OpenBabel::OBConversion obConversion;
+        obConversion.SetOutFormat("MOL2");
+
+        unsigned int step = top.size() > VALIDATION_SAMPLE ? top.size() / VALIDATION_SAMPLE : 1;
+        for (unsigned int i = 0; i < top.size(); i += step)
+        {
+            obConversion.Write(top[i]->getOpenBabelMol(), &out);
+        }
+    }
+
+    validator = new Validator(validatorIndex);
+    bool loaded = validator->Load(validationFile);
+
+    if (fileName.empty()) unlink(validationFile.c_str());
+
+    return loaded;
+}
+
+// ****************************************************************************
+
+void Benchmark::BuildBucketGraph(unsigned int size)
+{
+    delete bucketGraph;
+    bucketGraph = new HyperGraph<Molecule, EdgeAnnotationT>(BENCH_LEVEL + 1);
+
+    // The node indices match the pool graph, so the edges' antecedents are valid.
+    unsigned int lower = poolGraph->size() - levels[BENCH_LEVEL].size();
+    for (unsigned int v = 0; v < lower + size; v++)
+    {
+        bucketGraph->AppendNode(poolGraph->vertices[v].data);
+    }
+
+    const std::vector<Edge>& edges = levelEdges[BENCH_LEVEL];
+    for (unsigned int e = 0; e < size; e++)
+    {
+        bucketGraph->AddEdge(edges[e].antecedent, edges[e].consequent, edges[e].annotation);
+    }
+
+    bucketSize = size;
+}
+
+// ****************************************************************************
+
+void Benchmark::Run()
+{
+    std::cout << std::endl;
+
+    Measure("Molecule::Compose", &Benchmark::Compose);
+    Measure("Molecule::ComposeToNewMolecule", &Benchmark::ComposeToNewMolecule);
+    Measure("FragmentGraph::copy", &Benchmark::CopyFingerprint);
+    Measure("FragmentGraph::IsIsomorphicTo (isomorphic)", &Benchmark::IsomorphicMatch);
+    Measure("FragmentGraph::IsIsomorphicTo (same fragments)", &Benchmark::IsomorphicMismatch);
+
+    //
+    // Hypergraph operations scan the bucket of the molecule's size.
+    //
+    for (unsigned int size = 16; size <= levels[BENCH_LEVEL].size(); size *= 4)
+    {
+        BuildBucketGraph(size);
+
+        std::ostringstream bucket;
+        bucket << " (bucket " << size << ")";
+
+        Measure("HyperGraph::AddNode, present" + bucket.str(), &Benchmark::AddPresentNode);
+        Measure("HyperGraph::HasNode, absent" + bucket.str(), &Benchmark::FindAbsentNode);
+        Measure("HyperGraph::AddEdge, present" + bucket.str(), &Benchmark::AddPresentEdge);
+    }
+
+    Measure("Molecule::estimateLipinski", &Benchmark::EstimateLipinski);
+    Measure("Validator::Observe", &Benchmark::ValidatorObserve);
+}
+
+// ****************************************************************************
+//
+// The routines; products are released outside the measured region.
+//
+unsigned long Benchmark::Compose(unsigned long iterations)
+{
+    if (composePairs.empty()) return 0;
+
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        const std::pair<const Molecule*, const Molecule*>& pair = composePairs[i % composePairs.size()];
+
+        Resume();
+        std::vector<EdgeAggregator*>* newEdges = pair.first->Compose(*pair.second);
+        Pause();
+
+        for (unsigned int e = 0; e < newEdges->size(); e++)
+        {
+            (*newEdges)[e]->consequent->Release();
+            delete (*newEdges)[e]->consequent;
+            delete (*newEdges)[e]->annotation;
+            delete (*newEdges)[e];
+        }
+        delete newEdges;
+    }
+
+    return iterations;
+}
+
+unsigned long Benchmark::ComposeToNewMolecule(unsigned long iterations)
+{
+    if (connections.empty()) return 0;
+
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        const Connection& c = connections[i % connections.size()];
+
+        Resume();
+        Molecule* newMol = c.left->ComposeToNewMolecule(*c.right, c.leftAtom + 1,
+                                                        c.rightAtom + c.left->atoms.size() + 1);
+        Pause();
+
+        newMol->Release();
+        delete newMol;
+    }
+
+    return iterations;
+}
+
+unsigned long Benchmark::CopyFingerprint(unsigned long iterations)
+{
+    if (fingerprints.empty()) return 0;
+
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        Resume();
+        FragmentGraph* copy = fingerprints[i % fingerprints.size()]->copy();
+        Pause();
+
+        delete copy;
+    }
+
+    return iterations;
+}
+
+unsigned long Benchmark::IsomorphicMatch(unsigned long iterations)
+{
+    if (fingerprints.empty()) return 0;
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        unsigned int f = i % fingerprints.size();
+        if (!fingerprints[f]->IsIsomorphicTo(fingerprintCopies[f])) throw "A fingerprint differs from its copy";
+    }
+    Pause();
+
+    return iterations;
+}
+
+unsigned long Benchmark::IsomorphicMismatch(unsigned long iterations)
+{
+    if (distinctPairs.empty()) return 0;
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        const std::pair<FragmentGraph*, FragmentGraph*>& pair = distinctPairs[i % distinctPairs.size()];
+        if (pair.first->IsIsomorphicTo(pair.second)) throw "Distinct hypergraph nodes are isomorphic";
+    }
+    Pause();
+
+    return iterations;
+}
+
+unsigned long Benchmark::AddPresentNode(unsigned long iterations)
+{
+    const std::vector<Molecule*>& top = levels[BENCH_LEVEL];
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        if (bucketGraph->AddNode(*top[i % bucketSize])) throw "A present node was added";
+    }
+    Pause();
+
+    return iterations;
+}
+
+unsigned long Benchmark::FindAbsentNode(unsigned long iterations)
+{
+    const std::vector<Molecule*>& top = levels[BENCH_LEVEL];
+
+    if (top.size() == bucketSize) return 0;
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        if (bucketGraph->HasNode(*top[bucketSize + i % (top.size() - bucketSize)])) throw "An absent node was found";
+    }
+    Pause();
+
+    return iterations;
+}
+
+unsigned long Benchmark::AddPresentEdge(unsigned long iterations)
+{
+    const std::vector<Edge>& edges = levelEdges[BENCH_LEVEL];
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        const Edge& edge = edges[i % bucketSize];
+        bucketGraph->AddEdge(edge.antecedent, edge.consequent, edge.annotation);
+    }
+    Pause();
+
+    return iterations;
+}
+
+unsigned long Benchmark::EstimateLipinski(unsigned long iterations)
+{
+    if (lipinskiEdges.empty()) return 0;
+
+    Molecule estimate;
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        const Edge& edge = *lipinskiEdges[i % lipinskiEdges.size()];
+        estimate.estimateLipinski(edge.antecedent[0], edge.antecedent[1]);
+    }
+    Pause();
+
+    return iterations;
+}
+
+unsigned long Benchmark::ValidatorObserve(unsigned long iterations)
+{
+    if (validator == 0 || validator->size() == 0 || synthesizedFPs.empty()) return 0;
+
+    Resume();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        unsigned int s = i % synthesizedFPs.size();
+        validator->Observe(synthesizedFPs[s], s, 0);
+    }
+    Pause();
+
+    return iterations;
+}
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    double minSeconds = 0.5;
+    std::string validationFile = "";
+    std::vector<std::string> fileNames;
+
+    for (int index = 1; index < argc; index++)
+    {
+        if (strcmp(argv[index], "-time") == 0 && index + 1 < argc) minSeconds = atof(argv[++index]);
+        else if (strcmp(argv[index], "-v") == 0 && index + 1 < argc) validationFile = argv[++index];
+        else fileNames.push_back(argv[index]);
+    }
+
+    if (fileNames.empty())
+    {
+        fileNames.push_back("bench/lbench.sdf");
+        fileNames.push_back("bench/rbench.sdf");
+    }
+
+    // Every validation molecule is compared (the whole Tanimoto loop runs).
+    Options::TANIMOTO = 0.0;
+
+    try
+    {
+        Benchmark benchmark(minSeconds);
+
+        if (!benchmark.Load(fileNames)) return 1;
+
+        benchmark.Populate();
+
+        if (!benchmark.LoadValidation(validationFile))
+        {
+            std::cerr << "No validation molecules; Validator::Observe is skipped." << std::endl;
+        }
+
+        benchmark.Run();
+    }
+    catch (const char* msg)
+    {
+        std::cerr << "Benchmark failed: " << msg << std::endl;
+        return 1;
+    }
+    catch (const std::string& msg)
+    {
+        std::cerr << "Benchmark failed: " << msg << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -70,7 +70,7 @@ int main(int argc, char** argv)
 			synthCommand += " " + moleculeFileName;
 		}
 
-		synthCommand += " -o output-" + scenarioName + ".sdf\n";
+		synthCommand += " -o output-" + scenarioName + ".sdf.gz\n";
 
 		moleculesFile.close();
 		system("rm moleculeFileList.txt");
@@ -80,7 +80,7 @@ int main(int argc, char** argv)
 		system(synthCommand.c_str());
 
 		/* move output file into outputFiles/[nameOfProtein] */
-		sysCommand = "mv output-" + scenarioName + ".sdf outputFiles/" + nameOfProtein + "/output-" + scenarioName + ".sdf\n";
+		sysCommand = "mv output-" + scenarioName + ".sdf.gz outputFiles/" + nameOfProtein + "/output-" + scenarioName + ".sdf.gz\n";
 		cout << sysCommand << endl;
 		system(sysCommand.c_str());
 
@@ -113,7 +113,8 @@ int main(int argc, char** argv)
 	//sysCommand = "rm moleculeLib/output-" + nameOfProtein + ".tar \n";
 
 	/* make tar file from outputFiles/[nameOfProtein] */
-	sysCommand = "tar -czf outputFiles/" + nameOfProtein + ".tar.gz outputFiles/" + nameOfProtein + "\n";
+	/* the output files are already compressed by synth */
+	sysCommand = "tar -cf outputFiles/" + nameOfProtein + ".tar outputFiles/" + nameOfProtein + "\n";
 	cout << sysCommand << endl;
 	system(sysCommand.c_str());
 
@@ -0,0 +1,376 @@
+//
+// Synthetic linker and rigid libraries for reproducible synthesis workloads.
+//
+//     ./generate_fragments [-linkers <n>] [-rigids <n>] [-latoms <n>] [-atoms <n>]
+//                          [-branch <d>] [-seed <s>] [-prefix <name>]
+//
+// Writes l<name>.sdf and r<name>.sdf (default name: synthetic) in the appendix format
+// read by Linker::parseAppendix and Rigid::parseAppendix:
+//
+//   * a rigid is a ring (benzene, pyridine, cyclopentane or cyclohexane) with chain
+//     substituents up to -atoms heavy atoms; its appendix lists the atom types and the
+//     branches: atoms that accept one connection, with the atom types they accept;
+//   * a linker is a chain of -latoms heavy atoms; its appendix lists, per atom, the
+//     maximum number of connections and the atom type.
+//
+// -branch <d> in [0, 1] is the fraction of the atoms with a free valence that are
+// connection points (at least one per fragment). The same seed yields the same files.
+//
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+
+//
+// Deterministic generator (64-bit LCG), independent of the C library.
+//
+class Random
+{
+  public:
+    Random(unsigned long long seed) : state(seed * 6364136223846793005ULL + 1442695040888963407ULL) {}
+
+    unsigned int Next(unsigned int bound)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (unsigned int)((state >> 33) % bound);
+    }
+
+    bool Chance(double p) { return Next(1000000) < p * 1000000; }
+
+  private:
+    unsigned long long state;
+};
+
+// ****************************************************************************
+
+struct FragmentAtom
+{
+    std::string element;
+    std::string type;    // Sybyl atom type, as in the appendix
+    double x;
+    double y;
+    int valence;         // maximum
+    int used;            // sum of bond orders
+};
+
+struct FragmentBond
+{
+    int from;            // 1-based
+    int to;
+    int order;
+};
+
+struct Fragment
+{
+    std::string name;
+    std::vector<FragmentAtom> atoms;
+    std::vector<FragmentBond> bonds;
+};
+
+// Types a branch may accept; each branch accepts C.3 so linkers always fit.
+static const char* const BRANCH_TYPES[] = { "C.ar", "N.3", "O.3" };
+static const unsigned int NUM_BRANCH_TYPES = 3;
+
+// ****************************************************************************
+
+static FragmentAtom MakeAtom(const std::string& type, double x, double y)
+{
+    FragmentAtom atom;
+
+    atom.type = type;
+    atom.element = type.substr(0, type.find('.'));
+    atom.x = x;
+    atom.y = y;
+    atom.valence = atom.element == "C" ? 4 : atom.element == "N" ? 3 : 2;
+    atom.used = 0;
+
+    return atom;
+}
+
+static void AddBond(Fragment& fragment, int from, int to, int order)
+{
+    FragmentBond bond = { from + 1, to + 1, order };
+    fragment.bonds.push_back(bond);
+
+    fragment.atoms[from].used += order;
+    fragment.atoms[to].used += order;
+}
+
+static int FreeValence(const FragmentAtom& atom)
+{
+    return atom.valence - atom.used;
+}
+
+//
+// A substituent of a random type bonded to a random atom with a free valence.
+//
+static bool AddSubstituent(Fragment& fragment, Random& random)
+{
+    std::vector<int> candidates;
+    for (unsigned int a = 0; a < fragment.atoms.size(); a++)
+    {
+        if (FreeValence(fragment.atoms[a]) > 0) candidates.push_back(a);
+    }
+    if (candidates.empty()) return false;
+
+    int parent = candidates[random.Next(candidates.size())];
+
+    // Mostly carbon substituents.
+    static const char* const TYPES[] = { "C.3", "C.3", "C.3", "N.3", "O.3" };
+    std::string type = TYPES[random.Next(5)];
+
+    // Point away from the ring center.
+    double dx = fragment.atoms[parent].x;
+    double dy = fragment.atoms[parent].y;
+    double length = std::sqrt(dx * dx + dy * dy);
+    if (length < 0.1) { dx = 1.0; dy = 0.0; length = 1.0; }
+
+    double angle = (random.Next(60) - 30.0) * M_PI / 180.0;
+    double ux = dx / length, uy = dy / length;
+    double x = fragment.atoms[parent].x + 1.5 * (ux * std::cos(angle) - uy * std::sin(angle));
+    double y = fragment.atoms[parent].y + 1.5 * (ux * std::sin(angle) + uy * std::cos(angle));
+
+    fragment.atoms.push_back(MakeAtom(type, x, y));
+    AddBond(fragment, parent, fragment.atoms.size() - 1, 1);
+
+    return true;
+}
+
+// ****************************************************************************
+
+static Fragment MakeRigid(unsigned int index, unsigned int numAtoms, Random& random)
+{
+    Fragment rigid;
+
+    std::ostringstream name;
+    name << "rigid_" << index;
+    rigid.name = name.str();
+
+    //
+    // The ring: aromatic rings are in Kekule form; a pyridine nitrogen has no free valence.
+    //
+    unsigned int kind = random.Next(4);
+    unsigned int ringSize = kind == 2 ? 5 : 6;
+    bool aromatic = kind < 2;
+
+    for (unsigned int a = 0; a < ringSize; a++)
+    {
+        double angle = 2 * M_PI * a / ringSize;
+        std::string type = aromatic ? (kind == 1 && a == ringSize - 1 ? "N.ar" : "C.ar") : "C.3";
+
+        rigid.atoms.push_back(MakeAtom(type, 1.4 * std::cos(angle), 1.4 * std::sin(angle)));
+    }
+
+    for (unsigned int a = 0; a < ringSize; a++)
+    {
+        AddBond(rigid, a, (a + 1) % ringSize, aromatic && a % 2 == 0 ? 2 : 1);
+    }
+
+    // Aromatic valences: C.ar keeps one free, N.ar none.
+    if (aromatic)
+    {
+        for (unsigned int a = 0; a < ringSize; a++)
+        {
+            rigid.atoms[a].valence = rigid.atoms[a].used + (rigid.atoms[a].element == "C" ? 1 : 0);
+        }
+    }
+
+    while (rigid.atoms.size() < numAtoms && AddSubstituent(rigid, random)) ;
+
+    return rigid;
+}
+
+static Fragment MakeLinker(unsigned int index, unsigned int numAtoms, Random& random)
+{
+    Fragment linker;
+
+    std::ostringstream name;
+    name << "linker_" << index;
+    linker.name = name.str();
+
+    // A zig-zag chain; oxygen only inside the chain and never next to another oxygen.
+    for (unsigned int a = 0; a < numAtoms; a++)
+    {
+        std::string type = "C.3";
+        bool inner = a > 0 && a + 1 < numAtoms;
+
+        unsigned int pick = random.Next(6);
+        if (pick == 0) type = "N.3";
+        else if (pick == 1 && inner && linker.atoms[a - 1].element != "O") type = "O.3";
+
+        linker.atoms.push_back(MakeAtom(type, 1.3 * a, a % 2 == 0 ? 0.0 : 0.75));
+        if (a > 0) AddBond(linker, a - 1, a, 1);
+    }
+
+    return linker;
+}
+
+// ****************************************************************************
+//
+// Connection points: a fraction of the atoms with a free valence, at least one.
+//
+static std::vector<bool> ChooseBranches(const Fragment& fragment, double density, Random& random)
+{
+    std::vector<bool> branch(fragment.atoms.size(), false);
+    std::vector<int> candidates;
+
+    for (unsigned int a = 0; a < fragment.atoms.size(); a++)
+    {
+        if (FreeValence(fragment.atoms[a]) <= 0) continue;
+
+        candidates.push_back(a);
+        branch[a] = random.Chance(density);
+    }
+
+    bool any = false;
+    for (unsigned int a = 0; a < branch.size(); a++) any = any || branch[a];
+
+    if (!any && !candidates.empty()) branch[candidates[random.Next(candidates.size())]] = true;
+
+    return branch;
+}
+
+static void WriteMolBlock(std::ostream& out, const Fragment& fragment)
+{
+    char line[128];
+
+    out << fragment.name << "\n";
+    out << "  synthetic\n";
+    out << "\n";
+
+    sprintf(line, "%3u%3u  0  0  0  0  0  0  0  0999 V2000",
+            (unsigned int)fragment.atoms.size(), (unsigned int)fragment.bonds.size());
+    out << line << "\n";
+
+    for (unsigned int a = 0; a < fragment.atoms.size(); a++)
+    {
+        sprintf(line, "%10.4f%10.4f%10.4f %-3s 0  0  0  0  0  0  0  0  0  0  0  0",
+                fragment.atoms[a].x, fragment.atoms[a].y, 0.0, fragment.atoms[a].element.c_str());
+        out << line << "\n";
+    }
+
+    for (unsigned int b = 0; b < fragment.bonds.size(); b++)
+    {
+        sprintf(line, "%3d%3d%3d  0  0  0  0", fragment.bonds[b].from, fragment.bonds[b].to, fragment.bonds[b].order);
+        out << line << "\n";
+    }
+
+    out << "M  END\n";
+}
+
+static void WriteRigid(std::ostream& out, const Fragment& rigid, double density, Random& random)
+{
+    WriteMolBlock(out, rigid);
+
+    out << "> <Atom Types>\n";
+    for (unsigned int a = 0; a < rigid.atoms.size(); a++) out << rigid.atoms[a].type << "\n";
+    out << "\n";
+
+    out << "> <Branches>\n";
+    std::vector<bool> branch = ChooseBranches(rigid, density, random);
+    for (unsigned int a = 0; a < rigid.atoms.size(); a++)
+    {
+        if (!branch[a]) continue;
+
+        out << a + 1 << " C.3";
+        for (unsigned int t = 0; t < NUM_BRANCH_TYPES; t++)
+        {
+            if (random.Chance(0.5)) out << " " << BRANCH_TYPES[t];
+        }
+        out << "\n";
+    }
+    out << "\n";
+
+    out << "$$$$\n";
+}
+
+static void WriteLinker(std::ostream& out, const Fragment& linker, double density, Random& random)
+{
+    WriteMolBlock(out, linker);
+
+    out << "> <Max Connections>\n";
+    std::vector<bool> branch = ChooseBranches(linker, density, random);
+    for (unsigned int a = 0; a < linker.atoms.size(); a++)
+    {
+        out << (branch[a] ? 1 : 0) << " " << linker.atoms[a].type << "\n";
+    }
+    out << "\n";
+
+    out << "$$$$\n";
+}
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    unsigned int numLinkers = 10;
+    unsigned int numRigids = 20;
+    unsigned int linkerAtoms = 3;
+    unsigned int rigidAtoms = 8;
+    double density = 0.3;
+    unsigned long long seed = 1;
+    std::string prefix = "synthetic";
+
+    for (int index = 1; index < argc; index++)
+    {
+        if (index + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << argv[index] << std::endl;
+            return 1;
+        }
+
+        if (strcmp(argv[index], "-linkers") == 0) numLinkers = atoi(argv[++index]);
+        else if (strcmp(argv[index], "-rigids") == 0) numRigids = atoi(argv[++index]);
+        else if (strcmp(argv[index], "-latoms") == 0) linkerAtoms = atoi(argv[++index]);
+        else if (strcmp(argv[index], "-atoms") == 0) rigidAtoms = atoi(argv[++index]);
+        else if (strcmp(argv[index], "-branch") == 0) density = atof(argv[++index]);
+        else if (strcmp(argv[index], "-seed") == 0) seed = strtoull(argv[++index], 0, 10);
+        else if (strcmp(argv[index], "-prefix") == 0) prefix = argv[++index];
+        else
+        {
+            std::cerr << "Unknown option " << argv[index] << std::endl;
+            return 1;
+        }
+    }
+
+    if (linkerAtoms < 1 || rigidAtoms < 5 || density < 0 || density > 1)
+    {
+        std::cerr << "Expected -latoms >= 1, -atoms >= 5 and -branch in [0, 1]." << std::endl;
+        return 1;
+    }
+
+    Random random(seed);
+
+    std::string linkerFile = "l" + prefix + ".sdf";
+    std::string rigidFile = "r" + prefix + ".sdf";
+
+    std::ofstream linkerOut(linkerFile.c_str());
+    std::ofstream rigidOut(rigidFile.c_str());
+    if (linkerOut.fail() || rigidOut.fail())
+    {
+        std::cerr << "Unable to write " << linkerFile << " / " << rigidFile << std::endl;
+        return 1;
+    }
+
+    for (unsigned int ell = 0; ell < numLinkers; ell++)
+    {
+        WriteLinker(linkerOut, MakeLinker(ell, linkerAtoms, random), density, random);
+    }
+
+    for (unsigned int r = 0; r < numRigids; r++)
+    {
+        WriteRigid(rigidOut, MakeRigid(r, rigidAtoms, random), density, random);
+    }
+
+    std::cout << "Wrote " << numLinkers << " linkers to " << linkerFile << " and "
+              << numRigids << " rigids to " << rigidFile << std::endl;
+
+    return 0;
+}
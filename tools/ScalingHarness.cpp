@@ -0,0 +1,316 @@
+//
+// End-to-end scaling runs of synth.
+//
+//     ./scaling_harness [-synth <path>] [-levels 3,4,5] [-threads 1,2,4,8]
+//                       [-csv <file>] <fragment-files> [<synth-options>]
+//
+// Runs synth once per hierarchical level bound (-hl) and thread count (the obgen
+// pool, -pool, and the fragment loader, -load) and records, per run: the number of
+// synthesized molecules (levels 2 and up), wall time, throughput (molecules/s), the
+// peak resident memory of synth and its children, and the time since the start of
+// the run at which each level completed. Results are written as CSV to stdout and,
+// with -csv, to a file.
+//
+// Arguments that are not harness options (the fragment files, e.g. those written by
+// generate_fragments, and other synth options) are passed to synth. Each run writes
+// to a scratch output file that is removed afterwards.
+//
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+
+struct RunResult
+{
+    unsigned int levels;
+    unsigned int threads;
+    unsigned long molecules;
+    double wallSeconds;
+    double peakRssMB;
+    int exitStatus;
+
+    // Seconds from the start of the run at which level m completed (< 0 if not seen).
+    std::vector<double> levelComplete;
+};
+
+// ****************************************************************************
+
+static double Now()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+static bool ParseList(const std::string& list, std::vector<unsigned int>& values)
+{
+    values.clear();
+
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        int value = atoi(item.c_str());
+        if (value <= 0) return false;
+
+        values.push_back(value);
+    }
+
+    return !values.empty();
+}
+
+// ****************************************************************************
+//
+// Interpret a line of synth output (stdout and stderr are merged):
+//     "Level <m> complete."             (stderr, as each level finishes)
+//     "Level\t# Molecules" then "<m>\t<count>" lines (stdout, at the end of synthesis)
+//
+static void ParseLine(const std::string& line, double elapsed, bool& inTable, RunResult& result)
+{
+    unsigned int level;
+    unsigned long count;
+    char rest[32];
+
+    if (sscanf(line.c_str(), "Level %u complete%1s", &level, rest) == 2 && level < result.levelComplete.size())
+    {
+        result.levelComplete[level] = elapsed;
+        return;
+    }
+
+    if (line.find("Level\t# Molecules") == 0)
+    {
+        inTable = true;
+        return;
+    }
+
+    if (inTable)
+    {
+        if (sscanf(line.c_str(), "%u\t%lu", &level, &count) == 2)
+        {
+            if (level >= 2) result.molecules += count;
+        }
+        else inTable = false;
+    }
+}
+
+// ****************************************************************************
+
+static bool RunSynth(const std::string& synth, const std::vector<std::string>& synthArgs,
+                     unsigned int levels, unsigned int threads, RunResult& result)
+{
+    std::ostringstream outFile;
+    outFile << "scaling_run_" << getpid() << ".sdf";
+
+    std::ostringstream levelArg, threadArg;
+    levelArg << levels;
+    threadArg << threads;
+
+    std::vector<std::string> args;
+    args.push_back(synth);
+    args.insert(args.end(), synthArgs.begin(), synthArgs.end());
+    args.push_back("-hl");
+    args.push_back(levelArg.str());
+    args.push_back("-pool");
+    args.push_back(threadArg.str());
+    args.push_back("-load");
+    args.push_back(threadArg.str());
+    args.push_back("-o");
+    args.push_back(outFile.str());
+
+    std::vector<char*> argv;
+    for (unsigned int a = 0; a < args.size(); a++) argv.push_back(const_cast<char*>(args[a].c_str()));
+    argv.push_back(0);
+
+    result.levels = levels;
+    result.threads = threads;
+    result.molecules = 0;
+    result.levelComplete.assign(levels + 1, -1.0);
+
+    int output[2];
+    if (pipe(output) != 0)
+    {
+        perror("pipe");
+        return false;
+    }
+
+    double start = Now();
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        dup2(output[1], STDOUT_FILENO);
+        dup2(output[1], STDERR_FILENO);
+        close(output[0]);
+        close(output[1]);
+
+        execv(argv[0], &argv[0]);
+
+        perror(argv[0]);
+        _exit(127);
+    }
+
+    close(output[1]);
+
+    //
+    // Level completion times are taken as the lines arrive.
+    //
+    FILE* in = fdopen(output[0], "r");
+    bool inTable = false;
+    std::string line;
+    int c;
+
+    while ((c = fgetc(in)) != EOF)
+    {
+        if (c != '\n')
+        {
+            line += (char)c;
+            continue;
+        }
+
+        ParseLine(line, Now() - start, inTable, result);
+        line.clear();
+    }
+    if (!line.empty()) ParseLine(line, Now() - start, inTable, result);
+
+    fclose(in);
+
+    // The usage of the run covers synth and the obgen processes it waited for.
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+
+    result.wallSeconds = Now() - start;
+    result.peakRssMB = usage.ru_maxrss / 1024.0;
+    result.exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+    unlink(outFile.str().c_str());
+
+    return true;
+}
+
+// ****************************************************************************
+
+static void WriteHeader(std::ostream& out, unsigned int maxLevels)
+{
+    out << "levels,threads,molecules,wall_s,molecules_per_s,peak_rss_mb,exit_status";
+    for (unsigned int m = 3; m <= maxLevels; m++) out << ",level" << m << "_s";
+    out << std::endl;
+}
+
+static void WriteRow(std::ostream& out, const RunResult& result, unsigned int maxLevels)
+{
+    out << result.levels << "," << result.threads << "," << result.molecules << ","
+        << result.wallSeconds << ","
+        << (result.wallSeconds > 0 ? result.molecules / result.wallSeconds : 0.0) << ","
+        << result.peakRssMB << "," << result.exitStatus;
+
+    for (unsigned int m = 3; m <= maxLevels; m++)
+    {
+        out << ",";
+        if (m < result.levelComplete.size() && result.levelComplete[m] >= 0) out << result.levelComplete[m];
+    }
+    out << std::endl;
+}
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    std::string synth = "./synth";
+    std::string csvFile = "";
+    std::vector<unsigned int> levels;
+    std::vector<unsigned int> threads;
+    std::vector<std::string> synthArgs;
+
+    ParseList("3,4,5", levels);
+    ParseList("1,2,4,8", threads);
+
+    for (int index = 1; index < argc; index++)
+    {
+        bool hasValue = index + 1 < argc;
+
+        if (strcmp(argv[index], "-synth") == 0 && hasValue) synth = argv[++index];
+        else if (strcmp(argv[index], "-csv") == 0 && hasValue) csvFile = argv[++index];
+        else if (strcmp(argv[index], "-levels") == 0 && hasValue)
+        {
+            if (!ParseList(argv[++index], levels))
+            {
+                std::cerr << "Expected a comma-separated list of levels: " << argv[index] << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[index], "-threads") == 0 && hasValue)
+        {
+            if (!ParseList(argv[++index], threads))
+            {
+                std::cerr << "Expected a comma-separated list of thread counts: " << argv[index] << std::endl;
+                return 1;
+            }
+        }
+        else synthArgs.push_back(argv[index]);
+    }
+
+    if (synthArgs.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [-synth <path>] [-levels 3,4,5] [-threads 1,2,4,8]"
+                  << " [-csv <file>] <fragment-files> [<synth-options>]" << std::endl;
+        return 1;
+    }
+
+    unsigned int maxLevels = 0;
+    for (unsigned int l = 0; l < levels.size(); l++) maxLevels = std::max(maxLevels, levels[l]);
+
+    std::ofstream csv;
+    if (!csvFile.empty())
+    {
+        csv.open(csvFile.c_str());
+        if (csv.fail())
+        {
+            std::cerr << "Unable to write " << csvFile << std::endl;
+            return 1;
+        }
+        WriteHeader(csv, maxLevels);
+    }
+
+    WriteHeader(std::cout, maxLevels);
+
+    for (unsigned int l = 0; l < levels.size(); l++)
+    {
+        for (unsigned int t = 0; t < threads.size(); t++)
+        {
+            std::cerr << "Running " << synth << " -hl " << levels[l] << " with " << threads[t] << " threads" << std::endl;
+
+            RunResult result;
+            if (!RunSynth(synth, synthArgs, levels[l], threads[t], result)) return 1;
+
+            if (result.exitStatus != 0)
+            {
+                std::cerr << synth << " exited with status " << result.exitStatus << std::endl;
+            }
+
+            WriteRow(std::cout, result, maxLevels);
+            if (csv.is_open()) WriteRow(csv, result, maxLevels);
+        }
+    }
+
+    return 0;
+}